@@ -1,7 +1,20 @@
+import importlib
+
+from esphome import automation
 import esphome.codegen as cg
 from esphome.components import uart, text_sensor
 import esphome.config_validation as cv
-from esphome.const import CONF_ID
+import esphome.final_validate as fv
+from esphome.const import (
+    CONF_ID,
+    CONF_INTERVAL,
+    CONF_PLATFORM,
+    CONF_PRIORITY,
+    CONF_STATE,
+    CONF_TIMEOUT,
+    CONF_TRIGGER_ID,
+)
+from esphome.core import CORE
 
 DEPENDENCIES = ["uart"]
 CODEOWNERS = ["@syssi"]
@@ -9,13 +22,259 @@ AUTO_LOAD = ["binary_sensor", "sensor", "switch", "text_sensor"]
 MULTI_CONF = True
 
 CONF_POWERMUST_ID = "powermust_id"
+ENTITY_DOMAINS = ["sensor", "binary_sensor", "switch", "text_sensor"]
+CONF_POLLING = "polling"
+CONF_POLICY = "policy"
+CONF_ADAPTIVE_POLLING = "adaptive_polling"
+CONF_MIN_INTERVAL = "min_interval"
+CONF_MAX_INTERVAL = "max_interval"
+CONF_HYSTERESIS = "hysteresis"
+CONF_LOAD_CHANGE = "load_change"
+CONF_GRID_VOLTAGE_CHANGE = "grid_voltage_change"
+CONF_BATTERY_VOLTAGE_CHANGE = "battery_voltage_change"
+CONF_HISTORY = "history"
+CONF_DOWNSAMPLING = "downsampling"
+CONF_CAPTURE = "capture"
+CONF_SIZE = "size"
+CONF_POWER_QUALITY = "power_quality"
+CONF_WINDOW = "window"
+CONF_NOMINAL_VOLTAGE = "nominal_voltage"
+CONF_NOMINAL_FREQUENCY = "nominal_frequency"
+CONF_SAG_THRESHOLD = "sag_threshold"
+CONF_SWELL_THRESHOLD = "swell_threshold"
+CONF_FREQUENCY_DEVIATION = "frequency_deviation"
+CONF_INSTRUMENTATION = "instrumentation"
+CONF_HEAP_FREE = "heap_free"
+CONF_DEVICE_PROFILE = "device_profile"
+CONF_EVENT_DRIVEN = "event_driven"
+CONF_TRANSPORT = "transport"
+CONF_AGGREGATION = "aggregation"
+CONF_SEQUENCES = "sequences"
+CONF_SEQUENCE = "sequence"
+CONF_STEPS = "steps"
+CONF_COMMAND = "command"
+CONF_EXPECT = "expect"
+CONF_ROLLBACK = "rollback"
+CONF_ON_SEQUENCE_FINISHED = "on_sequence_finished"
+CONF_ON_UTILITY_FAIL = "on_utility_fail"
+CONF_ON_UTILITY_RESTORED = "on_utility_restored"
+CONF_ON_BATTERY_LOW = "on_battery_low"
+CONF_ON_UPS_FAILED = "on_ups_failed"
+CONF_ON_TEST_FINISHED = "on_test_finished"
+
 powermust_ns = cg.esphome_ns.namespace("powermust")
 PowermustComponent = powermust_ns.class_("Powermust", cg.Component)
+ExportHistoryAction = powermust_ns.class_("ExportHistoryAction", automation.Action)
+DumpCaptureAction = powermust_ns.class_("DumpCaptureAction", automation.Action)
+RunSequenceAction = powermust_ns.class_("RunSequenceAction", automation.Action)
+CommandSequence = powermust_ns.class_("CommandSequence")
+SequenceResult = powermust_ns.struct("SequenceResult")
+SequenceFinishedTrigger = powermust_ns.class_(
+    "SequenceFinishedTrigger", automation.Trigger.template(SequenceResult.operator("const").operator("ref"))
+)
+Q1Sample = powermust_ns.struct("Q1Sample")
+PowerEventTrigger = powermust_ns.class_(
+    "PowerEventTrigger", automation.Trigger.template(Q1Sample.operator("const").operator("ref"))
+)
+
+PowerEvent = powermust_ns.enum("PowerEvent")
+# Flancos de los bits de estado del Q1; el disparador recibe la muestra como "x"
+POWER_EVENTS = {
+    CONF_ON_UTILITY_FAIL: PowerEvent.POWER_EVENT_UTILITY_FAIL,
+    CONF_ON_UTILITY_RESTORED: PowerEvent.POWER_EVENT_UTILITY_RESTORED,
+    CONF_ON_BATTERY_LOW: PowerEvent.POWER_EVENT_BATTERY_LOW,
+    CONF_ON_UPS_FAILED: PowerEvent.POWER_EVENT_UPS_FAILED,
+    CONF_ON_TEST_FINISHED: PowerEvent.POWER_EVENT_TEST_FINISHED,
+}
+
+Q1Status = powermust_ns.enum("Q1Status")
+# Bits de estado del Q1 con los que se verifica un paso de secuencia
+Q1_STATUS_BITS = {
+    "utility_fail": Q1Status.Q1_STATUS_UTILITY_FAIL,
+    "battery_low": Q1Status.Q1_STATUS_BATTERY_LOW,
+    "bypass_active": Q1Status.Q1_STATUS_BYPASS_ACTIVE,
+    "ups_failed": Q1Status.Q1_STATUS_UPS_FAILED,
+    "ups_type_standby": Q1Status.Q1_STATUS_UPS_TYPE_STANDBY,
+    "test_in_progress": Q1Status.Q1_STATUS_TEST_IN_PROGRESS,
+    "shutdown_active": Q1Status.Q1_STATUS_SHUTDOWN_ACTIVE,
+    "beeper_on": Q1Status.Q1_STATUS_BEEPER_ON,
+}
+
+ENUMPollingCommand = powermust_ns.enum("ENUMPollingCommand")
+POLLING_COMMANDS = {
+    "q1": ENUMPollingCommand.POLLING_Q1,
+    "f": ENUMPollingCommand.POLLING_F,
+    "i": ENUMPollingCommand.POLLING_I,
+}
+
+PollingPolicy = powermust_ns.enum("PollingPolicy")
+POLLING_POLICIES = {
+    "interval": PollingPolicy.POLLING_POLICY_INTERVAL,
+    "once": PollingPolicy.POLLING_POLICY_ONCE,
+    "on_reconnect": PollingPolicy.POLLING_POLICY_ON_RECONNECT,
+}
+
+# Q1 cada update_interval; F e I al arrancar, al reconectar y cada hora
+POLLING_DEFAULTS = {
+    "q1": (None, 10, "interval"),
+    "f": ("1h", 5, "on_reconnect"),
+    "i": ("1h", 1, "on_reconnect"),
+}
 
 POWERMUST_COMPONENT_SCHEMA = cv.Schema({
     cv.Required(CONF_POWERMUST_ID): cv.use_id(PowermustComponent),
 })
 
+
+def powermust_config(powermust_id):
+    # Configuración del powermust al que pertenece una plataforma (validación final)
+    for conf in fv.full_config.get().get("powermust", []):
+        if conf[CONF_ID] == powermust_id:
+            return conf
+    return {}
+
+
+def polling_command_schema(command):
+    interval, priority, policy = POLLING_DEFAULTS[command]
+    schema = {
+        cv.Optional(CONF_PRIORITY, default=priority): cv.int_range(min=0, max=255),
+        cv.Optional(CONF_POLICY, default=policy): cv.enum(POLLING_POLICIES, lower=True),
+    }
+    if interval is None:
+        # Sin intervalo propio se usa update_interval
+        schema[cv.Optional(CONF_INTERVAL)] = cv.positive_time_period_milliseconds
+    else:
+        schema[cv.Optional(CONF_INTERVAL, default=interval)] = cv.positive_time_period_milliseconds
+    return cv.Schema(schema)
+
+
+POLLING_SCHEMA = cv.Schema({
+    cv.Optional(command, default={}): polling_command_schema(command)
+    for command in POLLING_COMMANDS
+})
+
+
+def validate_adaptive_polling(config):
+    if config[CONF_MIN_INTERVAL] > config[CONF_MAX_INTERVAL]:
+        raise cv.Invalid(f"{CONF_MIN_INTERVAL} must not be greater than {CONF_MAX_INTERVAL}")
+    return config
+
+
+# Q1 rápido con corte de red, test en curso, batería baja o cambios bruscos;
+# con lecturas estables se duplica el intervalo cada "hysteresis" hasta max_interval
+ADAPTIVE_POLLING_SCHEMA = cv.All(
+    cv.Schema({
+        cv.Optional(CONF_MIN_INTERVAL, default="1s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_INTERVAL, default="30s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_HYSTERESIS, default="60s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_LOAD_CHANGE, default=10): cv.int_range(min=1, max=100),
+        cv.Optional(CONF_GRID_VOLTAGE_CHANGE, default=5.0): cv.positive_float,
+        cv.Optional(CONF_BATTERY_VOLTAGE_CHANGE, default=0.3): cv.positive_float,
+    }),
+    validate_adaptive_polling,
+)
+
+# Histórico en RAM: cada muestra Q1, medias de 1 min y de 10 min
+HISTORY_SCHEMA = cv.Schema({
+    cv.Optional(CONF_DOWNSAMPLING, default=True): cv.boolean,
+})
+
+# Huecos, sobretensiones y desvíos de frecuencia; sin nominal configurado se usan los valores del F
+POWER_QUALITY_SCHEMA = cv.All(
+    cv.Schema({
+        cv.Optional(CONF_WINDOW, default="5min"): cv.All(
+            cv.positive_time_period_milliseconds, cv.Range(min=cv.TimePeriod(seconds=10))
+        ),
+        cv.Optional(CONF_NOMINAL_VOLTAGE): cv.float_range(min=50, max=300),
+        cv.Optional(CONF_NOMINAL_FREQUENCY): cv.float_range(min=40, max=70),
+        cv.Optional(CONF_SAG_THRESHOLD, default="10%"): cv.All(cv.percentage, cv.Range(min=0.05, max=0.5)),
+        cv.Optional(CONF_SWELL_THRESHOLD, default="10%"): cv.All(cv.percentage, cv.Range(min=0.05, max=0.5)),
+        # Mayor que la histéresis de 0.1 Hz
+        cv.Optional(CONF_FREQUENCY_DEVIATION, default=0.5): cv.float_range(min=0.2, max=5.0),
+    }),
+    cv.has_none_or_all_keys(CONF_NOMINAL_VOLTAGE, CONF_NOMINAL_FREQUENCY),
+)
+
+# Los valores analógicos del Q1 se publican una vez por ventana, con sus agregados
+AGGREGATION_SCHEMA = cv.Schema({
+    cv.Optional(CONF_WINDOW, default="1min"): cv.All(
+        cv.positive_time_period_milliseconds, cv.Range(min=cv.TimePeriod(seconds=1))
+    ),
+})
+
+# Captura en crudo de la UART; un registro ocupa 5 bytes más los datos
+CAPTURE_SCHEMA = cv.Schema({
+    cv.Optional(CONF_SIZE, default=4096): cv.int_range(min=256, max=65536),
+})
+
+
+# Comando Megatec tal cual se envía, sin el '\r'; cabe en un hueco de la cola (MAX_COMMAND_LENGTH)
+SEQUENCE_COMMAND = cv.All(cv.string_strict, cv.Length(min=1, max=15))
+
+
+def validate_sequence_step(config):
+    if CONF_STATE in config and CONF_EXPECT not in config:
+        raise cv.Invalid(f"'{CONF_STATE}' requires '{CONF_EXPECT}'")
+    return config
+
+
+# Cada paso espera su ACK y, con "expect", el bit de estado en un Q1 pedido justo después
+SEQUENCE_STEP_SCHEMA = cv.All(
+    cv.Schema({
+        cv.Required(CONF_COMMAND): SEQUENCE_COMMAND,
+        cv.Optional(CONF_EXPECT): cv.enum(Q1_STATUS_BITS, lower=True),
+        cv.Optional(CONF_STATE): cv.boolean,
+        cv.Optional(CONF_TIMEOUT, default="5s"): cv.All(
+            cv.positive_time_period_milliseconds, cv.Range(max=cv.TimePeriod(minutes=10))
+        ),
+    }),
+    validate_sequence_step,
+)
+
+# Límites de CommandSequence::MAX_STEPS y MAX_ROLLBACK_COMMANDS
+SEQUENCE_SCHEMA = cv.Schema({
+    cv.Required(CONF_ID): cv.declare_id(CommandSequence),
+    cv.Required(CONF_STEPS): cv.All(cv.ensure_list(SEQUENCE_STEP_SCHEMA), cv.Length(min=1, max=8)),
+    cv.Optional(CONF_ROLLBACK, default=[]): cv.All(cv.ensure_list(SEQUENCE_COMMAND), cv.Length(max=4)),
+})
+
+
+def validate_heap_free(config):
+    if not config[CONF_HEAP_FREE]:
+        return config
+    # El volcado crea una cadena base64 por línea de log
+    if CONF_CAPTURE in config:
+        raise cv.Invalid(f"'{CONF_CAPTURE}' allocates while dumping and is not available with '{CONF_HEAP_FREE}'")
+    # Cada pausa registra un timeout nuevo en el planificador; sin heap, loop() sigue sondeando
+    if config[CONF_EVENT_DRIVEN]:
+        raise cv.Invalid(
+            f"'{CONF_EVENT_DRIVEN}' allocates a scheduler timeout on every sleep and is not available with "
+            f"'{CONF_HEAP_FREE}'"
+        )
+    return config
+
+
+def validate_capture(config):
+    # La captura se escribe desde el loop principal y no es segura con la UART en otra tarea
+    if CONF_CAPTURE in config and config[CONF_TRANSPORT] == "task":
+        raise cv.Invalid(f"'{CONF_CAPTURE}' is not available with '{CONF_TRANSPORT}: task'")
+    return config
+
+
+def validate_transport(value):
+    value = cv.one_of("loop", "task", lower=True)(value)
+    if value == "task":
+        if not CORE.is_esp32:
+            raise cv.Invalid(f"'{CONF_TRANSPORT}: task' is only available on ESP32")
+        # Solo compensa con un núcleo libre para la tarea
+        from esphome.components.esp32 import VARIANT_ESP32, VARIANT_ESP32S3, get_esp32_variant
+
+        variant = get_esp32_variant()
+        if variant not in (VARIANT_ESP32, VARIANT_ESP32S3):
+            raise cv.Invalid(f"'{CONF_TRANSPORT}: task' requires a dual-core ESP32, not {variant}")
+    return value
+
+
 CONFIG_SCHEMA = cv.All(
     cv.Schema({
         cv.GenerateID(): cv.declare_id(PowermustComponent),
@@ -23,20 +282,210 @@ CONFIG_SCHEMA = cv.All(
         cv.Optional("ups_info"): text_sensor.text_sensor_schema(
             icon="mdi:information-outline"
         ),
+        cv.Optional(CONF_POLLING, default={}): POLLING_SCHEMA,
+        cv.Optional(CONF_ADAPTIVE_POLLING): ADAPTIVE_POLLING_SCHEMA,
+        cv.Optional(CONF_HISTORY): HISTORY_SCHEMA,
+        cv.Optional(CONF_POWER_QUALITY): POWER_QUALITY_SCHEMA,
+        cv.Optional(CONF_CAPTURE): CAPTURE_SCHEMA,
+        cv.Optional(CONF_AGGREGATION): AGGREGATION_SCHEMA,
+        cv.Optional(CONF_SEQUENCES): cv.ensure_list(SEQUENCE_SCHEMA),
+        cv.Optional(CONF_ON_SEQUENCE_FINISHED): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(SequenceFinishedTrigger),
+        }),
+        cv.Optional(CONF_INSTRUMENTATION, default=False): cv.boolean,
+        cv.Optional(CONF_HEAP_FREE, default=False): cv.boolean,
+        cv.Optional(CONF_DEVICE_PROFILE, default=True): cv.boolean,
+        cv.Optional(CONF_TRANSPORT, default="loop"): validate_transport,
+        # loop() se desactiva entre polls; disable_loop() existe desde ESPHome 2025.7.0
+        cv.Optional(CONF_EVENT_DRIVEN, default=False): cv.All(
+            cv.boolean, cv.require_esphome_version(2025, 7, 0)
+        ),
+    }).extend({
+        cv.Optional(event): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(PowerEventTrigger),
+        })
+        for event in POWER_EVENTS
     })
     .extend(cv.polling_component_schema("10s"))
-    .extend(uart.UART_DEVICE_SCHEMA)
+    .extend(uart.UART_DEVICE_SCHEMA),
+    validate_heap_free,
+    validate_capture,
 )
 
+def powermust_entities():
+    # Clave de configuración -> entidad declarada con las macros POWERMUST_* de powermust.h
+    platforms = {domain: importlib.import_module(f".{domain}", __package__) for domain in ENTITY_DOMAINS}
+    return {
+        "sensor": {
+            type: type
+            for type in (*platforms["sensor"].TYPES, *platforms["sensor"].AGGREGATE_TYPES,
+                         *platforms["sensor"].DIAGNOSTIC_TYPES, *platforms["sensor"].INSTRUMENTATION_TYPES)
+        },
+        "binary_sensor": {
+            type: type for type in (*platforms["binary_sensor"].TYPES, *platforms["binary_sensor"].DIAGNOSTIC_TYPES)
+        },
+        "switch": {type: f"{type}_switch" for type in platforms["switch"].TYPES},
+        "text_sensor": {type: type for type in platforms["text_sensor"].TYPES},
+    }
+
+
+def configured_entities():
+    # Entidades configuradas en cualquier unidad; las defines son globales
+    configured = set()
+    if any("ups_info" in conf for conf in CORE.config.get("powermust", [])):
+        configured.add("ups_info")
+    for domain, entities in powermust_entities().items():
+        for conf in CORE.config.get(domain, []):
+            if conf.get(CONF_PLATFORM) == "powermust":
+                configured.update(name for key, name in entities.items() if key in conf)
+    return configured
+
+
+def add_entity_defines():
+    # Solo se compila el almacenamiento y la publicación de las entidades configuradas
+    configured = configured_entities()
+    cg.add_define("USE_POWERMUST_ENTITIES")
+    for name in ["ups_info", *(name for entities in powermust_entities().values() for name in entities.values())]:
+        cg.add_define(f"POWERMUST_HAS_{name}", 1 if name in configured else 0)
+
+
+def fnv1_hash(text):
+    # El mismo hash que esphome::fnv1_hash en C++
+    value = 2166136261
+    for byte in text.encode():
+        value = (value * 16777619) & 0xFFFFFFFF
+        value ^= byte
+    return value
+
+
 # ← ¡CORREGIDO: async def!
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)          # ← await
     await uart.register_uart_device(var, config)      # ← await
+    # Las preferencias de la unidad cuelgan de su id: no cambian al añadir o reordenar unidades
+    cg.add(var.set_preference_key(fnv1_hash(str(config[CONF_ID].id))))
 
     if "ups_info" in config:
         ups_info_conf = config["ups_info"]
         ups_info = await text_sensor.new_text_sensor(ups_info_conf)  # ← await
         cg.add(var.set_ups_info(ups_info))
 
+    for command, conf in config[CONF_POLLING].items():
+        interval = conf[CONF_INTERVAL].total_milliseconds if CONF_INTERVAL in conf else 0
+        cg.add(var.set_polling_schedule(
+            POLLING_COMMANDS[command], interval, conf[CONF_PRIORITY], conf[CONF_POLICY]
+        ))
+
+    if CONF_ADAPTIVE_POLLING in config:
+        conf = config[CONF_ADAPTIVE_POLLING]
+        # El Q1 tiene que convertir red, carga y batería aunque no sean entidades
+        cg.add_define("USE_POWERMUST_ADAPTIVE_POLLING")
+        cg.add(var.set_adaptive_polling(
+            conf[CONF_MIN_INTERVAL], conf[CONF_MAX_INTERVAL], conf[CONF_HYSTERESIS]
+        ))
+        cg.add(var.set_adaptive_thresholds(
+            conf[CONF_LOAD_CHANGE], conf[CONF_GRID_VOLTAGE_CHANGE], conf[CONF_BATTERY_VOLTAGE_CHANGE]
+        ))
+
+    cg.add(var.set_device_profile(config[CONF_DEVICE_PROFILE]))
+    add_entity_defines()
+
+    if config[CONF_INSTRUMENTATION]:
+        cg.add_define("USE_POWERMUST_INSTRUMENTATION")
+
+    if config[CONF_EVENT_DRIVEN]:
+        cg.add_define("USE_POWERMUST_EVENT_DRIVEN")
+        cg.add(var.set_event_driven(True))
+
+    if config[CONF_TRANSPORT] == "task":
+        cg.add_define("USE_POWERMUST_TRANSPORT_TASK")
+        cg.add(var.set_transport_task(True))
+
+    if CONF_HISTORY in config:
+        cg.add_define("USE_POWERMUST_HISTORY")
+        cg.add(var.set_history_downsampling(config[CONF_HISTORY][CONF_DOWNSAMPLING]))
+
+    if CONF_CAPTURE in config:
+        cg.add_define("USE_POWERMUST_CAPTURE")
+        cg.add(var.set_capture_size(config[CONF_CAPTURE][CONF_SIZE]))
+
+    if CONF_AGGREGATION in config:
+        cg.add_define("USE_POWERMUST_AGGREGATION")
+        cg.add(var.set_aggregation_window(config[CONF_AGGREGATION][CONF_WINDOW]))
+
+    if CONF_POWER_QUALITY in config:
+        conf = config[CONF_POWER_QUALITY]
+        cg.add_define("USE_POWERMUST_POWER_QUALITY")
+        cg.add(var.set_power_quality_window(conf[CONF_WINDOW]))
+        cg.add(var.set_power_quality_thresholds(
+            conf[CONF_SAG_THRESHOLD], conf[CONF_SWELL_THRESHOLD], conf[CONF_FREQUENCY_DEVIATION]
+        ))
+        if CONF_NOMINAL_VOLTAGE in conf:
+            cg.add(var.set_power_quality_nominal(conf[CONF_NOMINAL_VOLTAGE], conf[CONF_NOMINAL_FREQUENCY]))
+
+    if CONF_SEQUENCES in config or CONF_ON_SEQUENCE_FINISHED in config:
+        cg.add_define("USE_POWERMUST_SEQUENCES")
+    for conf in config.get(CONF_SEQUENCES, []):
+        sequence = cg.new_Pvariable(conf[CONF_ID], conf[CONF_ID].id)
+        for step in conf[CONF_STEPS]:
+            mask = step.get(CONF_EXPECT, 0)
+            value = mask if step.get(CONF_STATE, True) else 0
+            cg.add(sequence.add_step(step[CONF_COMMAND], mask, value, step[CONF_TIMEOUT]))
+        for command in conf[CONF_ROLLBACK]:
+            cg.add(sequence.add_rollback(command))
+    for conf in config.get(CONF_ON_SEQUENCE_FINISHED, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(SequenceResult.operator("const").operator("ref"), "x")], conf)
+
+    if any(event in config for event in POWER_EVENTS):
+        # Los disparadores reciben la muestra Q1 entera como x
+        cg.add_define("USE_POWERMUST_POWER_EVENTS")
+    for event, power_event in POWER_EVENTS.items():
+        for conf in config.get(event, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var, power_event)
+            await automation.build_automation(trigger, [(Q1Sample.operator("const").operator("ref"), "x")], conf)
+
     return var  # ← ¡Este yield SÍ va al final!
+
+
+@automation.register_action(
+    "powermust.export_history",
+    ExportHistoryAction,
+    automation.maybe_simple_id({
+        cv.GenerateID(): cv.use_id(PowermustComponent),
+    }),
+)
+async def export_history_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+@automation.register_action(
+    "powermust.dump_capture",
+    DumpCaptureAction,
+    automation.maybe_simple_id({
+        cv.GenerateID(): cv.use_id(PowermustComponent),
+    }),
+)
+async def dump_capture_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+@automation.register_action(
+    "powermust.run_sequence",
+    RunSequenceAction,
+    cv.Schema({
+        cv.GenerateID(): cv.use_id(PowermustComponent),
+        cv.Required(CONF_SEQUENCE): cv.use_id(CommandSequence),
+    }),
+)
+async def run_sequence_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    sequence = await cg.get_variable(config[CONF_SEQUENCE])
+    cg.add(var.set_sequence(sequence))
+    return var
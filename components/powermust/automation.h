@@ -0,0 +1,48 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "powermust.h"
+
+namespace esphome {
+namespace powermust {
+
+class PowerEventTrigger : public Trigger<const Q1Sample &> {
+ public:
+  PowerEventTrigger(Powermust *parent, PowerEvent event) {
+    parent->add_on_power_event_callback([this, event](PowerEvent fired, const Q1Sample &sample) {
+      if (fired == event)
+        this->trigger(sample);
+    });
+  }
+};
+
+#ifdef USE_POWERMUST_SEQUENCES
+class SequenceFinishedTrigger : public Trigger<const SequenceResult &> {
+ public:
+  explicit SequenceFinishedTrigger(Powermust *parent) {
+    parent->add_on_sequence_finished_callback([this](const SequenceResult &result) { this->trigger(result); });
+  }
+};
+
+template<typename... Ts> class RunSequenceAction : public Action<Ts...>, public Parented<Powermust> {
+ public:
+  void set_sequence(const CommandSequence *sequence) { this->sequence_ = sequence; }
+  void play(Ts... x) override { this->parent_->run_sequence(this->sequence_); }
+
+ protected:
+  const CommandSequence *sequence_;
+};
+#endif
+
+template<typename... Ts> class DumpCaptureAction : public Action<Ts...>, public Parented<Powermust> {
+ public:
+  void play(Ts... x) override { this->parent_->dump_capture(); }
+};
+
+template<typename... Ts> class ExportHistoryAction : public Action<Ts...>, public Parented<Powermust> {
+ public:
+  void play(Ts... x) override { this->parent_->export_history(); }
+};
+
+}  // namespace powermust
+}  // namespace esphome
@@ -1,6 +1,7 @@
 import esphome.codegen as cg
 from esphome.components import binary_sensor
 import esphome.config_validation as cv
+from esphome.const import DEVICE_CLASS_CONNECTIVITY, ENTITY_CATEGORY_DIAGNOSTIC
 
 from .. import CONF_POWERMUST_ID, POWERMUST_COMPONENT_SCHEMA
 
@@ -16,6 +17,7 @@ CONF_UPS_TYPE_STANDBY = "ups_type_standby"
 CONF_TEST_IN_PROGRESS = "test_in_progress"
 CONF_SHUTDOWN_ACTIVE = "shutdown_active"
 CONF_BEEPER_ON = "beeper_on"
+CONF_LINK = "link"
 
 TYPES = [
     CONF_UTILITY_FAIL,
@@ -28,8 +30,18 @@ TYPES = [
     CONF_BEEPER_ON,
 ]
 
+# Estado del enlace con el SAI: no registra comandos de polling
+DIAGNOSTIC_TYPES = {
+    CONF_LINK: binary_sensor.binary_sensor_schema(
+        device_class=DEVICE_CLASS_CONNECTIVITY,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+}
+
 CONFIG_SCHEMA = POWERMUST_COMPONENT_SCHEMA.extend(
     {cv.Optional(type): binary_sensor.binary_sensor_schema() for type in TYPES}
+).extend(
+    {cv.Optional(type): schema for type, schema in DIAGNOSTIC_TYPES.items()}
 )
 
 
@@ -40,3 +52,8 @@ async def to_code(config):
             conf = config[type]
             var = await binary_sensor.new_binary_sensor(conf)
             cg.add(getattr(paren, f"set_{type}")(var))
+
+    for type, _ in DIAGNOSTIC_TYPES.items():
+        if type in config:
+            var = await binary_sensor.new_binary_sensor(config[type])
+            cg.add(getattr(paren, f"set_{type}")(var))
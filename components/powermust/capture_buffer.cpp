@@ -0,0 +1,70 @@
+#include "capture_buffer.h"
+
+namespace esphome {
+namespace powermust {
+
+void CaptureBuffer::set_capacity(size_t capacity) {
+  delete[] this->buffer_;
+  this->buffer_ = new uint8_t[capacity];
+  this->capacity_ = capacity;
+  this->clear();
+}
+
+void CaptureBuffer::add(bool tx, const uint8_t *data, size_t length, uint32_t timestamp) {
+  if (this->capacity_ < HEADER_LENGTH + MAX_DATA_LENGTH)
+    return;
+  while (length > 0) {
+    uint8_t chunk = length < MAX_DATA_LENGTH ? length : MAX_DATA_LENGTH;
+    size_t record_length = HEADER_LENGTH + chunk;
+    while (this->capacity_ - this->used_ < record_length)
+      this->drop_oldest_();
+
+    uint8_t header[HEADER_LENGTH] = {
+        (uint8_t) timestamp,
+        (uint8_t) (timestamp >> 8),
+        (uint8_t) (timestamp >> 16),
+        (uint8_t) (timestamp >> 24),
+        (uint8_t) ((tx ? FLAG_TX : 0) | chunk),
+    };
+    this->put_(header, HEADER_LENGTH);
+    this->put_(data, chunk);
+    this->records_++;
+    data += chunk;
+    length -= chunk;
+  }
+}
+
+void CaptureBuffer::clear() {
+  this->head_ = 0;
+  this->used_ = 0;
+  this->records_ = 0;
+  this->dropped_ = 0;
+}
+
+size_t CaptureBuffer::read(size_t offset, uint8_t *out, size_t max) const {
+  if (offset >= this->used_)
+    return 0;
+  size_t length = this->used_ - offset < max ? this->used_ - offset : max;
+  for (size_t i = 0; i < length; i++)
+    out[i] = this->buffer_[(this->head_ + offset + i) % this->capacity_];
+  return length;
+}
+
+void CaptureBuffer::put_(const uint8_t *data, size_t length) {
+  size_t tail = (this->head_ + this->used_) % this->capacity_;
+  for (size_t i = 0; i < length; i++)
+    this->buffer_[(tail + i) % this->capacity_] = data[i];
+  this->used_ += length;
+}
+
+void CaptureBuffer::drop_oldest_() {
+  uint8_t flags = this->buffer_[(this->head_ + HEADER_LENGTH - 1) % this->capacity_];
+  size_t record_length = HEADER_LENGTH + (flags & MAX_DATA_LENGTH);
+  this->head_ = (this->head_ + record_length) % this->capacity_;
+  this->used_ -= record_length;
+  this->records_--;
+  this->dropped_++;
+}
+
+}  // namespace powermust
+}  // namespace esphome
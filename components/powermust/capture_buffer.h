@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace powermust {
+
+// Captura en crudo del tráfico de la UART para reproducir fallos de campo.
+//
+// Buffer circular de registros de longitud variable; cuando no cabe uno nuevo se
+// descartan los más antiguos. Cada registro es (little endian):
+//
+//   timestamp 32   (micros() al enviar o leer)
+//   flags 8        (bit 7: 1 = TX, 0 = RX; bits 0-6: longitud)
+//   data           (bytes tal cual, TX incluye el '\r')
+//
+// RX guarda cada lectura en bloque de la UART antes del reensamblado, de modo que los
+// espacios raros, los NAK y las tramas cortadas se conservan exactamente como llegaron.
+class CaptureBuffer {
+ public:
+  static const size_t HEADER_LENGTH = 5;
+  static const uint8_t MAX_DATA_LENGTH = 127;
+  static const uint8_t FLAG_TX = 0x80;
+
+  // Reserva el buffer; se llama desde la configuración generada, antes de setup()
+  void set_capacity(size_t capacity);
+  size_t capacity() const { return this->capacity_; }
+
+  // Las lecturas de más de MAX_DATA_LENGTH bytes se parten en varios registros
+  void add(bool tx, const uint8_t *data, size_t length, uint32_t timestamp);
+  void clear();
+
+  size_t size() const { return this->used_; }  // Bytes
+  uint32_t records() const { return this->records_; }
+  uint32_t dropped() const { return this->dropped_; }
+  // Copia hasta max bytes a partir de offset, contado desde el registro más antiguo
+  size_t read(size_t offset, uint8_t *out, size_t max) const;
+
+ protected:
+  void put_(const uint8_t *data, size_t length);
+  void drop_oldest_();
+
+  uint8_t *buffer_{nullptr};
+  size_t capacity_{0};
+  size_t head_{0};  // Primer byte del registro más antiguo
+  size_t used_{0};
+  uint32_t records_{0};
+  uint32_t dropped_{0};
+};
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace powermust {
+
+// Paso de una secuencia: el comando y el bit de estado del Q1 que confirma que el SAI lo
+// ha ejecutado. Con expect_mask = 0 basta con el ACK.
+struct SequenceStep {
+  const char *command;
+  uint8_t expect_mask;   // Bits del Q1 que se comprueban (Q1Status)
+  uint8_t expect_value;  // Valor esperado de esos bits
+  uint32_t timeout;      // ms desde que se encola el comando hasta verificarlo
+};
+
+// Lista ordenada de comandos que Powermust ejecuta seguidos, verificando cada paso con
+// un Q1 inmediato. Si un paso falla se envían los comandos de vuelta atrás (C, CT...),
+// sin verificar. Se declara en la configuración; los textos son literales del código
+// generado y no se copian.
+class CommandSequence {
+ public:
+  static const uint8_t MAX_STEPS = 8;
+  static const uint8_t MAX_ROLLBACK_COMMANDS = 4;
+
+  explicit CommandSequence(const char *name) : name_(name) {}
+
+  void add_step(const char *command, uint8_t expect_mask, uint8_t expect_value, uint32_t timeout) {
+    if (this->steps_count_ < MAX_STEPS)
+      this->steps_[this->steps_count_++] = {command, expect_mask, expect_value, timeout};
+  }
+  void add_rollback(const char *command) {
+    if (this->rollback_count_ < MAX_ROLLBACK_COMMANDS)
+      this->rollback_[this->rollback_count_++] = command;
+  }
+
+  const char *get_name() const { return this->name_; }
+  uint8_t steps() const { return this->steps_count_; }
+  const SequenceStep &step(uint8_t index) const { return this->steps_[index]; }
+  uint8_t rollback_commands() const { return this->rollback_count_; }
+  const char *rollback_command(uint8_t index) const { return this->rollback_[index]; }
+
+ protected:
+  const char *name_;
+  SequenceStep steps_[MAX_STEPS]{};
+  uint8_t steps_count_{0};
+  const char *rollback_[MAX_ROLLBACK_COMMANDS]{};
+  uint8_t rollback_count_{0};
+};
+
+// Resultado que reciben on_sequence_finished y el sensor sequence_result
+struct SequenceResult {
+  const CommandSequence *sequence;
+  bool success;
+  uint8_t failed_step;  // 1..n; 0 si ha terminado bien
+  const char *reason;   // Por qué ha fallado el paso; nullptr si ha terminado bien
+};
+
+}  // namespace powermust
+}  // namespace esphome
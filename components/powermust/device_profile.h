@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace powermust {
+
+enum ProfileCapability : uint8_t {
+  PROFILE_HAS_F = 1 << 0,            // Responde a F (valores nominales)
+  PROFILE_HAS_I = 1 << 1,            // Responde a I (identificación)
+  PROFILE_HAS_TEMPERATURE = 1 << 2,  // El Q1 trae temperatura
+};
+
+// Perfil del SAI guardado en preferencias. Se identifica por el hash de la respuesta I
+// (o de la F si el SAI no responde a I): si en una reconexión cambia, es otro SAI.
+struct DeviceProfile {
+  static const uint8_t IDENTITY_LENGTH = 47;
+
+  uint32_t key;  // 0 = sin perfil
+  uint8_t capabilities;
+  uint16_t rejected_commands;  // Bits por CommandId que el SAI ha contestado con NAK
+  float ac_output_rating_voltage;
+  int ac_output_rating_current;
+  float battery_rating_voltage;
+  float ac_output_rating_frequency;
+  char identity[IDENTITY_LENGTH + 1];
+  uint32_t f_hash;  // Hash de la respuesta F, clave si no hay respuesta I
+};
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,93 @@
+#include "frame_assembler.h"
+#include <cstring>
+
+namespace esphome {
+namespace powermust {
+
+static_assert((FrameAssembler::RING_LENGTH & (FrameAssembler::RING_LENGTH - 1)) == 0,
+              "RING_LENGTH debe ser potencia de dos");
+
+size_t FrameAssembler::write_capacity() const {
+  size_t used = this->head_ - this->tail_;
+  size_t until_wrap = RING_LENGTH - (this->head_ & (RING_LENGTH - 1));
+  size_t free = RING_LENGTH - used;
+  return free < until_wrap ? free : until_wrap;
+}
+
+bool FrameAssembler::assemble() {
+  if (this->complete_) {
+    this->frame_length_ = 0;
+    this->complete_ = false;
+  }
+
+  while (this->tail_ != this->head_) {
+    uint8_t byte = this->ring_[this->tail_++ & (RING_LENGTH - 1)];
+
+    if (byte == '(' || byte == '#') {
+      // Inicio de una respuesta: lo que hubiera antes era una trama truncada
+      this->discard_frame_();
+      this->resync_ = false;
+    } else if (this->resync_) {
+      this->discarded_bytes_++;
+      if (byte == '\r')
+        this->resync_ = false;
+      continue;
+    }
+
+    // Se reserva un byte para el terminador '\0'
+    if (this->frame_length_ >= FRAME_LENGTH - 1) {
+      this->overflows_++;
+      this->discard_frame_();
+      this->discarded_bytes_++;
+      this->resync_ = byte != '\r';
+      continue;
+    }
+
+    this->frame_[this->frame_length_++] = byte;
+    if (byte == '\r') {
+      this->frame_[this->frame_length_] = '\0';
+      this->complete_ = true;
+      this->frames_++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void FrameAssembler::clear() {
+  this->discarded_bytes_ += this->head_ - this->tail_;
+  this->tail_ = this->head_;
+  if (!this->complete_)
+    this->discard_frame_();
+  this->frame_length_ = 0;
+  this->complete_ = false;
+  this->resync_ = false;
+}
+
+void FrameAssembler::load(const uint8_t *frame, size_t length) {
+  if (length > FRAME_LENGTH - 1)
+    length = FRAME_LENGTH - 1;
+  memcpy(this->frame_, frame, length);
+  this->frame_[length] = '\0';
+  this->frame_length_ = length;
+  this->complete_ = true;
+  this->frames_++;
+}
+
+void FrameAssembler::discard_frame_() {
+  this->discarded_bytes_ += this->frame_length_;
+  this->frame_length_ = 0;
+}
+
+bool frame_matches(const uint8_t *frame, size_t length, char expect) {
+  if (length == 0)
+    return false;
+  if (expect == 0)
+    return frame[0] != '(' && frame[0] != '#';
+  if (length >= 4 && memcmp(frame, "(NAK", 4) == 0)
+    return true;
+  return frame[0] == expect;
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace powermust {
+
+// Reensambla tramas Megatec terminadas en '\r' a partir de un buffer circular.
+//
+// El buffer circular se llena con lecturas en bloque (read_array) directamente sobre
+// el hueco contiguo libre, de modo que los bytes que llegan en la misma ráfaga no se
+// pierden y las tramas parciales sobreviven entre llamadas a loop(). La trama se
+// resincroniza en los delimitadores '(' / '#' (inicio de respuesta) y '\r' (fin).
+class FrameAssembler {
+ public:
+  static const size_t RING_LENGTH = 128;  // Potencia de dos
+  static const size_t FRAME_LENGTH = 110;
+
+  // Hueco contiguo libre del buffer circular para leer en bloque.
+  uint8_t *write_pointer() { return this->ring_ + (this->head_ & (RING_LENGTH - 1)); }
+  size_t write_capacity() const;
+  void commit_write(size_t length) { this->head_ += length; }
+
+  // Consume bytes del buffer circular hasta completar una trama. Devuelve true si
+  // frame() contiene una trama completa, válida hasta la siguiente llamada.
+  bool assemble();
+  // Descarta la trama parcial y todos los bytes pendientes.
+  void clear();
+
+  // Trama completa ensamblada en otro sitio (tarea de transporte); queda en frame()
+  // hasta la siguiente llamada a assemble() o load().
+  void load(const uint8_t *frame, size_t length);
+
+  const uint8_t *frame() const { return this->frame_; }
+  size_t frame_length() const { return this->frame_length_; }
+  size_t pending() const { return this->head_ - this->tail_; }
+
+  uint32_t frames() const { return this->frames_; }
+  uint32_t discarded_bytes() const { return this->discarded_bytes_; }
+  uint32_t overflows() const { return this->overflows_; }
+
+ protected:
+  void discard_frame_();
+
+  uint8_t ring_[RING_LENGTH];
+  size_t head_{0};
+  size_t tail_{0};
+
+  uint8_t frame_[FRAME_LENGTH];
+  size_t frame_length_{0};
+  bool complete_{false};
+  bool resync_{false};
+
+  uint32_t frames_{0};
+  uint32_t discarded_bytes_{0};
+  uint32_t overflows_{0};
+};
+
+// Comprueba si una trama es la respuesta esperada. Las respuestas a Q1 empiezan por '('
+// y las de F/I por '#'; "(NAK" responde a cualquier polling. Con expect = 0 se espera el
+// ACK/NAK de un comando, que no empieza por ninguno de los dos. Una trama que no encaja
+// es una respuesta tardía a una petición anterior.
+bool frame_matches(const uint8_t *frame, size_t length, char expect);
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,52 @@
+#include "instrumentation.h"
+#include "esphome/core/hal.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace esphome {
+namespace powermust {
+
+void LatencyHistogram::add(uint32_t value) {
+  uint8_t bucket = 0;
+  while (bucket < BUCKETS - 1 && value >= (2UL << bucket))
+    bucket++;
+  this->counts[bucket]++;
+  this->samples++;
+  this->sum += value;
+  if (value > this->max)
+    this->max = value;
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t percent) const {
+  if (this->samples == 0)
+    return 0;
+  uint32_t target = ((uint64_t) this->samples * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t bucket = 0; bucket < BUCKETS; bucket++) {
+    seen += this->counts[bucket];
+    if (seen >= target) {
+      uint32_t upper = (2UL << bucket) - 1;
+      return upper < this->max ? upper : this->max;
+    }
+  }
+  return this->max;
+}
+
+void LatencyHistogram::format(char *buffer, size_t length) const {
+  int written = snprintf(buffer, length, "n=%" PRIu32 " avg=%.0f p50=%" PRIu32 " p95=%" PRIu32 " max=%" PRIu32 " ms [",
+                         this->samples, this->average(), this->percentile(50), this->percentile(95), this->max);
+  for (uint8_t bucket = 0; bucket < BUCKETS && written > 0 && (size_t) written < length; bucket++) {
+    written += snprintf(buffer + written, length - written, bucket == 0 ? "%" PRIu32 : " %" PRIu32,
+                        this->counts[bucket]);
+  }
+  if (written > 0 && (size_t) written < length)
+    snprintf(buffer + written, length - written, "]");
+}
+
+LoopTimer::Scope::Scope(LoopTimer &timer) : timer_(timer), start_(micros()) {}
+
+LoopTimer::Scope::~Scope() { this->timer_.add(micros() - this->start_); }
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace powermust {
+
+// Histograma de latencias con cubetas log2 fijas: la cubeta 0 cuenta 0-1 ms y la
+// cubeta i (i > 0) cuenta [2^i, 2^(i+1)) ms; la última acumula todo lo que no cabe.
+struct LatencyHistogram {
+  static const uint8_t BUCKETS = 13;  // Hasta 4096 ms y más
+
+  uint32_t counts[BUCKETS]{};
+  uint32_t samples{0};
+  uint32_t max{0};
+  uint64_t sum{0};
+
+  void add(uint32_t value);
+  float average() const { return this->samples > 0 ? (float) this->sum / this->samples : 0.0f; }
+  // Límite superior de la cubeta que alcanza el percentil, acotado por el máximo visto
+  uint32_t percentile(uint8_t percent) const;
+  // "n=.. avg=.. p50=.. p95=.. max=.. ms [c0 c1 ...]" en buffer
+  void format(char *buffer, size_t length) const;
+};
+
+// Tiempo de ejecución de loop() en µs: media y máximo de la ventana actual
+struct LoopTimer {
+  // Mide el ámbito en el que se declara
+  class Scope {
+   public:
+    explicit Scope(LoopTimer &timer);
+    ~Scope();
+
+   protected:
+    LoopTimer &timer_;
+    uint32_t start_;
+  };
+
+  uint32_t calls{0};
+  uint64_t sum{0};
+  uint32_t max{0};
+
+  void add(uint32_t elapsed) {
+    this->calls++;
+    this->sum += elapsed;
+    if (elapsed > this->max)
+      this->max = elapsed;
+  }
+  float average() const { return this->calls > 0 ? (float) this->sum / this->calls : 0.0f; }
+  void reset() { *this = {}; }
+};
+
+}  // namespace powermust
+}  // namespace esphome
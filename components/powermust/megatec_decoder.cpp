@@ -0,0 +1,153 @@
+#include "megatec_decoder.h"
+
+#include <cmath>
+
+namespace esphome {
+namespace powermust {
+
+// Tokenizador de una sola pasada sobre la trama recibida, sin copias ni sscanf.
+
+static const float POW10[] = {1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f, 100000.0f};
+
+static void skip_spaces(const uint8_t *&pos, const uint8_t *end) {
+  while (pos < end && *pos == ' ')
+    pos++;
+}
+
+// Lee un decimal en coma fija ("232.4", "003", "12.00"). Los marcadores "--.-" y "?.?"
+// que envían algunos SAI cuando no miden el valor se devuelven como NAN. Sin convert solo
+// se valida: en el ESP8266 la división en coma flotante es por software.
+static bool parse_decimal(const uint8_t *&pos, const uint8_t *end, float *value, bool convert) {
+  skip_spaces(pos, end);
+  const uint8_t *start = pos;
+  bool negative = false;
+  bool placeholder = false;
+  uint32_t mantissa = 0;
+  uint8_t digits = 0;
+  int8_t decimals = -1;
+
+  if (pos < end && *pos == '-' && pos + 1 < end && pos[1] >= '0' && pos[1] <= '9') {
+    negative = true;
+    pos++;
+  }
+  for (; pos < end && *pos != ' '; pos++) {
+    uint8_t c = *pos;
+    if (c >= '0' && c <= '9') {
+      if (++digits > 9)
+        return false;
+      mantissa = mantissa * 10 + (c - '0');
+      if (decimals >= 0)
+        decimals++;
+    } else if (c == '.' && decimals < 0) {
+      decimals = 0;
+    } else if (c == '-' || c == '?' || c == '.') {
+      placeholder = true;
+    } else {
+      return false;
+    }
+  }
+  if (pos == start)
+    return false;
+  if (placeholder) {
+    if (digits > 0)
+      return false;
+    *value = NAN;
+    return true;
+  }
+  if (digits == 0 || decimals >= (int8_t) (sizeof(POW10) / sizeof(POW10[0])))
+    return false;
+  if (!convert) {
+    *value = NAN;
+    return true;
+  }
+
+  float result = decimals > 0 ? mantissa / POW10[decimals] : (float) mantissa;
+  *value = negative ? -result : result;
+  return true;
+}
+
+static bool parse_integer(const uint8_t *&pos, const uint8_t *end, int *value, bool convert) {
+  skip_spaces(pos, end);
+  uint32_t result = 0;
+  uint8_t digits = 0;
+  for (; pos < end && *pos != ' '; pos++) {
+    if (*pos < '0' || *pos > '9' || ++digits > 9)
+      return false;
+    result = result * 10 + (*pos - '0');
+  }
+  if (digits == 0)
+    return false;
+  *value = convert ? (int) result : 0;
+  return true;
+}
+
+// Quita el '\r' final y comprueba el carácter de inicio
+static bool frame_bounds(const uint8_t *frame, size_t length, uint8_t start, const uint8_t *&pos,
+                         const uint8_t *&end) {
+  if (frame == nullptr || length == 0 || frame[0] != start)
+    return false;
+  pos = frame + 1;
+  end = frame + length;
+  if (end[-1] == '\r')
+    end--;
+  return true;
+}
+
+uint8_t decode_q1(const uint8_t *frame, size_t length, Q1Sample *sample, uint8_t fields) {
+  const uint8_t *pos;
+  const uint8_t *end;
+  if (!frame_bounds(frame, length, '(', pos, end))
+    return 0;
+
+  if (!parse_decimal(pos, end, &sample->grid_voltage, fields & Q1_FIELD_GRID_VOLTAGE))
+    return 0;
+  if (!parse_decimal(pos, end, &sample->grid_fault_voltage, fields & Q1_FIELD_GRID_FAULT_VOLTAGE))
+    return 1;
+  if (!parse_decimal(pos, end, &sample->ac_output_voltage, fields & Q1_FIELD_AC_OUTPUT_VOLTAGE))
+    return 2;
+  if (!parse_integer(pos, end, &sample->ac_output_load_percent, fields & Q1_FIELD_AC_OUTPUT_LOAD_PERCENT))
+    return 3;
+  if (!parse_decimal(pos, end, &sample->grid_frequency, fields & Q1_FIELD_GRID_FREQUENCY))
+    return 4;
+  if (!parse_decimal(pos, end, &sample->battery_voltage, fields & Q1_FIELD_BATTERY_VOLTAGE))
+    return 5;
+  if (!parse_decimal(pos, end, &sample->temperature, fields & Q1_FIELD_TEMPERATURE))
+    return 6;
+
+  // Bits de estado: b7..b0 = utility fail, battery low, bypass, UPS failed, standby, test, shutdown, beeper
+  skip_spaces(pos, end);
+  uint8_t bits = 0;
+  uint8_t status = 0;
+  for (; pos < end && *pos != ' '; pos++, bits++) {
+    if ((*pos != '0' && *pos != '1') || bits >= 8)
+      return 7;
+    if (*pos == '1')
+      status |= 0x80 >> bits;
+  }
+  if (bits == 0)
+    return 7;
+  sample->status = status;
+
+  return Q1_FIELD_COUNT;
+}
+
+uint8_t decode_f(const uint8_t *frame, size_t length, FSample *sample) {
+  const uint8_t *pos;
+  const uint8_t *end;
+  if (!frame_bounds(frame, length, '#', pos, end))
+    return 0;
+
+  if (!parse_decimal(pos, end, &sample->ac_output_rating_voltage, true))
+    return 0;
+  if (!parse_integer(pos, end, &sample->ac_output_rating_current, true))
+    return 1;
+  if (!parse_decimal(pos, end, &sample->battery_rating_voltage, true))
+    return 2;
+  if (!parse_decimal(pos, end, &sample->ac_output_rating_frequency, true))
+    return 3;
+
+  return F_FIELD_COUNT;
+}
+
+}  // namespace powermust
+}  // namespace esphome
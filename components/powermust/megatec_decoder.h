@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace powermust {
+
+// Decodificadores de las respuestas Megatec, sin estado ni dependencias de ESPHome.
+//
+// Reciben la trama tal cual sale del FrameAssembler (con o sin el '\r' final) y no leen
+// fuera de [frame, frame + length). Devuelven el número de campos decodificados: la
+// muestra solo es válida si es el total del tipo de trama, y si no lo es el valor
+// indica el primer campo erróneo.
+
+static const uint8_t Q1_FIELD_COUNT = 8;
+static const uint8_t F_FIELD_COUNT = 4;
+
+// Bits de estado del Q1
+enum Q1Status : uint8_t {
+  Q1_STATUS_UTILITY_FAIL = 1 << 7,
+  Q1_STATUS_BATTERY_LOW = 1 << 6,
+  Q1_STATUS_BYPASS_ACTIVE = 1 << 5,
+  Q1_STATUS_UPS_FAILED = 1 << 4,
+  Q1_STATUS_UPS_TYPE_STANDBY = 1 << 3,
+  Q1_STATUS_TEST_IN_PROGRESS = 1 << 2,
+  Q1_STATUS_SHUTDOWN_ACTIVE = 1 << 1,
+  Q1_STATUS_BEEPER_ON = 1 << 0,
+};
+
+// Campos numéricos del Q1 que se convierten. Los demás se validan igual, pero no se
+// convierten: valen NAN, o 0 la carga. Los bits de estado se decodifican siempre.
+enum Q1Field : uint8_t {
+  Q1_FIELD_GRID_VOLTAGE = 1 << 0,
+  Q1_FIELD_GRID_FAULT_VOLTAGE = 1 << 1,
+  Q1_FIELD_AC_OUTPUT_VOLTAGE = 1 << 2,
+  Q1_FIELD_AC_OUTPUT_LOAD_PERCENT = 1 << 3,
+  Q1_FIELD_GRID_FREQUENCY = 1 << 4,
+  Q1_FIELD_BATTERY_VOLTAGE = 1 << 5,
+  Q1_FIELD_TEMPERATURE = 1 << 6,
+  Q1_ALL_FIELDS = 0x7F,
+};
+
+// "(MMM.M NNN.N PPP.P QQQ RR.R S.SS TT.T b7b6b5b4b3b2b1b0"
+struct Q1Sample {
+  float grid_voltage;
+  float grid_fault_voltage;
+  float ac_output_voltage;
+  int ac_output_load_percent;
+  float grid_frequency;
+  float battery_voltage;
+  float temperature;  // NAN si el SAI no la mide ("--.-")
+  uint8_t status;     // Bits b7..b0 del Q1, b7 = utility fail; los que falten valen 0
+};
+
+// "#RRR.R QQQ SS.SS FF.F"
+struct FSample {
+  float ac_output_rating_voltage;
+  int ac_output_rating_current;
+  float battery_rating_voltage;
+  float ac_output_rating_frequency;
+};
+
+uint8_t decode_q1(const uint8_t *frame, size_t length, Q1Sample *sample, uint8_t fields = Q1_ALL_FIELDS);
+uint8_t decode_f(const uint8_t *frame, size_t length, FSample *sample);
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,129 @@
+#include "power_quality.h"
+
+#include <cstring>
+
+namespace esphome {
+namespace powermust {
+
+const char *power_quality_event_name(PowerQualityEventType type) {
+  switch (type) {
+    case POWER_QUALITY_EVENT_SAG:
+      return "sag";
+    case POWER_QUALITY_EVENT_SWELL:
+      return "swell";
+    case POWER_QUALITY_EVENT_INTERRUPTION:
+      return "interruption";
+    case POWER_QUALITY_EVENT_FREQUENCY:
+      return "frequency";
+    default:
+      return "unknown";
+  }
+}
+
+void PowerQualityMonitor::set_thresholds(float sag, float swell, float frequency_deviation) {
+  this->sag_ = sag;
+  this->swell_ = swell;
+  this->frequency_deviation_ = frequency_deviation;
+}
+
+void PowerQualityMonitor::set_nominal(float voltage, float frequency) {
+  this->nominal_voltage_ = voltage;
+  this->nominal_frequency_ = frequency;
+  this->nominal_configured_ = true;
+}
+
+void PowerQualityMonitor::set_rated(float voltage, float frequency) {
+  if (this->nominal_configured_)
+    return;
+  this->nominal_voltage_ = voltage;
+  this->nominal_frequency_ = frequency;
+}
+
+void PowerQualityMonitor::add(const Q1Sample &sample, uint32_t now) {
+  if (!this->window_started_) {
+    this->window_start_ = now;
+    this->window_started_ = true;
+  }
+
+  // Los eventos que se cierran con esta muestra cuentan en la ventana actual
+  this->update_voltage_(sample.grid_voltage, now);
+  this->update_frequency_(sample.grid_frequency, now);
+
+  this->current_[POWER_QUALITY_METRIC_VOLTAGE].add(sample.grid_voltage);
+  this->current_[POWER_QUALITY_METRIC_FAULT_VOLTAGE].add(sample.grid_fault_voltage);
+  this->current_[POWER_QUALITY_METRIC_FREQUENCY].add(sample.grid_frequency);
+
+  if (now - this->window_start_ < this->window_)
+    return;
+  for (uint8_t metric = 0; metric < POWER_QUALITY_METRIC_COUNT; metric++) {
+    this->completed_[metric] = this->current_[metric];
+    this->current_[metric].reset();
+  }
+  memcpy(this->completed_events_, this->current_events_, sizeof(this->completed_events_));
+  memset(this->current_events_, 0, sizeof(this->current_events_));
+  this->completed_length_ = now - this->window_start_;
+  this->window_start_ = now;
+  this->windows_++;
+}
+
+void PowerQualityMonitor::update_voltage_(float voltage, uint32_t now) {
+  // Sin nominal no hay límites; un campo desconocido no abre ni cierra eventos
+  if (std::isnan(voltage) || std::isnan(this->nominal_voltage_))
+    return;
+  float sag = this->nominal_voltage_ * (1.0f - this->sag_);
+  float swell = this->nominal_voltage_ * (1.0f + this->swell_);
+  float hysteresis = this->nominal_voltage_ * VOLTAGE_HYSTERESIS;
+
+  Excursion &excursion = this->voltage_;
+  if (excursion.active) {
+    if (excursion.type == POWER_QUALITY_EVENT_SAG) {
+      if (voltage < excursion.extreme)
+        excursion.extreme = voltage;
+      if (voltage >= sag + hysteresis)
+        this->close_(excursion, now);
+    } else {
+      if (voltage > excursion.extreme)
+        excursion.extreme = voltage;
+      if (voltage <= swell - hysteresis)
+        this->close_(excursion, now);
+    }
+  }
+  // Un hueco puede acabar directamente en una sobretensión
+  if (!excursion.active && (voltage < sag || voltage > swell))
+    excursion = {true, voltage < sag ? POWER_QUALITY_EVENT_SAG : POWER_QUALITY_EVENT_SWELL, now, voltage};
+}
+
+void PowerQualityMonitor::update_frequency_(float frequency, uint32_t now) {
+  if (std::isnan(frequency) || std::isnan(this->nominal_frequency_))
+    return;
+  float deviation = std::fabs(frequency - this->nominal_frequency_);
+
+  Excursion &excursion = this->frequency_;
+  if (excursion.active) {
+    if (deviation > std::fabs(excursion.extreme - this->nominal_frequency_))
+      excursion.extreme = frequency;
+    if (deviation <= this->frequency_deviation_ - FREQUENCY_HYSTERESIS)
+      this->close_(excursion, now);
+    return;
+  }
+  if (deviation > this->frequency_deviation_)
+    excursion = {true, POWER_QUALITY_EVENT_FREQUENCY, now, frequency};
+}
+
+void PowerQualityMonitor::close_(Excursion &excursion, uint32_t now) {
+  PowerQualityEventType type = excursion.type;
+  if (type == POWER_QUALITY_EVENT_SAG && excursion.extreme < this->nominal_voltage_ * INTERRUPTION_THRESHOLD)
+    type = POWER_QUALITY_EVENT_INTERRUPTION;
+
+  PowerQualityEvent &event = this->event_log_[this->events_written_ % EVENT_LOG_LENGTH];
+  event.start = excursion.start;
+  event.duration = now - excursion.start;
+  event.extreme = excursion.extreme;
+  event.type = type;
+  this->events_written_++;
+  this->current_events_[type]++;
+  excursion.active = false;
+}
+
+}  // namespace powermust
+}  // namespace esphome
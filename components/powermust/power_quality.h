@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "megatec_decoder.h"
+#include "running_stats.h"
+
+namespace esphome {
+namespace powermust {
+
+enum PowerQualityEventType : uint8_t {
+  POWER_QUALITY_EVENT_SAG = 0,
+  POWER_QUALITY_EVENT_SWELL = 1,
+  POWER_QUALITY_EVENT_INTERRUPTION = 2,
+  POWER_QUALITY_EVENT_FREQUENCY = 3,
+  POWER_QUALITY_EVENT_COUNT = 4,
+};
+
+enum PowerQualityMetric : uint8_t {
+  POWER_QUALITY_METRIC_VOLTAGE = 0,        // grid_voltage
+  POWER_QUALITY_METRIC_FAULT_VOLTAGE = 1,  // grid_fault_voltage
+  POWER_QUALITY_METRIC_FREQUENCY = 2,      // grid_frequency
+  POWER_QUALITY_METRIC_COUNT = 3,
+};
+
+struct PowerQualityEvent {
+  uint32_t start;     // millis() del primer Q1 fuera de los límites
+  uint32_t duration;  // ms hasta el primer Q1 de vuelta dentro
+  float extreme;      // V o Hz más alejado del nominal
+  PowerQualityEventType type;
+};
+
+// Análisis de la red en streaming sobre las muestras Q1, sin guardarlas.
+//
+// Por cada ventana se acumulan mínimo, máximo, media y desviación de la tensión de red,
+// la tensión de fallo y la frecuencia. Huecos (sag), sobretensiones (swell) y desvíos de
+// frecuencia respecto al nominal abren un evento que se cierra, con histéresis, en el
+// primer Q1 de vuelta dentro de los límites. Un hueco por debajo del 10 % del nominal se
+// registra como corte. Los eventos cerrados van a un registro circular de tamaño fijo.
+//
+// La resolución temporal es la del polling: un hueco más corto que el intervalo de Q1
+// puede pasar desapercibido.
+class PowerQualityMonitor {
+ public:
+  static const size_t EVENT_LOG_LENGTH = 16;
+  static constexpr float INTERRUPTION_THRESHOLD = 0.1f;  // Fracción del nominal (IEC 61000-4-30)
+  static constexpr float VOLTAGE_HYSTERESIS = 0.02f;     // Fracción del nominal
+  static constexpr float FREQUENCY_HYSTERESIS = 0.1f;    // Hz
+
+  void set_window(uint32_t window) { this->window_ = window; }
+  uint32_t get_window() const { return this->window_; }
+  // Fracciones del nominal para la tensión, Hz para la frecuencia
+  void set_thresholds(float sag, float swell, float frequency_deviation);
+  // Nominal fijado en la configuración; tiene prioridad sobre los valores nominales del F
+  void set_nominal(float voltage, float frequency);
+  void set_rated(float voltage, float frequency);
+  float get_nominal_voltage() const { return this->nominal_voltage_; }
+  float get_nominal_frequency() const { return this->nominal_frequency_; }
+
+  void add(const Q1Sample &sample, uint32_t now);
+
+  // Ventanas completadas desde el arranque y resumen de la última
+  uint32_t windows() const { return this->windows_; }
+  const RunningStats &window_stats(PowerQualityMetric metric) const { return this->completed_[metric]; }
+  uint16_t window_events(PowerQualityEventType type) const { return this->completed_events_[type]; }
+  uint32_t window_length() const { return this->completed_length_; }
+
+  // Eventos cerrados desde el arranque; solo los últimos EVENT_LOG_LENGTH siguen en el registro
+  uint32_t events() const { return this->events_written_; }
+  const PowerQualityEvent &event(uint32_t index) const { return this->event_log_[index % EVENT_LOG_LENGTH]; }
+
+ protected:
+  struct Excursion {
+    bool active;
+    PowerQualityEventType type;
+    uint32_t start;
+    float extreme;
+  };
+
+  void update_voltage_(float voltage, uint32_t now);
+  void update_frequency_(float frequency, uint32_t now);
+  void close_(Excursion &excursion, uint32_t now);
+
+  uint32_t window_{300000};
+  float sag_{0.1f};
+  float swell_{0.1f};
+  float frequency_deviation_{0.5f};
+  float nominal_voltage_{NAN};
+  float nominal_frequency_{NAN};
+  bool nominal_configured_{false};
+
+  Excursion voltage_{};
+  Excursion frequency_{};
+
+  RunningStats current_[POWER_QUALITY_METRIC_COUNT];
+  RunningStats completed_[POWER_QUALITY_METRIC_COUNT];
+  uint16_t current_events_[POWER_QUALITY_EVENT_COUNT]{};
+  uint16_t completed_events_[POWER_QUALITY_EVENT_COUNT]{};
+  uint32_t window_start_{0};
+  uint32_t completed_length_{0};
+  uint32_t windows_{0};
+  bool window_started_{false};
+
+  PowerQualityEvent event_log_[EVENT_LOG_LENGTH]{};
+  uint32_t events_written_{0};
+};
+
+const char *power_quality_event_name(PowerQualityEventType type);
+
+}  // namespace powermust
+}  // namespace esphome
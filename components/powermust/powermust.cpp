@@ -1,38 +1,261 @@
 #include "powermust.h"
 #include "esphome/core/log.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
 
 namespace esphome {
 namespace powermust {
 
 static const char *const TAG = "powermust";
 
+static const char *const Q1_FIELD_NAMES[] = {"grid voltage",   "grid fault voltage", "ac output voltage",
+                                             "load percent",   "grid frequency",     "battery voltage",
+                                             "temperature",    "status bits"};
+static const char *const F_FIELD_NAMES[] = {"rating voltage", "rating current", "battery voltage", "frequency"};
+
+// 32 bit FNV-1 sin pasar por std::string
+static uint32_t frame_hash(const char *data, size_t length) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < length; i++) {
+    hash *= 16777619UL;
+    hash ^= (uint8_t) data[i];
+  }
+  return hash;
+}
+
+// Inicio de la respuesta a un polling, para frame_matches()
+static char poll_reply_start(const PollingCommand &cmd) { return cmd.identifier == POLLING_Q1 ? '(' : '#'; }
+
+static const char *profile_name(const DeviceProfile &profile) {
+  return profile.identity[0] != '\0' ? profile.identity : "no identification";
+}
+
 void Powermust::setup() {
   this->state_ = STATE_IDLE;
   this->command_start_millis_ = 0;
+  this->setup_millis_ = millis();
+#ifdef USE_POWERMUST_TRANSPORT_TASK
+  if (this->transport_task_ && !this->transport_.start(&this->transport_stream_)) {
+    ESP_LOGE(TAG, "Could not start the UART transport task");
+    this->mark_failed();
+    return;
+  }
+#endif
+  PowermustBus::register_unit(this);
+  for (uint8_t id = 0; id < COMMAND_COUNT; id++)
+    this->command_rtt_[id] = RttEstimator(COMMAND_DESCRIPTORS[id].timeout);
+
+  this->set_interval("sample_rate", SAMPLE_RATE_WINDOW, [this]() {
+    this->sample_rate_value_ = this->q1_samples_ * 60000.0f / SAMPLE_RATE_WINDOW;
+    this->q1_samples_ = 0;
+    this->publish_state_(this->sample_rate_, this->sample_rate_value_);
+  });
+
+#ifdef USE_POWERMUST_INSTRUMENTATION
+  this->set_interval("instrumentation", INSTRUMENTATION_INTERVAL, [this]() { this->publish_instrumentation_(); });
+#endif
+
+  // La estimación de autonomía necesita la tensión nominal de la batería (F)
+  this->runtime_estimation_ = this->estimated_runtime_ != nullptr || this->state_of_charge_ != nullptr;
+  if (this->runtime_estimation_) {
+    this->add_polling_command_("F", POLLING_F);
+    this->runtime_model_pref_ = global_preferences->make_preference<RuntimeModel>(
+        fnv1_hash("powermust_runtime_model") ^ this->preference_key_, true);
+    RuntimeModel model;
+    if (this->runtime_model_pref_.load(&model) && model.full_load_runtime > 0.0f) {
+      this->runtime_estimator_.set_model(model);
+    }
+  }
+
+  if (this->device_profile_) {
+    // La exploración inicial siempre incluye F e I
+    this->add_polling_command_("F", POLLING_F);
+    this->profile_pref_ = global_preferences->make_preference<DeviceProfile>(
+        fnv1_hash("powermust_device_profile") ^ this->preference_key_, true);
+  }
+
+#ifdef USE_POWERMUST_SEQUENCES
+  // Los pasos de las secuencias se verifican con el Q1
+  this->add_polling_command_("Q1", POLLING_Q1);
+#endif
 
   // Añadimos polling automático para Q1, F e I
   // (Q1 y F ya están por los sensores, pero I lo añadimos aquí)
   this->add_polling_command_("I", POLLING_I);
+
+  for (auto &cmd : this->used_polling_commands_) {
+    if (cmd.length == 0)
+      continue;
+    const auto &schedule = this->polling_schedules_[cmd.identifier];
+    cmd.interval = schedule.interval;
+    cmd.priority = schedule.priority;
+    cmd.policy = schedule.policy;
+  }
+
+  if (this->device_profile_ && this->profile_pref_.load(&this->saved_profile_) && this->saved_profile_.key != 0) {
+    // Arranque en caliente: valores nominales de la caché y, de los datos estáticos, solo la
+    // respuesta de la que sale la clave, para comprobar que el SAI sigue siendo el mismo
+    this->saved_profile_.identity[DeviceProfile::IDENTITY_LENGTH] = '\0';
+    this->profile_ = this->saved_profile_;
+    this->apply_device_profile_();
+    ENUMPollingCommand verify = (this->profile_.capabilities & PROFILE_HAS_I) ? POLLING_I : POLLING_F;
+    for (auto &cmd : this->used_polling_commands_) {
+      if (cmd.length > 0 && cmd.identifier != POLLING_Q1) {
+        cmd.pending = cmd.identifier == verify;
+        cmd.last_run = millis();
+      }
+    }
+    this->profile_verifying_ = true;
+    ESP_LOGI(TAG, "Warm start from cached profile '%s'", profile_name(this->profile_));
+  } else {
+    this->saved_profile_ = {};
+  }
+}
+
+// Vacía la UART en el buffer circular con lecturas en bloque
+void Powermust::read_uart_() {
+  size_t available;
+  while ((available = this->available()) > 0) {
+    size_t capacity = this->rx_.write_capacity();
+    if (capacity == 0)
+      return;
+    size_t length = available < capacity ? available : capacity;
+    if (!this->read_array(this->rx_.write_pointer(), length))
+      return;
+#ifdef USE_POWERMUST_CAPTURE
+    if (!this->capture_dumping_)
+      this->capture_.add(false, this->rx_.write_pointer(), length, micros());
+#endif
+    this->rx_.commit_write(length);
+  }
 }
 
+void Powermust::write_frame_(const char *command, size_t length) {
+  this->write_array((const uint8_t *) command, length);
+  this->write(0x0D);
+#ifdef USE_POWERMUST_CAPTURE
+  if (!this->capture_dumping_) {
+    uint8_t frame[CaptureBuffer::MAX_DATA_LENGTH];
+    length = std::min(length, (size_t) CaptureBuffer::MAX_DATA_LENGTH - 1);
+    memcpy(frame, command, length);
+    frame[length] = '\r';
+    this->capture_.add(true, frame, length + 1, micros());
+  }
+#endif
+}
+
+// Descarta todo lo recibido hasta ahora (respuestas obsoletas)
 void Powermust::empty_uart_buffer_() {
-  uint8_t byte;
-  while (this->available()) {
-    this->read_byte(&byte);
+  this->read_uart_();
+  while (this->rx_.pending() > 0) {
+    this->rx_.clear();
+    this->read_uart_();
+  }
+  this->rx_.clear();
+}
+
+// Vacía la entrada y envía el comando; con la tarea de transporte, se lo pasa a ella.
+// expect y timeout solo los usa la tarea: sin ella, loop() comprueba la respuesta.
+void Powermust::send_frame_(const char *command, size_t length, char expect, uint32_t timeout) {
+#ifdef USE_POWERMUST_TRANSPORT_TASK
+  if (this->transport_task_) {
+    this->transport_timed_out_ = false;
+    if (!this->transport_.send(command, length, expect, timeout)) {
+      // No debería pasar: nunca hay más de una petición en curso
+      ESP_LOGW(TAG, "Transport queue full, %s not sent", command);
+      this->transport_timed_out_ = true;
+    }
+    return;
+  }
+#endif
+  this->empty_uart_buffer_();
+  this->write_frame_(command, length);
+}
+
+// Siguiente trama completa en this->rx_
+bool Powermust::next_frame_() {
+#ifdef USE_POWERMUST_TRANSPORT_TASK
+  if (this->transport_task_) {
+    TransportReply reply;
+    bool waiting = this->state_ == STATE_POLL || this->state_ == STATE_COMMAND;
+    while (this->transport_.receive(reply)) {
+      this->transport_elapsed_ = reply.elapsed;
+      if (reply.type == TRANSPORT_REPLY_TIMEOUT) {
+        this->transport_timed_out_ = true;
+        return false;
+      }
+      // Tras un envío solo cuenta su respuesta; en reposo, las tardías
+      if ((reply.type == TRANSPORT_REPLY_FRAME) != waiting) {
+        ESP_LOGD(TAG, "Discarding stale frame: '%.*s'", (int) reply.length - 1, (const char *) reply.frame);
+        continue;
+      }
+      this->rx_.load(reply.frame, reply.length);
+      return true;
+    }
+    return false;
   }
+#endif
+  this->read_uart_();
+  return this->rx_.assemble();
+}
+
+// Tiempo de respuesta de la última petición. La tarea de transporte lo mide desde el envío
+// real, sin el retraso con el que loop() recoge la respuesta.
+uint32_t Powermust::reply_elapsed_() const {
+#ifdef USE_POWERMUST_TRANSPORT_TASK
+  if (this->transport_task_)
+    return this->transport_elapsed_;
+#endif
+  return millis() - this->command_start_millis_;
+}
+
+bool Powermust::reply_timed_out_(uint32_t timeout) const {
+#ifdef USE_POWERMUST_TRANSPORT_TASK
+  if (this->transport_task_)
+    return this->transport_timed_out_;
+#endif
+  return millis() - this->command_start_millis_ > timeout;
 }
 
 void Powermust::loop() {
+#ifdef USE_POWERMUST_INSTRUMENTATION
+  LoopTimer::Scope loop_timing(this->loop_timer_);
+#endif
+#ifdef USE_POWERMUST_HISTORY
+  // Un trozo por pasada para no bloquear el loop ni saturar la API
+  if (this->history_exporting_)
+    this->export_history_chunk_();
+#endif
+#ifdef USE_POWERMUST_CAPTURE
+  if (this->capture_dumping_)
+    this->dump_capture_chunk_();
+#endif
+
   // === Lectura de mensajes ===
   if (this->state_ == STATE_IDLE) {
-    this->empty_uart_buffer_();
+#ifdef USE_POWERMUST_SEQUENCES
+    this->check_sequence_timeout_();
+#endif
+    while (this->next_frame_()) {
+      if (this->poll_timed_out_ && this->frame_matches_poll_()) {
+        // Respuesta tardía al último polling: se decodifica en vez de perderla
+        ESP_LOGD(TAG, "Late reply to polling command accepted");
+        this->poll_timed_out_ = false;
+        this->state_ = STATE_POLL_COMPLETE;
+        return;
+      }
+      ESP_LOGV(TAG, "Discarding unsolicited frame (%u bytes)", (unsigned) this->rx_.frame_length());
+    }
+
     switch (this->send_next_command_()) {
       case 0:
-        // Cola vacía → polling
-        if (millis() - this->last_poll_ > this->update_interval_) {
-          this->send_next_poll_();
-          this->last_poll_ = millis();
-        }
+        // Cola vacía → polling del comando pendiente más prioritario
+        this->send_next_poll_();
+#ifdef USE_POWERMUST_EVENT_DRIVEN
+        if (this->event_driven_ && this->state_ == STATE_IDLE)
+          this->sleep_until_next_poll_();
+#endif
         return;
       case 1:
         // Comando enviado
@@ -42,37 +265,51 @@ void Powermust::loop() {
 
   // === Finalización de comando (ACK/NAK) ===
   if (this->state_ == STATE_COMMAND_COMPLETE) {
-    std::string current_cmd = this->command_queue_[this->command_queue_position_];
+    auto &queued = this->command_queue_[this->current_command_];
+    const CommandDescriptor &descriptor = COMMAND_DESCRIPTORS[queued.id];
     bool success = false;
+    const uint8_t *frame = this->rx_.frame();
+    size_t frame_length = this->command_timed_out_ ? 0 : this->rx_.frame_length();
+    if (frame_length > 0 && frame[frame_length - 1] == '\r')
+      frame_length--;
 
-    // Comandos que esperan ACK/NAK
-    bool is_ack_command = (
-        current_cmd == "T" ||
-        current_cmd == "TL" ||
-        current_cmd == "T10" ||
-        current_cmd == "CT" ||
-        current_cmd == "Q" ||
-        current_cmd == "C" ||
-        current_cmd == "CL" ||
-        (!current_cmd.empty() && current_cmd[0] == 'S')  // S03, S02R0060, etc.
-    );
-
-    if (is_ack_command) {
-      if (this->read_pos_ > 0) {
-        if (this->read_buffer_[this->read_pos_ - 1] == '\r') {
-          this->read_buffer_[--this->read_pos_] = '\0';
-        }
-        if (this->read_pos_ >= 3 && memcmp(this->read_buffer_, "NAK", 3) == 0) {
-          ESP_LOGE(TAG, "Command failed: NAK for '%s'", current_cmd.c_str());
+    if (descriptor.reply == REPLY_ACK) {
+      if (this->command_timed_out_) {
+        this->command_rtt_[queued.id].backoff();
+      } else if (queued.attempts == 1) {
+        this->command_rtt_[queued.id].add(this->reply_elapsed_());
+      }
+    }
+#ifdef USE_POWERMUST_INSTRUMENTATION
+    // Sin respuesta esperada, agotar la espera es el final normal del comando y no un timeout
+    if (descriptor.reply != REPLY_NONE) {
+      if (this->command_timed_out_) {
+        this->timeout_counter_++;
+      } else {
+        this->command_latency_histograms_[queued.id].add(this->reply_elapsed_());
+      }
+    }
+#endif
+    if (descriptor.reply == REPLY_ACK) {
+      if (frame_length > 0) {
+        if (frame_length >= 3 && memcmp(frame, "NAK", 3) == 0) {
+          ESP_LOGE(TAG, "Command failed: NAK for '%s'", queued.command);
+          if (this->device_profile_ && this->saved_profile_.key != 0) {
+            this->profile_.rejected_commands |= 1 << queued.id;
+            this->save_device_profile_();
+          }
+#ifdef USE_POWERMUST_INSTRUMENTATION
+          this->nak_counter_++;
+#endif
         } else {
-          ESP_LOGI(TAG, "Command successful: ACK for '%s'", current_cmd.c_str());
+          ESP_LOGI(TAG, "Command successful: ACK for '%s'", queued.command);
           success = true;
         }
       } else {
-        ESP_LOGE(TAG, "Command failed: no response for '%s'", current_cmd.c_str());
+        ESP_LOGE(TAG, "Command failed: no response for '%s'", queued.command);
       }
     } else {
-      if (this->read_pos_ == 0) {
+      if (frame_length == 0) {
         ESP_LOGI(TAG, "Command successful: no response expected");
         success = true;
       } else {
@@ -80,69 +317,101 @@ void Powermust::loop() {
       }
     }
 
-    // === Apagar switches momentáneos ===
-    if (success) {
-      if (current_cmd == "T" && this->quick_test_switch_) {
-        this->quick_test_switch_->publish_state(false);
-      } else if (current_cmd == "TL" && this->deep_test_switch_) {
-        this->deep_test_switch_->publish_state(false);
-      } else if (current_cmd == "T10" && this->ten_minutes_test_switch_) {
-        this->ten_minutes_test_switch_->publish_state(false);
-      } else if (current_cmd == "CT") {
-        if (this->quick_test_switch_) this->quick_test_switch_->publish_state(false);
-        if (this->deep_test_switch_) this->deep_test_switch_->publish_state(false);
-        if (this->ten_minutes_test_switch_) this->ten_minutes_test_switch_->publish_state(false);
-      } else if (current_cmd[0] == 'S') {
-        if (current_cmd.find("R") != std::string::npos && this->shutdown_restore_switch_) {
-          this->shutdown_restore_switch_->publish_state(false);
-        } else if (this->shutdown_switch_) {
-          this->shutdown_switch_->publish_state(false);
-        }
-      } else if (current_cmd == "C" && this->cancel_shutdown_switch_) {
-        this->cancel_shutdown_switch_->publish_state(false);
-      }
+    if (!success && this->command_timed_out_ && queued.attempts <= descriptor.retries) {
+      // Sin respuesta: se reenvía en la siguiente pasada por STATE_IDLE
+      ESP_LOGW(TAG, "Retrying '%s' (%u/%u)", queued.command, queued.attempts, descriptor.retries);
+      queued.in_flight = false;
+    } else {
+      // === Apagar switches momentáneos ===
+      if (success && descriptor.on_complete != nullptr)
+        (this->*descriptor.on_complete)();
+      // Limpiar cola
+#ifdef USE_POWERMUST_SEQUENCES
+      bool from_sequence = queued.from_sequence;
+#endif
+      this->remove_queued_command_(this->current_command_);
+#ifdef USE_POWERMUST_SEQUENCES
+      if (from_sequence)
+        this->sequence_command_complete_(success);
+#endif
     }
-
-    // Limpiar cola
-    this->command_queue_[this->command_queue_position_].clear();
-    this->command_queue_position_ = (this->command_queue_position_ + 1) % COMMAND_QUEUE_LENGTH;
     this->state_ = STATE_IDLE;
   }
 
   // === Publicar valores decodificados ===
   if (this->state_ == STATE_POLL_DECODED) {
+    this->poll_succeeded_();
     switch (this->used_polling_commands_[this->last_polling_command_].identifier) {
-      case POLLING_Q1:
-        if (this->grid_voltage_) this->grid_voltage_->publish_state(value_grid_voltage_);
-        if (this->grid_fault_voltage_) this->grid_fault_voltage_->publish_state(value_grid_fault_voltage_);
-        if (this->ac_output_voltage_) this->ac_output_voltage_->publish_state(value_ac_output_voltage_);
-        if (this->ac_output_load_percent_) this->ac_output_load_percent_->publish_state(value_ac_output_load_percent_);
-        if (this->grid_frequency_) this->grid_frequency_->publish_state(value_grid_frequency_);
-        if (this->battery_voltage_) this->battery_voltage_->publish_state(value_battery_voltage_);
-        if (this->temperature_) this->temperature_->publish_state(value_temperature_);
-
-        if (this->utility_fail_) this->utility_fail_->publish_state(value_utility_fail_ == 1);
-        if (this->battery_low_) this->battery_low_->publish_state(value_battery_low_ == 1);
-        if (this->bypass_active_) this->bypass_active_->publish_state(value_bypass_active_ == 1);
-        if (this->ups_failed_) this->ups_failed_->publish_state(value_ups_failed_ == 1);
-        if (this->ups_type_standby_) this->ups_type_standby_->publish_state(value_ups_type_standby_ == 1);
-        if (this->test_in_progress_) this->test_in_progress_->publish_state(value_test_in_progress_ == 1);
-        if (this->shutdown_active_) this->shutdown_active_->publish_state(value_shutdown_active_ == 1);
-        if (this->beeper_on_) this->beeper_on_->publish_state(value_beeper_on_ == 1);
-        if (this->beeper_switch_) this->beeper_switch_->publish_state(value_beeper_on_ == 1);
-
-        if (this->quick_test_switch_) this->quick_test_switch_->publish_state(value_test_in_progress_ == 1);
-        if (this->deep_test_switch_) this->deep_test_switch_->publish_state(value_test_in_progress_ == 1);
-        if (this->ten_minutes_test_switch_) this->ten_minutes_test_switch_->publish_state(value_test_in_progress_ == 1);
+      case POLLING_Q1: {
+        // La instantánea agregada sale antes que las entidades sueltas
+        this->publish_telemetry_(this->q1_sample_);
+#ifdef USE_POWERMUST_POWER_QUALITY
+        if (this->power_quality_enabled_)
+          this->publish_power_quality_();
+#endif
+        // Con agregación los valores analógicos solo salen como agregados al cerrar la ventana;
+        // los bits de estado se publican con cada Q1
+        bool publish_analog = true;
+#ifdef USE_POWERMUST_AGGREGATION
+        if (this->aggregator_.enabled()) {
+          publish_analog = false;
+          if (this->aggregate_window_closed_)
+            this->publish_aggregates_();
+        }
+#endif
+        if (publish_analog) {
+          this->publish_sensor_(this->grid_voltage_, this->grid_voltage_filter_, value_grid_voltage_);
+          this->publish_sensor_(this->grid_fault_voltage_, this->grid_fault_voltage_filter_,
+                                value_grid_fault_voltage_);
+          this->publish_sensor_(this->ac_output_voltage_, this->ac_output_voltage_filter_, value_ac_output_voltage_);
+          this->publish_sensor_(this->ac_output_load_percent_, this->ac_output_load_percent_filter_,
+                                value_ac_output_load_percent_);
+          this->publish_sensor_(this->grid_frequency_, this->grid_frequency_filter_, value_grid_frequency_);
+          this->publish_sensor_(this->battery_voltage_, this->battery_voltage_filter_, value_battery_voltage_);
+          this->publish_sensor_(this->temperature_, this->temperature_filter_, value_temperature_);
+        }
+
+        this->publish_binary_sensor_(this->utility_fail_, this->utility_fail_filter_, value_utility_fail_ == 1);
+        this->publish_binary_sensor_(this->battery_low_, this->battery_low_filter_, value_battery_low_ == 1);
+        this->publish_binary_sensor_(this->bypass_active_, this->bypass_active_filter_, value_bypass_active_ == 1);
+        this->publish_binary_sensor_(this->ups_failed_, this->ups_failed_filter_, value_ups_failed_ == 1);
+        this->publish_binary_sensor_(this->ups_type_standby_, this->ups_type_standby_filter_,
+                                     value_ups_type_standby_ == 1);
+        this->publish_binary_sensor_(this->test_in_progress_, this->test_in_progress_filter_,
+                                     value_test_in_progress_ == 1);
+        this->publish_binary_sensor_(this->shutdown_active_, this->shutdown_active_filter_,
+                                     value_shutdown_active_ == 1);
+        this->publish_binary_sensor_(this->beeper_on_, this->beeper_on_filter_, value_beeper_on_ == 1);
+
+        // Los interruptores leen los bits de la muestra: su sensor binario puede no estar compilado
+        bool beeper_on = this->q1_sample_.status & Q1_STATUS_BEEPER_ON;
+        bool test_in_progress = this->q1_sample_.status & Q1_STATUS_TEST_IN_PROGRESS;
+        this->publish_switch_(this->beeper_switch_, this->beeper_switch_filter_, beeper_on);
+        this->publish_switch_(this->quick_test_switch_, this->quick_test_switch_filter_, test_in_progress);
+        this->publish_switch_(this->deep_test_switch_, this->deep_test_switch_filter_, test_in_progress);
+        this->publish_switch_(this->ten_minutes_test_switch_, this->ten_minutes_test_switch_filter_, test_in_progress);
+
+        if (publish_analog) {
+          this->publish_sensor_(this->estimated_runtime_, this->estimated_runtime_filter_, value_estimated_runtime_);
+          this->publish_sensor_(this->state_of_charge_, this->state_of_charge_filter_, value_state_of_charge_);
+        }
+#ifdef USE_POWERMUST_INSTRUMENTATION
+        this->poll_to_publish_histogram_.add(millis() - this->command_start_millis_);
+#endif
 
         this->state_ = STATE_IDLE;
         break;
+      }
 
       case POLLING_F:
-        if (this->ac_output_rating_voltage_) this->ac_output_rating_voltage_->publish_state(value_ac_output_rating_voltage_);
-        if (this->ac_output_rating_current_) this->ac_output_rating_current_->publish_state(value_ac_output_rating_current_);
-        if (this->battery_rating_voltage_) this->battery_rating_voltage_->publish_state(value_battery_rating_voltage_);
-        if (this->ac_output_rating_frequency_) this->ac_output_rating_frequency_->publish_state(value_ac_output_rating_frequency_);
+        this->publish_sensor_(this->ac_output_rating_voltage_, this->ac_output_rating_voltage_filter_,
+                              value_ac_output_rating_voltage_);
+        this->publish_sensor_(this->ac_output_rating_current_, this->ac_output_rating_current_filter_,
+                              value_ac_output_rating_current_);
+        this->publish_sensor_(this->battery_rating_voltage_, this->battery_rating_voltage_filter_,
+                              value_battery_rating_voltage_);
+        this->publish_sensor_(this->ac_output_rating_frequency_, this->ac_output_rating_frequency_filter_,
+                              value_ac_output_rating_frequency_);
         this->state_ = STATE_IDLE;
         break;
 
@@ -155,58 +424,59 @@ void Powermust::loop() {
 
   // === Decodificación de respuestas ===
   if (this->state_ == STATE_POLL_CHECKED) {
-    char tmp[POWERMUST_READ_BUFFER_LENGTH];
-    strncpy(tmp, (const char*)this->read_buffer_, this->read_pos_);
-    tmp[this->read_pos_] = '\0';
+    // Longitud de la trama sin el '\r' final
+    size_t frame_length = this->rx_.frame_length();
+    if (frame_length > 0 && this->rx_.frame()[frame_length - 1] == '\r')
+      frame_length--;
+    const char *frame = (const char *) this->rx_.frame();
 
     switch (this->used_polling_commands_[this->last_polling_command_].identifier) {
       case POLLING_Q1: {
         ESP_LOGD(TAG, "Decode Q1");
-        char temp_str[8] = {0};
-        char status_bits[16] = {0};
-        int items_assigned = sscanf(tmp, "(%f %f %f %d %f %f %7s %15s",
-               &value_grid_voltage_,
-               &value_grid_fault_voltage_,
-               &value_ac_output_voltage_,
-               &value_ac_output_load_percent_,
-               &value_grid_frequency_,
-               &value_battery_voltage_,
-               temp_str,
-               status_bits);
-
-        if (items_assigned < 8) {
-          ESP_LOGW(TAG, "sscanf Q1 falló! Asignó %d/8. Trama: '%s'", items_assigned, tmp);
+        Q1Sample sample;
+        uint8_t fields = decode_q1(this->rx_.frame(), this->rx_.frame_length(), &sample, Q1_DECODED_FIELDS);
+        if (fields < Q1_FIELD_COUNT) {
+          ESP_LOGW(TAG, "Q1 decode failed at field %u/%u (%s). Frame: '%.*s'", fields + 1, Q1_FIELD_COUNT,
+                   Q1_FIELD_NAMES[fields], (int) frame_length, frame);
+          this->poll_failed_(POLL_FAILURE_PARSE);
           this->state_ = STATE_IDLE;
           break;
         }
 
-        // Temperatura
-        if (strcmp(temp_str, "--.-") == 0 || strcmp(temp_str, "?.?") == 0) {
-          value_temperature_ = NAN;
+        this->fire_power_events_(sample);
+        this->q1_sample_ = sample;
+        this->apply_q1_(sample);
+#ifdef USE_POWERMUST_SEQUENCES
+        this->verify_sequence_step_(sample);
+#endif
+        this->q1_samples_++;
+        this->update_adaptive_interval_();
+#ifdef USE_POWERMUST_HISTORY
+        if (this->history_enabled_)
+          this->telemetry_history_.add(sample, millis());
+#endif
+#ifdef USE_POWERMUST_POWER_QUALITY
+        if (this->power_quality_enabled_)
+          this->power_quality_monitor_.add(sample, millis());
+#endif
+#ifdef USE_POWERMUST_AGGREGATION
+        if (this->aggregator_.enabled())
+          this->aggregate_window_closed_ = this->aggregator_.add(sample, millis());
+#endif
+        this->update_runtime_estimate_();
+        if (!(Q1_DECODED_FIELDS & Q1_FIELD_TEMPERATURE)) {
+          // Sin convertir no se sabe si el SAI la mide: se queda lo que diga el perfil
+        } else if (std::isnan(sample.temperature)) {
+          this->profile_.capabilities &= ~PROFILE_HAS_TEMPERATURE;
         } else {
-          value_temperature_ = strtof(temp_str, nullptr);
+          this->profile_.capabilities |= PROFILE_HAS_TEMPERATURE;
         }
+        // Los campos que no se convierten salen como nan
+        ESP_LOGD(TAG, "Q1 → Grid:%.1fV Out:%.1fV Load:%d%% Temp:%.1f Beeper:%s", sample.grid_voltage,
+                 sample.ac_output_voltage, sample.ac_output_load_percent, sample.temperature,
+                 (sample.status & Q1_STATUS_BEEPER_ON) ? "ON" : "OFF");
 
-        // Bits de estado
-        size_t len = strlen(status_bits);
-        value_utility_fail_ = (len >= 1 && status_bits[0] == '1') ? 1 : 0;
-        value_battery_low_ = (len >= 2 && status_bits[1] == '1') ? 1 : 0;
-        value_bypass_active_ = (len >= 3 && status_bits[2] == '1') ? 1 : 0;
-        value_ups_failed_ = (len >= 4 && status_bits[3] == '1') ? 1 : 0;
-        value_ups_type_standby_ = (len >= 5 && status_bits[4] == '1') ? 1 : 0;
-        value_test_in_progress_ = (len >= 6 && status_bits[5] == '1') ? 1 : 0;
-        value_shutdown_active_ = (len >= 7 && status_bits[6] == '1') ? 1 : 0;
-        value_beeper_on_ = (len >= 8 && status_bits[7] == '1') ? 1 : 0;
-
-        ESP_LOGD(TAG, "Q1 → Grid:%.1fV Out:%.1fV Load:%d%% Temp:%s Beeper:%s",
-                 value_grid_voltage_, value_ac_output_voltage_, value_ac_output_load_percent_,
-                 temp_str, value_beeper_on_ ? "ON" : "OFF");
-
-        if (this->last_q1_) {
-          char *cr = strchr(tmp, '\r');
-          if (cr) *cr = '\0';
-          this->last_q1_->publish_state(tmp);
-        }
+        this->publish_text_sensor_(this->last_q1_, this->last_q1_filter_, frame, frame_length);
 
         this->state_ = STATE_POLL_DECODED;
         break;
@@ -214,25 +484,37 @@ void Powermust::loop() {
 
       case POLLING_F: {
         ESP_LOGD(TAG, "Decode F");
-        int items = sscanf(tmp, "#%f %d %f %f",
-                           &value_ac_output_rating_voltage_,
-                           &value_ac_output_rating_current_,
-                           &value_battery_rating_voltage_,
-                           &value_ac_output_rating_frequency_);
-
-        if (items < 4) {
-          ESP_LOGW(TAG, "sscanf F falló! Asignó %d/4. Trama: '%s'", items, tmp);
-        } else {
-          ESP_LOGD(TAG, "F → OutV:%.1fV Cur:%dA BatV:%.2fV Freq:%.1fHz",
-                   value_ac_output_rating_voltage_, value_ac_output_rating_current_,
-                   value_battery_rating_voltage_, value_ac_output_rating_frequency_);
+        FSample sample;
+        uint8_t fields = decode_f(this->rx_.frame(), this->rx_.frame_length(), &sample);
+        if (fields < F_FIELD_COUNT) {
+          ESP_LOGW(TAG, "F decode failed at field %u/%u (%s). Frame: '%.*s'", fields + 1, F_FIELD_COUNT,
+                   F_FIELD_NAMES[fields], (int) frame_length, frame);
+          this->poll_failed_(POLL_FAILURE_PARSE);
+          this->state_ = STATE_IDLE;
+          break;
         }
-
-        if (this->last_f_) {
-          char *cr = strchr(tmp, '\r');
-          if (cr) *cr = '\0';
-          this->last_f_->publish_state(tmp);
+        POWERMUST_STORE_(ac_output_rating_voltage, sample.ac_output_rating_voltage);
+        POWERMUST_STORE_(ac_output_rating_current, sample.ac_output_rating_current);
+        POWERMUST_STORE_(battery_rating_voltage, sample.battery_rating_voltage);
+        POWERMUST_STORE_(ac_output_rating_frequency, sample.ac_output_rating_frequency);
+        ESP_LOGD(TAG, "F → OutV:%.1fV Cur:%dA BatV:%.2fV Freq:%.1fHz", sample.ac_output_rating_voltage,
+                 sample.ac_output_rating_current, sample.battery_rating_voltage, sample.ac_output_rating_frequency);
+        this->runtime_estimator_.set_battery_rating_voltage(sample.battery_rating_voltage);
+#ifdef USE_POWERMUST_POWER_QUALITY
+        this->power_quality_monitor_.set_rated(sample.ac_output_rating_voltage, sample.ac_output_rating_frequency);
+#endif
+        this->profile_.ac_output_rating_voltage = sample.ac_output_rating_voltage;
+        this->profile_.ac_output_rating_current = sample.ac_output_rating_current;
+        this->profile_.battery_rating_voltage = sample.battery_rating_voltage;
+        this->profile_.ac_output_rating_frequency = sample.ac_output_rating_frequency;
+        this->profile_.f_hash = frame_hash(frame, frame_length);
+        if (this->profile_.f_hash != this->telemetry_f_hash_) {
+          this->telemetry_f_hash_ = this->profile_.f_hash;
+          this->telemetry_ratings_ = true;
         }
+        this->profile_answered_ |= PROFILE_HAS_F;
+
+        this->publish_text_sensor_(this->last_f_, this->last_f_filter_, frame, frame_length);
 
         this->state_ = STATE_POLL_DECODED;
         break;
@@ -240,17 +522,14 @@ void Powermust::loop() {
 
       case POLLING_I: {
         ESP_LOGD(TAG, "Decode I");
-        char clean_tmp[POWERMUST_READ_BUFFER_LENGTH];
-        strncpy(clean_tmp, tmp, sizeof(clean_tmp) - 1);
-        clean_tmp[sizeof(clean_tmp) - 1] = '\0';
-
-        char *cr = strchr(clean_tmp, '\r');
-        if (cr) *cr = '\0';
-
-        ESP_LOGD(TAG, "UPS Info: %s", clean_tmp);
+        ESP_LOGD(TAG, "UPS Info: %.*s", (int) frame_length, frame);
 
-        if (this->ups_info_) {
-          this->ups_info_->publish_state(clean_tmp);
+        this->publish_text_sensor_(this->ups_info_, this->ups_info_filter_, frame, frame_length);
+        {
+          size_t length = std::min(frame_length, (size_t) DeviceProfile::IDENTITY_LENGTH);
+          memcpy(this->profile_.identity, frame, length);
+          memset(this->profile_.identity + length, 0, sizeof(this->profile_.identity) - length);
+          this->profile_answered_ |= PROFILE_HAS_I;
         }
 
         this->state_ = STATE_POLL_DECODED;
@@ -266,8 +545,16 @@ void Powermust::loop() {
 
   // === Finalización de polling (NAK o fin) ===
   if (this->state_ == STATE_POLL_COMPLETE) {
-    if (this->read_pos_ >= 4 && memcmp(this->read_buffer_, "(NAK", 4) == 0) {
+    auto &cmd = this->used_polling_commands_[this->last_polling_command_];
+    // Algoritmo de Karn: la respuesta a un reenvío no se sabe a qué envío corresponde
+    if (!this->poll_resent_)
+      cmd.rtt.add(this->reply_elapsed_());
+#ifdef USE_POWERMUST_INSTRUMENTATION
+    this->poll_latency_histograms_[cmd.identifier].add(this->reply_elapsed_());
+#endif
+    if (this->rx_.frame_length() >= 4 && memcmp(this->rx_.frame(), "(NAK", 4) == 0) {
       ESP_LOGW(TAG, "Polling command failed (NAK)");
+      this->poll_failed_(POLL_FAILURE_NAK);
       this->state_ = STATE_IDLE;
       return;
     }
@@ -277,114 +564,1307 @@ void Powermust::loop() {
 
   // === Recepción de bytes ===
   if (this->state_ == STATE_POLL || this->state_ == STATE_COMMAND) {
-    while (this->available()) {
-      uint8_t byte;
-      this->read_byte(&byte);
-
-      if (this->read_pos_ >= POWERMUST_READ_BUFFER_LENGTH) {
-        this->read_pos_ = 0;
-        this->empty_uart_buffer_();
+    while (this->next_frame_()) {
+      if (this->state_ == STATE_POLL && this->frame_matches_poll_()) {
+        this->state_ = STATE_POLL_COMPLETE;
+        break;
       }
-
-      this->read_buffer_[this->read_pos_++] = byte;
-
-      if (byte == 0x0D) {  // \r
-        this->read_buffer_[this->read_pos_] = '\0';
-        this->empty_uart_buffer_();
-
-        if (this->state_ == STATE_POLL) {
-          this->state_ = STATE_POLL_COMPLETE;
-        } else if (this->state_ == STATE_COMMAND) {
-          this->state_ = STATE_COMMAND_COMPLETE;
-        }
+      if (this->state_ == STATE_COMMAND && this->frame_matches_command_()) {
+        this->state_ = STATE_COMMAND_COMPLETE;
+        break;
       }
+      ESP_LOGD(TAG, "Discarding stale frame: '%.*s'", (int) this->rx_.frame_length() - 1,
+               (const char *) this->rx_.frame());
     }
   }
 
   // === Timeout de comando ===
   if (this->state_ == STATE_COMMAND) {
-    if (millis() - this->command_start_millis_ > COMMAND_TIMEOUT) {
-      ESP_LOGW(TAG, "Command timeout: %s", this->command_queue_[this->command_queue_position_].c_str());
+    const auto &queued = this->command_queue_[this->current_command_];
+    uint32_t timeout = this->command_timeout_(queued.id);
+    if (this->reply_timed_out_(timeout)) {
+      ESP_LOGW(TAG, "Command timeout after %" PRIu32 " ms: %s", timeout, queued.command);
+      this->command_timed_out_ = true;
       this->state_ = STATE_COMMAND_COMPLETE;
     }
   }
 
   // === Timeout de polling ===
   if (this->state_ == STATE_POLL) {
-    if (millis() - this->command_start_millis_ > COMMAND_TIMEOUT) {
-      ESP_LOGW(TAG, "Polling timeout: %s", (char*)this->used_polling_commands_[this->last_polling_command_].command);
+    const auto &cmd = this->used_polling_commands_[this->last_polling_command_];
+    if (this->reply_timed_out_(cmd.rtt.timeout())) {
+      ESP_LOGW(TAG, "Polling timeout after %" PRIu32 " ms: %s", cmd.rtt.timeout(), cmd.command);
+      this->poll_timed_out_ = true;
+      this->poll_failed_(POLL_FAILURE_TIMEOUT);
       this->state_ = STATE_IDLE;
     }
   }
 }
 
+// === Publicación con detección de cambios ===
+void PublishFilter::configure(float absolute, float relative, uint32_t max_silence) {
+  this->on_change = true;
+  this->absolute = absolute;
+  this->relative = relative;
+  this->max_silence = max_silence;
+}
+
+bool PublishFilter::check(float value, uint32_t now) {
+  bool publish;
+  if (!this->on_change || !this->published) {
+    publish = true;
+  } else if (this->max_silence > 0 && now - this->last_millis >= this->max_silence) {
+    publish = true;
+  } else if (std::isnan(value) || std::isnan(this->last_value)) {
+    publish = std::isnan(value) != std::isnan(this->last_value);
+  } else {
+    float band = std::max(this->absolute, this->relative * fabsf(this->last_value));
+    float delta = fabsf(value - this->last_value);
+    publish = delta > band || (band == 0.0f && delta != 0.0f);
+  }
+
+  if (publish) {
+    this->last_value = value;
+    this->last_millis = now;
+    this->published = true;
+  }
+  return publish;
+}
+
+void Powermust::publish_sensor_state_(sensor::Sensor *sensor, PublishFilter &filter, float value) {
+  if (filter.check(value, millis()))
+    sensor->publish_state(value);
+}
+
+// Los estados binarios solo se publican en los flancos
+void Powermust::publish_binary_sensor_state_(binary_sensor::BinarySensor *binary_sensor, PublishFilter &filter,
+                                             bool value) {
+  filter.on_change = true;
+  if (filter.check(value ? 1.0f : 0.0f, millis()))
+    binary_sensor->publish_state(value);
+}
+
+void Powermust::publish_switch_state_(switch_::Switch *a_switch, PublishFilter &filter, bool value) {
+  filter.on_change = true;
+  if (filter.check(value ? 1.0f : 0.0f, millis()))
+    a_switch->publish_state(value);
+}
+
+// Las tramas en crudo solo se publican (y se copian a std::string) si cambian
+void Powermust::publish_text_sensor_state_(text_sensor::TextSensor *text_sensor, PublishFilter &filter,
+                                           const char *value, size_t length) {
+  if (filter.published && text_sensor->state.size() == length && memcmp(text_sensor->state.data(), value, length) == 0)
+    return;
+  filter.published = true;
+  text_sensor->publish_state(std::string(value, length));
+}
+
+// Solo se aplica una trama completa: una corrupta no deja valores a medias. Solo se
+// guardan los valores de las entidades compiladas.
+void Powermust::apply_q1_(const Q1Sample &sample) {
+  POWERMUST_STORE_(grid_voltage, sample.grid_voltage);
+  POWERMUST_STORE_(grid_fault_voltage, sample.grid_fault_voltage);
+  POWERMUST_STORE_(ac_output_voltage, sample.ac_output_voltage);
+  POWERMUST_STORE_(ac_output_load_percent, sample.ac_output_load_percent);
+  POWERMUST_STORE_(grid_frequency, sample.grid_frequency);
+  POWERMUST_STORE_(battery_voltage, sample.battery_voltage);
+  POWERMUST_STORE_(temperature, sample.temperature);
+
+  POWERMUST_STORE_(utility_fail, (sample.status & Q1_STATUS_UTILITY_FAIL) ? 1 : 0);
+  POWERMUST_STORE_(battery_low, (sample.status & Q1_STATUS_BATTERY_LOW) ? 1 : 0);
+  POWERMUST_STORE_(bypass_active, (sample.status & Q1_STATUS_BYPASS_ACTIVE) ? 1 : 0);
+  POWERMUST_STORE_(ups_failed, (sample.status & Q1_STATUS_UPS_FAILED) ? 1 : 0);
+  POWERMUST_STORE_(ups_type_standby, (sample.status & Q1_STATUS_UPS_TYPE_STANDBY) ? 1 : 0);
+  POWERMUST_STORE_(test_in_progress, (sample.status & Q1_STATUS_TEST_IN_PROGRESS) ? 1 : 0);
+  POWERMUST_STORE_(shutdown_active, (sample.status & Q1_STATUS_SHUTDOWN_ACTIVE) ? 1 : 0);
+  POWERMUST_STORE_(beeper_on, (sample.status & Q1_STATUS_BEEPER_ON) ? 1 : 0);
+}
+
+// Añade un valor al registro JSON; NAN se envía como null
+static size_t json_value(char *buffer, size_t length, size_t pos, float value, int decimals) {
+  if (pos >= length)
+    return pos;
+  if (std::isnan(value))
+    return pos + snprintf(buffer + pos, length - pos, "null");
+  return pos + snprintf(buffer + pos, length - pos, "%.*f", decimals, value);
+}
+
+// Añade ,"clave":valor al registro JSON
+static size_t json_number(char *buffer, size_t length, size_t pos, const char *key, float value, int decimals) {
+  if (pos >= length)
+    return pos;
+  pos += snprintf(buffer + pos, length - pos, ",\"%s\":", key);
+  return json_value(buffer, length, pos, value, decimals);
+}
+
+// Un único mensaje por ciclo Q1 con todos los valores, para colectores que prefieren una
+// instantánea coherente a 20 publicaciones sueltas. Los nominales solo van cuando cambian.
+void Powermust::publish_telemetry_(const Q1Sample &sample) {
+  if (this->telemetry_ == nullptr)
+    return;
+
+  char buffer[TELEMETRY_LENGTH];
+  size_t length = sizeof(buffer);
+  size_t pos = snprintf(buffer, length, "{\"seq\":%" PRIu32, this->telemetry_sequence_++);
+  pos = json_number(buffer, length, pos, "grid", sample.grid_voltage, 1);
+  pos = json_number(buffer, length, pos, "fault", sample.grid_fault_voltage, 1);
+  pos = json_number(buffer, length, pos, "output", sample.ac_output_voltage, 1);
+  pos = json_number(buffer, length, pos, "load", sample.ac_output_load_percent, 0);
+  pos = json_number(buffer, length, pos, "freq", sample.grid_frequency, 1);
+  pos = json_number(buffer, length, pos, "battery", sample.battery_voltage, 2);
+  pos = json_number(buffer, length, pos, "temp", sample.temperature, 1);
+  pos = json_number(buffer, length, pos, "status", sample.status, 0);
+  if (this->runtime_estimation_) {
+    pos = json_number(buffer, length, pos, "runtime", this->runtime_estimator_.get_runtime(), 0);
+    pos = json_number(buffer, length, pos, "soc", this->runtime_estimator_.get_state_of_charge(), 1);
+  }
+  if (this->telemetry_ratings_ && pos < length) {
+    pos += snprintf(buffer + pos, length - pos,
+                    ",\"rated\":{\"voltage\":%.1f,\"current\":%d,\"battery\":%.2f,\"freq\":%.1f}",
+                    this->profile_.ac_output_rating_voltage, this->profile_.ac_output_rating_current,
+                    this->profile_.battery_rating_voltage, this->profile_.ac_output_rating_frequency);
+    this->telemetry_ratings_ = false;
+  }
+  if (pos + 1 >= length) {
+    ESP_LOGW(TAG, "Telemetry record truncated");
+    return;
+  }
+  buffer[pos++] = '}';
+  buffer[pos] = '\0';
+  this->publish_state_(this->telemetry_, buffer);
+}
+
+#ifdef USE_POWERMUST_POWER_QUALITY
+// Añade ,"clave":[min,max,media,desviación] al resumen de ventana
+static size_t json_stats(char *buffer, size_t length, size_t pos, const char *key, const RunningStats &stats,
+                         int decimals) {
+  const float values[4] = {stats.min(), stats.max(), stats.mean(), stats.stddev()};
+  for (uint8_t i = 0; i < 4 && pos < length; i++) {
+    if (i == 0) {
+      pos += snprintf(buffer + pos, length - pos, ",\"%s\":[", key);
+    } else {
+      pos += snprintf(buffer + pos, length - pos, ",");
+    }
+    pos = json_value(buffer, length, pos, values[i], decimals + (i == 3 ? 1 : 0));
+  }
+  if (pos < length)
+    pos += snprintf(buffer + pos, length - pos, "]");
+  return pos;
+}
+
+// Publica los eventos de calidad de red cerrados y el resumen de cada ventana completada
+void Powermust::publish_power_quality_() {
+  const PowerQualityMonitor &monitor = this->power_quality_monitor_;
+  char buffer[POWER_QUALITY_LENGTH];
+
+  // Si el registro dio la vuelta entre dos publicaciones solo quedan los últimos
+  uint32_t events = monitor.events();
+  if (events - this->power_quality_events_published_ > PowerQualityMonitor::EVENT_LOG_LENGTH)
+    this->power_quality_events_published_ = events - PowerQualityMonitor::EVENT_LOG_LENGTH;
+  for (; this->power_quality_events_published_ < events; this->power_quality_events_published_++) {
+    const PowerQualityEvent &event = monitor.event(this->power_quality_events_published_);
+    const char *name = power_quality_event_name(event.type);
+    ESP_LOGI(TAG, "Power quality event: %s for %" PRIu32 " ms, extreme %.1f", name, event.duration, event.extreme);
+    if (this->power_quality_event_ == nullptr)
+      continue;
+    snprintf(buffer, sizeof(buffer), "{\"type\":\"%s\",\"start\":%" PRIu32 ",\"duration\":%" PRIu32
+             ",\"extreme\":%.1f}", name, event.start / 1000, event.duration, event.extreme);
+    this->publish_state_(this->power_quality_event_, buffer);
+  }
+
+  if (monitor.windows() == this->power_quality_windows_published_)
+    return;
+  this->power_quality_windows_published_ = monitor.windows();
+  if (this->power_quality_ == nullptr)
+    return;
+
+  size_t length = sizeof(buffer);
+  size_t pos = snprintf(buffer, length, "{\"window\":%" PRIu32 ",\"samples\":%" PRIu32,
+                        monitor.window_length() / 1000, monitor.window_stats(POWER_QUALITY_METRIC_VOLTAGE).count());
+  pos = json_stats(buffer, length, pos, "voltage", monitor.window_stats(POWER_QUALITY_METRIC_VOLTAGE), 1);
+  pos = json_stats(buffer, length, pos, "fault", monitor.window_stats(POWER_QUALITY_METRIC_FAULT_VOLTAGE), 1);
+  pos = json_stats(buffer, length, pos, "freq", monitor.window_stats(POWER_QUALITY_METRIC_FREQUENCY), 1);
+  if (pos < length)
+    pos += snprintf(buffer + pos, length - pos, ",\"events\":[%u,%u,%u,%u]}",
+                    monitor.window_events(POWER_QUALITY_EVENT_SAG), monitor.window_events(POWER_QUALITY_EVENT_SWELL),
+                    monitor.window_events(POWER_QUALITY_EVENT_INTERRUPTION),
+                    monitor.window_events(POWER_QUALITY_EVENT_FREQUENCY));
+  if (pos >= length) {
+    ESP_LOGW(TAG, "Power quality summary truncated");
+    return;
+  }
+  this->publish_state_(this->power_quality_, buffer);
+}
+#endif
+
+#ifdef USE_POWERMUST_AGGREGATION
+// Publica mínimo, máximo y media de la ventana que acaba de cerrarse
+void Powermust::publish_aggregates_() {
+  const SampleAggregator &aggregator = this->aggregator_;
+  ESP_LOGD(TAG, "Aggregation window closed: %" PRIu32 " samples in %" PRIu32 " ms",
+           aggregator.window_stats(AGGREGATE_GRID_VOLTAGE).count(), aggregator.window_length());
+  const RunningStats *stats = &aggregator.window_stats(AGGREGATE_GRID_VOLTAGE);
+  this->publish_state_(this->grid_voltage_min_, stats->min());
+  this->publish_state_(this->grid_voltage_max_, stats->max());
+  this->publish_state_(this->grid_voltage_avg_, stats->mean());
+  stats = &aggregator.window_stats(AGGREGATE_AC_OUTPUT_VOLTAGE);
+  this->publish_state_(this->ac_output_voltage_min_, stats->min());
+  this->publish_state_(this->ac_output_voltage_max_, stats->max());
+  this->publish_state_(this->ac_output_voltage_avg_, stats->mean());
+  stats = &aggregator.window_stats(AGGREGATE_AC_OUTPUT_LOAD_PERCENT);
+  this->publish_state_(this->ac_output_load_percent_min_, stats->min());
+  this->publish_state_(this->ac_output_load_percent_max_, stats->max());
+  this->publish_state_(this->ac_output_load_percent_avg_, stats->mean());
+  stats = &aggregator.window_stats(AGGREGATE_BATTERY_VOLTAGE);
+  this->publish_state_(this->battery_voltage_min_, stats->min());
+  this->publish_state_(this->battery_voltage_max_, stats->max());
+  this->publish_state_(this->battery_voltage_avg_, stats->mean());
+  stats = &aggregator.window_stats(AGGREGATE_GRID_FREQUENCY);
+  this->publish_state_(this->grid_frequency_min_, stats->min());
+  this->publish_state_(this->grid_frequency_max_, stats->max());
+  this->publish_state_(this->grid_frequency_avg_, stats->mean());
+  stats = &aggregator.window_stats(AGGREGATE_TEMPERATURE);
+  this->publish_state_(this->temperature_min_, stats->min());
+  this->publish_state_(this->temperature_max_, stats->max());
+  this->publish_state_(this->temperature_avg_, stats->mean());
+}
+#endif
+
+void Powermust::fire_power_events_(const Q1Sample &sample) {
+  uint8_t raised = sample.status & ~this->last_q1_status_;
+  uint8_t cleared = ~sample.status & this->last_q1_status_;
+  this->last_q1_status_ = sample.status;
+  if ((raised | cleared) == 0)
+    return;
+
+  static const struct {
+    PowerEvent event;
+    bool rising;
+    uint8_t bit;
+    const char *name;
+  } EDGES[] = {
+      {POWER_EVENT_UTILITY_FAIL, true, Q1_STATUS_UTILITY_FAIL, "utility fail"},
+      {POWER_EVENT_UTILITY_RESTORED, false, Q1_STATUS_UTILITY_FAIL, "utility restored"},
+      {POWER_EVENT_BATTERY_LOW, true, Q1_STATUS_BATTERY_LOW, "battery low"},
+      {POWER_EVENT_UPS_FAILED, true, Q1_STATUS_UPS_FAILED, "UPS failed"},
+      {POWER_EVENT_TEST_FINISHED, false, Q1_STATUS_TEST_IN_PROGRESS, "test finished"},
+  };
+  for (const auto &edge : EDGES) {
+    if ((edge.rising ? raised : cleared) & edge.bit) {
+      ESP_LOGI(TAG, "Power event: %s", edge.name);
+      this->power_event_callback_.call(edge.event, sample);
+    }
+  }
+}
+
 // === Funciones auxiliares ===
-uint8_t Powermust::check_incoming_length_(uint8_t length) {
-  return (this->read_pos_ - 3 == length) ? 1 : 0;
+bool Powermust::frame_matches_poll_() {
+  return frame_matches(this->rx_.frame(), this->rx_.frame_length(),
+                       poll_reply_start(this->used_polling_commands_[this->last_polling_command_]));
+}
+
+bool Powermust::frame_matches_command_() { return frame_matches(this->rx_.frame(), this->rx_.frame_length(), 0); }
+
+// Sin respuesta esperada no hay RTT que medir: se espera el timeout fijo del descriptor
+uint32_t Powermust::command_timeout_(CommandId id) const {
+  if (COMMAND_DESCRIPTORS[id].reply == REPLY_NONE)
+    return COMMAND_DESCRIPTORS[id].timeout;
+  return this->command_rtt_[id].timeout();
 }
 
 uint8_t Powermust::send_next_command_() {
-  if (this->command_queue_[this->command_queue_position_].empty()) {
+  int8_t slot = this->next_queued_command_();
+  if (slot < 0) {
     return 0;
   }
 
-  std::string cmd = this->command_queue_[this->command_queue_position_];
+  auto &cmd = this->command_queue_[slot];
+  cmd.in_flight = true;
+  cmd.attempts++;
+  this->current_command_ = slot;
+  this->command_timed_out_ = false;
   this->state_ = STATE_COMMAND;
   this->command_start_millis_ = millis();
-  this->empty_uart_buffer_();
-  this->read_pos_ = 0;
-
-  this->write_str(cmd.c_str());
-  this->write(0x0D);
+  this->send_frame_(cmd.command, cmd.length, 0, this->command_timeout_(cmd.id));
 
-  ESP_LOGD(TAG, "Sending command from queue: %s with length %d", cmd.c_str(), (int)cmd.length());
+  ESP_LOGD(TAG, "Sending command from queue: %s with length %d", cmd.command, (int) cmd.length);
   return 1;
 }
 
+// Un comando está pendiente si nunca ha respondido (arranque, política ONCE/ON_RECONNECT)
+// o si ha vencido su intervalo. Los pendientes se reintentan cada update_interval hasta
+// MAX_PENDING_ATTEMPTS veces; después esperan a su propio intervalo o a la reconexión.
+bool Powermust::is_poll_due_(const PollingCommand &cmd, uint32_t now) const {
+  return this->poll_due_in_(cmd, now) == 0;
+}
+
+// ms hasta que el comando vence: 0 si ya toca, UINT32_MAX si solo volverá a tocar al reconectar
+uint32_t Powermust::poll_due_in_(const PollingCommand &cmd, uint32_t now) const {
+#ifdef USE_POWERMUST_SEQUENCES
+  // Verificación de un paso de secuencia: Q1 seguidos hasta confirmarlo o agotar su timeout
+  if (cmd.identifier == POLLING_Q1 && this->is_verifying_sequence_())
+    return 0;
+#endif
+  uint32_t interval;
+  if (cmd.pending && cmd.attempts < MAX_PENDING_ATTEMPTS) {
+    if (cmd.attempts == 0)
+      return 0;
+    interval = this->update_interval_;
+  } else if (cmd.policy == POLLING_POLICY_ONCE) {
+    return UINT32_MAX;
+  } else {
+    interval = this->polling_interval_(cmd);
+  }
+  uint32_t elapsed = now - cmd.last_run;
+  return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+#ifdef USE_POWERMUST_EVENT_DRIVEN
+// Sin nada que hacer hasta el próximo poll, loop() deja de ejecutarse y el planificador
+// lo reactiva cuando vence. Los comandos encolados y la exportación lo reactivan antes.
+void Powermust::sleep_until_next_poll_() {
+#ifdef USE_POWERMUST_HISTORY
+  if (this->history_exporting_)
+    return;
+#endif
+#ifdef USE_POWERMUST_CAPTURE
+  if (this->capture_dumping_)
+    return;
+#endif
+#ifdef USE_POWERMUST_SEQUENCES
+  // El timeout de los pasos se comprueba en cada pasada
+  if (this->sequence_ != nullptr)
+    return;
+#endif
+  uint32_t now = millis();
+  uint32_t delay = UINT32_MAX;
+  if (!this->phase_aligned_) {
+    uint32_t offset = PowermustBus::phase_offset(this, this->update_interval_);
+    delay = now - this->setup_millis_ < offset ? offset - (now - this->setup_millis_) : 0;
+  } else {
+    for (const auto &cmd : this->used_polling_commands_) {
+      if (cmd.length > 0)
+        delay = std::min(delay, this->poll_due_in_(cmd, now));
+    }
+    if (this->link_backoff_ > 0 && now - this->last_poll_millis_ < this->link_backoff_)
+      delay = std::max(delay, this->link_backoff_ - (now - this->last_poll_millis_));
+  }
+  if (delay == 0)
+    return;
+  if (delay > MAX_IDLE_SLEEP)
+    delay = MAX_IDLE_SLEEP;
+  this->set_timeout("idle", delay, [this]() { this->enable_loop(); });
+  this->disable_loop();
+}
+
+void Powermust::wake_up_() {
+  if (!this->event_driven_)
+    return;
+  this->cancel_timeout("idle");
+  this->enable_loop();
+}
+#endif
+
+uint32_t Powermust::polling_interval_(const PollingCommand &cmd) const {
+  if (this->adaptive_polling_ && cmd.identifier == POLLING_Q1 && this->adaptive_interval_ > 0)
+    return this->adaptive_interval_;
+  return cmd.interval > 0 ? cmd.interval : this->update_interval_;
+}
+
+void Powermust::update_adaptive_interval_() {
+  if (!this->adaptive_polling_)
+    return;
+
+  uint32_t now = millis();
+  const Q1Sample &sample = this->q1_sample_;
+  const char *reason = nullptr;
+  if (sample.status & Q1_STATUS_UTILITY_FAIL) {
+    reason = "utility fail";
+  } else if (sample.status & Q1_STATUS_BATTERY_LOW) {
+    reason = "battery low";
+  } else if (sample.status & Q1_STATUS_TEST_IN_PROGRESS) {
+    reason = "test in progress";
+  } else if (this->adaptive_last_load_ >= 0 &&
+             std::abs(sample.ac_output_load_percent - this->adaptive_last_load_) >= this->adaptive_load_change_) {
+    reason = "load change";
+  } else if (std::fabs(sample.grid_voltage - this->adaptive_last_grid_voltage_) >=
+             this->adaptive_grid_voltage_change_) {
+    reason = "grid voltage change";
+  } else if (std::fabs(sample.battery_voltage - this->adaptive_last_battery_voltage_) >=
+             this->adaptive_battery_voltage_change_) {
+    reason = "battery voltage change";
+  }
+  // Las comparaciones con NAN son falsas: la primera muestra nunca cuenta como cambio brusco
+  this->adaptive_last_load_ = sample.ac_output_load_percent;
+  this->adaptive_last_grid_voltage_ = sample.grid_voltage;
+  this->adaptive_last_battery_voltage_ = sample.battery_voltage;
+
+  if (reason != nullptr) {
+    if (this->adaptive_interval_ != this->adaptive_min_interval_) {
+      ESP_LOGD(TAG, "Adaptive polling: %s, Q1 every %" PRIu32 " ms", reason, this->adaptive_min_interval_);
+      this->adaptive_interval_ = this->adaptive_min_interval_;
+    }
+    this->adaptive_changed_millis_ = now;
+    return;
+  }
+
+  // Sin eventos durante la histéresis se duplica el intervalo hasta el máximo
+  if (this->adaptive_interval_ < this->adaptive_max_interval_ &&
+      now - this->adaptive_changed_millis_ >= this->adaptive_hysteresis_) {
+    this->adaptive_interval_ = std::min(this->adaptive_interval_ * 2, this->adaptive_max_interval_);
+    this->adaptive_changed_millis_ = now;
+    ESP_LOGD(TAG, "Adaptive polling: readings stable, Q1 every %" PRIu32 " ms", this->adaptive_interval_);
+  }
+}
+
 void Powermust::send_next_poll_() {
-  this->last_polling_command_ = (this->last_polling_command_ + 1) % 15;
-  while (this->used_polling_commands_[this->last_polling_command_].length == 0) {
-    this->last_polling_command_ = (this->last_polling_command_ + 1) % 15;
-    if (this->last_polling_command_ == 0) return;  // No hay comandos
+  uint32_t now = millis();
+  if (!this->phase_aligned_) {
+    // Con varios SAI en el nodo, cada uno arranca en una fase distinta del intervalo
+    if (now - this->setup_millis_ < PowermustBus::phase_offset(this, this->update_interval_))
+      return;
+    this->phase_aligned_ = true;
+  }
+
+  if (this->poll_retry_) {
+    // Reenvío inmediato del poll perdido sin esperar a su intervalo
+    this->poll_retry_ = false;
+    this->poll_resent_ = true;
+    auto &cmd = this->used_polling_commands_[this->last_polling_command_];
+    ESP_LOGD(TAG, "Resending polling command %s (%u/%u)", cmd.command, this->poll_retries_, MAX_POLL_RETRIES);
+    this->write_poll_(cmd, now);
+    return;
   }
+  // Con el SAI sin responder se sondea cada vez menos a menudo
+  bool backoff = this->link_backoff_ > 0 && now - this->last_poll_millis_ < this->link_backoff_;
+#ifdef USE_POWERMUST_SEQUENCES
+  backoff = backoff && !this->is_verifying_sequence_();
+#endif
+  if (backoff)
+    return;
 
+  int8_t next = -1;
+  for (uint8_t i = 0; i < MAX_POLLING_COMMANDS; i++) {
+    const auto &cmd = this->used_polling_commands_[i];
+    if (cmd.length == 0 || !this->is_poll_due_(cmd, now))
+      continue;
+    // Mayor prioridad primero; a igual prioridad, el que más tiempo lleva esperando
+    if (next < 0 || cmd.priority > this->used_polling_commands_[next].priority ||
+        (cmd.priority == this->used_polling_commands_[next].priority &&
+         now - cmd.last_run > now - this->used_polling_commands_[next].last_run)) {
+      next = i;
+    }
+  }
+  if (next < 0)
+    return;
+
+  this->last_polling_command_ = next;
   auto &cmd = this->used_polling_commands_[this->last_polling_command_];
+  cmd.last_run = now;
+  if (cmd.attempts < UINT8_MAX)
+    cmd.attempts++;
+  this->poll_retries_ = 0;
+  this->poll_resent_ = cmd.attempts > 1;
+  ESP_LOGD(TAG, "Sending polling command: %s (len=%d)", cmd.command, cmd.length);
+  this->write_poll_(cmd, now);
+}
+
+void Powermust::write_poll_(const PollingCommand &cmd, uint32_t now) {
+  this->last_poll_millis_ = now;
+  this->poll_timed_out_ = false;
   this->state_ = STATE_POLL;
   this->command_start_millis_ = millis();
-  this->empty_uart_buffer_();
-  this->read_pos_ = 0;
+  this->send_frame_(cmd.command, cmd.length, poll_reply_start(cmd), cmd.rtt.timeout());
+}
 
-  this->write_array(cmd.command, cmd.length);
-  this->write(0x0D);
+void Powermust::poll_succeeded_() {
+  this->used_polling_commands_[this->last_polling_command_].pending = false;
+  this->used_polling_commands_[this->last_polling_command_].attempts = 0;
+  this->poll_retries_ = 0;
+  this->poll_retry_ = false;
+  if (this->is_link_lost_()) {
+    // El SAI vuelve a responder: los datos estáticos pueden haber cambiado
+    ESP_LOGI(TAG, "UPS is responding again");
+    this->link_backoff_ = 0;
+    for (auto &cmd : this->used_polling_commands_) {
+      if (cmd.length > 0 && cmd.policy == POLLING_POLICY_ON_RECONNECT) {
+        cmd.pending = true;
+        cmd.attempts = 0;
+      }
+    }
+    this->profile_answered_ = 0;
+  }
+  this->poll_failures_ = 0;
+  this->publish_binary_sensor_(this->link_, this->link_filter_, true);
+  this->update_device_profile_();
+}
+
+void Powermust::poll_failed_(PollFailure reason) {
+  auto &cmd = this->used_polling_commands_[this->last_polling_command_];
+  if (cmd.errors < UINT8_MAX)
+    cmd.errors++;
+#ifdef USE_POWERMUST_INSTRUMENTATION
+  switch (reason) {
+    case POLL_FAILURE_TIMEOUT:
+      this->timeout_counter_++;
+      break;
+    case POLL_FAILURE_NAK:
+      this->nak_counter_++;
+      break;
+    case POLL_FAILURE_PARSE:
+      this->parse_failure_counter_++;
+      break;
+  }
+#endif
 
-  ESP_LOGD(TAG, "Sending polling command: %s (len=%d)", (char*)cmd.command, cmd.length);
+  if (reason != POLL_FAILURE_NAK && !cmd.pending && !this->is_link_lost_() && this->poll_retries_ < MAX_POLL_RETRIES) {
+    // Un byte perdido no cuesta un intervalo entero: se reenvía en la siguiente pasada.
+    // Un NAK es una respuesta válida y se repetiría igual; los pendientes ya se reintentan.
+    this->poll_retries_++;
+    this->poll_retry_ = true;
+  } else {
+    this->poll_retry_ = false;
+    // Sin respuesta ni con los reenvíos: quizá el SAI es más lento de lo medido.
+    // Un comando que nunca ha respondido o un SAI apagado no alargan el timeout.
+    if (reason == POLL_FAILURE_TIMEOUT && cmd.rtt.samples() > 0 && !this->is_link_lost_())
+      cmd.rtt.backoff();
+    if (this->poll_failures_ < UINT8_MAX)
+      this->poll_failures_++;
+    if (this->poll_failures_ == LINK_LOST_POLL_FAILURES) {
+      this->link_lost_();
+    } else if (this->is_link_lost_() && this->link_backoff_ < MAX_LINK_BACKOFF) {
+      this->link_backoff_ = this->link_backoff_ * 2 < MAX_LINK_BACKOFF ? this->link_backoff_ * 2 : MAX_LINK_BACKOFF;
+      ESP_LOGD(TAG, "UPS still not responding, next poll in %" PRIu32 " ms", this->link_backoff_);
+    }
+  }
+  this->update_device_profile_();
+}
+
+// Las medidas dejan de ser válidas: se publican como desconocidas hasta la próxima respuesta
+void Powermust::link_lost_() {
+  this->link_backoff_ = this->update_interval_;
+  // Con el SAI apagado cada intento cuesta solo el timeout medido, no el alargado
+  for (auto &cmd : this->used_polling_commands_)
+    cmd.rtt.reset_backoff();
+  ESP_LOGW(TAG, "UPS not responding after %u polls, next poll in %" PRIu32 " ms", LINK_LOST_POLL_FAILURES,
+           this->link_backoff_);
+  this->publish_binary_sensor_(this->link_, this->link_filter_, false);
+
+  this->publish_sensor_(this->grid_voltage_, this->grid_voltage_filter_, NAN);
+  this->publish_sensor_(this->grid_fault_voltage_, this->grid_fault_voltage_filter_, NAN);
+  this->publish_sensor_(this->ac_output_voltage_, this->ac_output_voltage_filter_, NAN);
+  this->publish_sensor_(this->ac_output_load_percent_, this->ac_output_load_percent_filter_, NAN);
+  this->publish_sensor_(this->grid_frequency_, this->grid_frequency_filter_, NAN);
+  this->publish_sensor_(this->battery_voltage_, this->battery_voltage_filter_, NAN);
+  this->publish_sensor_(this->temperature_, this->temperature_filter_, NAN);
+  this->publish_sensor_(this->estimated_runtime_, this->estimated_runtime_filter_, NAN);
+  this->publish_sensor_(this->state_of_charge_, this->state_of_charge_filter_, NAN);
+}
+
+bool Powermust::is_probe_settled_(ENUMPollingCommand identifier) const {
+  for (const auto &cmd : this->used_polling_commands_) {
+    if (cmd.length > 0 && cmd.identifier == identifier)
+      return !cmd.pending || cmd.attempts >= MAX_PENDING_ATTEMPTS;
+  }
+  return true;
+}
+
+// La exploración agotó sus intentos sin respuesta: el SAI no tiene ese comando
+bool Powermust::is_probe_failed_(ENUMPollingCommand identifier) const {
+  for (const auto &cmd : this->used_polling_commands_) {
+    if (cmd.length > 0 && cmd.identifier == identifier)
+      return cmd.pending && cmd.attempts >= MAX_PENDING_ATTEMPTS;
+  }
+  return false;
 }
 
-void Powermust::queue_command_(const char *command, uint8_t length) {
-  for (int i = 0; i < COMMAND_QUEUE_LENGTH; i++) {
-    int pos = (this->command_queue_position_ + i) % COMMAND_QUEUE_LENGTH;
-    if (this->command_queue_[pos].empty()) {
-      this->command_queue_[pos] = std::string(command, length);
-      ESP_LOGD(TAG, "Command queued: %s at pos %d", command, pos);
+// Publica los valores nominales y la identificación guardados sin esperar a F e I
+void Powermust::apply_device_profile_() {
+  const DeviceProfile &profile = this->profile_;
+  if (profile.capabilities & PROFILE_HAS_F) {
+    POWERMUST_STORE_(ac_output_rating_voltage, profile.ac_output_rating_voltage);
+    POWERMUST_STORE_(ac_output_rating_current, profile.ac_output_rating_current);
+    POWERMUST_STORE_(battery_rating_voltage, profile.battery_rating_voltage);
+    POWERMUST_STORE_(ac_output_rating_frequency, profile.ac_output_rating_frequency);
+    this->runtime_estimator_.set_battery_rating_voltage(profile.battery_rating_voltage);
+#ifdef USE_POWERMUST_POWER_QUALITY
+    this->power_quality_monitor_.set_rated(profile.ac_output_rating_voltage, profile.ac_output_rating_frequency);
+#endif
+    this->telemetry_f_hash_ = profile.f_hash;
+    this->telemetry_ratings_ = true;
+    this->publish_sensor_(this->ac_output_rating_voltage_, this->ac_output_rating_voltage_filter_,
+                          value_ac_output_rating_voltage_);
+    this->publish_sensor_(this->ac_output_rating_current_, this->ac_output_rating_current_filter_,
+                          value_ac_output_rating_current_);
+    this->publish_sensor_(this->battery_rating_voltage_, this->battery_rating_voltage_filter_,
+                          value_battery_rating_voltage_);
+    this->publish_sensor_(this->ac_output_rating_frequency_, this->ac_output_rating_frequency_filter_,
+                          value_ac_output_rating_frequency_);
+  }
+  if (profile.capabilities & PROFILE_HAS_I) {
+    this->publish_text_sensor_(this->ups_info_, this->ups_info_filter_, profile.identity, strlen(profile.identity));
+  }
+}
+
+// Cierra la exploración cuando F e I han respondido o agotado sus intentos
+void Powermust::update_device_profile_() {
+  if (!this->device_profile_ || !this->is_probe_settled_(POLLING_F) || !this->is_probe_settled_(POLLING_I))
+    return;
+  if (this->profile_answered_ == 0)
+    return;  // Nada nuevo desde la última exploración
+
+  // Los polls periódicos de F o I llegan por separado: una capacidad solo se pierde cuando su
+  // exploración agota los intentos, no porque el otro comando haya respondido solo
+  DeviceProfile &profile = this->profile_;
+  uint8_t answered = this->profile_answered_;
+  uint8_t failed = (this->is_probe_failed_(POLLING_F) ? PROFILE_HAS_F : 0) |
+                   (this->is_probe_failed_(POLLING_I) ? PROFILE_HAS_I : 0);
+  profile.capabilities = (profile.capabilities | answered) & ~failed;
+  this->profile_answered_ = 0;
+  profile.key = (profile.capabilities & PROFILE_HAS_I) ? frame_hash(profile.identity, strlen(profile.identity))
+                                                       : profile.f_hash;
+  if (profile.key == 0)
+    return;
+
+  bool same_key_source = (this->saved_profile_.capabilities & PROFILE_HAS_I) == (profile.capabilities & PROFILE_HAS_I);
+  if (this->saved_profile_.key != 0 && this->saved_profile_.key != profile.key && same_key_source) {
+    if (this->profile_verifying_) {
+      // Otro SAI tras un arranque en caliente: los valores nominales publicados son de la
+      // caché. Se descarta el perfil y se exploran de nuevo los comandos que no han respondido.
+      ESP_LOGW(TAG, "UPS does not match cached profile '%s', probing again", profile_name(this->saved_profile_));
+      this->profile_verifying_ = false;
+      this->saved_profile_ = {};
+      profile.capabilities = answered;
+      profile.rejected_commands = 0;
+      this->profile_answered_ = answered;
+      for (auto &cmd : this->used_polling_commands_) {
+        if (cmd.length == 0 || cmd.identifier == POLLING_Q1)
+          continue;
+        uint8_t capability = cmd.identifier == POLLING_F ? PROFILE_HAS_F : PROFILE_HAS_I;
+        if (!(answered & capability)) {
+          cmd.pending = true;
+          cmd.attempts = 0;
+        }
+      }
       return;
     }
+    ESP_LOGW(TAG, "Different UPS detected, replacing cached profile '%s'", profile_name(this->saved_profile_));
+    profile.rejected_commands = 0;
+  }
+  if (this->profile_verifying_) {
+    ESP_LOGD(TAG, "Cached profile '%s' verified", profile_name(this->saved_profile_));
+    this->profile_verifying_ = false;
+  }
+  this->save_device_profile_();
+}
+
+void Powermust::save_device_profile_() {
+  if (memcmp(&this->profile_, &this->saved_profile_, sizeof(DeviceProfile)) == 0)
+    return;
+  if (this->profile_pref_.save(&this->profile_)) {
+    ESP_LOGI(TAG, "Device profile saved: '%s'", profile_name(this->profile_));
+    this->saved_profile_ = this->profile_;
+  }
+}
+
+void Powermust::set_polling_schedule(ENUMPollingCommand command, uint32_t interval, uint8_t priority,
+                                     PollingPolicy policy) {
+  auto &schedule = this->polling_schedules_[command];
+  schedule.interval = interval;
+  schedule.priority = priority;
+  schedule.policy = policy;
+}
+
+#ifdef USE_POWERMUST_CAPTURE
+// Una línea de log por pasada: "Capture <n>/<total>: <base64>". Los registros pueden quedar
+// partidos entre líneas; la herramienta concatena las líneas antes de decodificarlos.
+void Powermust::dump_capture_chunk_() {
+  size_t total = (this->capture_.size() + CAPTURE_CHUNK_LENGTH - 1) / CAPTURE_CHUNK_LENGTH;
+  uint8_t chunk[CAPTURE_CHUNK_LENGTH];
+  size_t length = this->capture_.read(this->capture_offset_, chunk, sizeof(chunk));
+  if (length == 0) {
+    ESP_LOGI(TAG, "Capture end");
+    this->capture_dumping_ = false;
+    return;
+  }
+  ESP_LOGI(TAG, "Capture %u/%u: %s", (unsigned) (this->capture_offset_ / CAPTURE_CHUNK_LENGTH + 1), (unsigned) total,
+           base64_encode(chunk, length).c_str());
+  this->capture_offset_ += length;
+}
+#endif
+
+#ifdef USE_POWERMUST_HISTORY
+// Formato de cada trozo: "<nivel> <restantes> <antigüedad_s> <registros en base64>"
+// nivel: r (muestras), m (1 min), t (10 min); restantes: registros del nivel que faltan
+// tras este trozo; antigüedad: segundos desde el último registro del trozo. Los registros
+// van del más antiguo al más reciente y cada uno lleva su dt respecto al anterior.
+void Powermust::export_history_chunk_() {
+  static const char TIER_NAMES[TELEMETRY_TIER_COUNT] = {'r', 'm', 't'};
+
+  for (uint8_t tier = 0; tier < TELEMETRY_TIER_COUNT; tier++) {
+    auto history_tier = (TelemetryTier) tier;
+    if (this->telemetry_history_.unexported(history_tier) == 0)
+      continue;
+
+    TelemetryRecord records[HISTORY_CHUNK_RECORDS];
+    uint32_t age;
+    size_t count =
+        this->telemetry_history_.export_records(history_tier, records, HISTORY_CHUNK_RECORDS, millis(), &age);
+    char header[32];
+    snprintf(header, sizeof(header), "%c %u %" PRIu32 " ", TIER_NAMES[tier],
+             (unsigned) this->telemetry_history_.unexported(history_tier), age / 1000);
+    this->publish_state_(this->history_,
+                         header + base64_encode((const uint8_t *) records, count * TelemetryRecord::SIZE));
+    return;
+  }
+
+  ESP_LOGD(TAG, "History export finished");
+  this->history_exporting_ = false;
+}
+#endif
+
+#ifdef USE_POWERMUST_INSTRUMENTATION
+void Powermust::publish_instrumentation_() {
+  LatencyHistogram commands;
+  for (const auto &histogram : this->command_latency_histograms_) {
+    for (uint8_t bucket = 0; bucket < LatencyHistogram::BUCKETS; bucket++)
+      commands.counts[bucket] += histogram.counts[bucket];
+    commands.samples += histogram.samples;
+    commands.sum += histogram.sum;
+    commands.max = std::max(commands.max, histogram.max);
+  }
+
+  this->publish_state_(this->poll_latency_, this->poll_latency_histograms_[POLLING_Q1].percentile(95));
+  if (commands.samples > 0)
+    this->publish_state_(this->command_latency_, commands.percentile(95));
+  this->publish_state_(this->poll_to_publish_latency_, this->poll_to_publish_histogram_.percentile(95));
+  this->publish_state_(this->timeout_count_, this->timeout_counter_);
+  this->publish_state_(this->nak_count_, this->nak_counter_);
+  this->publish_state_(this->parse_failure_count_, this->parse_failure_counter_);
+  this->publish_state_(this->rx_overflow_count_, this->rx_.overflows());
+  this->publish_state_(this->loop_time_average_, this->loop_timer_.average());
+  this->publish_state_(this->loop_time_max_, this->loop_timer_.max);
+
+  this->loop_time_max_us_ = std::max(this->loop_time_max_us_, this->loop_timer_.max);
+  this->loop_timer_.reset();
+}
+#endif
+
+void Powermust::dump_capture() {
+#ifdef USE_POWERMUST_CAPTURE
+  if (this->capture_dumping_)
+    return;
+  ESP_LOGI(TAG, "Capture start: %" PRIu32 " records, %u bytes, %" PRIu32 " dropped", this->capture_.records(),
+           (unsigned) this->capture_.size(), this->capture_.dropped());
+  this->capture_offset_ = 0;
+  this->capture_dumping_ = true;
+#ifdef USE_POWERMUST_EVENT_DRIVEN
+  this->wake_up_();
+#endif
+#else
+  ESP_LOGW(TAG, "Capture dump requested but capture is not enabled");
+#endif
+}
+
+void Powermust::export_history() {
+#ifdef USE_POWERMUST_HISTORY
+  if (!this->history_enabled_) {
+    ESP_LOGW(TAG, "History export requested but history is not enabled");
+    return;
+  }
+  if (this->history_ == nullptr) {
+    ESP_LOGW(TAG, "History export requested but no history text sensor configured");
+    return;
+  }
+  ESP_LOGI(TAG, "Exporting history: %u raw, %u 1 min, %u 10 min records",
+           (unsigned) this->telemetry_history_.unexported(TELEMETRY_TIER_RAW),
+           (unsigned) this->telemetry_history_.unexported(TELEMETRY_TIER_MINUTE),
+           (unsigned) this->telemetry_history_.unexported(TELEMETRY_TIER_TEN_MINUTES));
+  this->history_exporting_ = true;
+#ifdef USE_POWERMUST_EVENT_DRIVEN
+  this->wake_up_();
+#endif
+#else
+  ESP_LOGW(TAG, "History export requested but history is not enabled");
+#endif
+}
+
+void Powermust::update_runtime_estimate_() {
+  if (!this->runtime_estimation_)
+    return;
+
+  const Q1Sample &sample = this->q1_sample_;
+  bool learned = this->runtime_estimator_.update(sample.battery_voltage, sample.ac_output_load_percent,
+                                                 sample.status & Q1_STATUS_UTILITY_FAIL, millis());
+  POWERMUST_STORE_(estimated_runtime, this->runtime_estimator_.get_runtime());
+  POWERMUST_STORE_(state_of_charge, this->runtime_estimator_.get_state_of_charge());
+  if (learned) {
+    const RuntimeModel &model = this->runtime_estimator_.get_model();
+    ESP_LOGI(TAG, "Runtime model updated after discharge %" PRIu32 ": %.0f s at full load", model.discharges,
+             model.full_load_runtime);
+    this->runtime_model_pref_.save(&model);
+  }
+}
+
+void Powermust::set_adaptive_polling(uint32_t min_interval, uint32_t max_interval, uint32_t hysteresis) {
+  this->adaptive_polling_ = true;
+  this->adaptive_min_interval_ = min_interval;
+  this->adaptive_max_interval_ = max_interval;
+  this->adaptive_hysteresis_ = hysteresis;
+  // Se arranca rápido y se va relajando mientras las lecturas sean estables
+  this->adaptive_interval_ = min_interval;
+}
+
+void Powermust::set_adaptive_thresholds(int load_change, float grid_voltage_change, float battery_voltage_change) {
+  this->adaptive_load_change_ = load_change;
+  this->adaptive_grid_voltage_change_ = grid_voltage_change;
+  this->adaptive_battery_voltage_change_ = battery_voltage_change;
+}
+
+// === Cola de comandos ===
+// Descriptores de los comandos Megatec, indexados por CommandId: respuesta esperada,
+// timeout, reintentos si no hay respuesta, prioridad en la cola y qué hacer al completar.
+// El toggle del beeper "Q" y los tests no se reintentan: un ACK perdido no significa
+// que el SAI no los haya ejecutado.
+constexpr CommandDescriptor Powermust::COMMAND_DESCRIPTORS[COMMAND_COUNT] = {
+    {"unknown", REPLY_NONE, 1000, 0, COMMAND_PRIORITY_NORMAL, nullptr},
+    {"quick test", REPLY_ACK, 1000, 0, COMMAND_PRIORITY_TEST, &Powermust::complete_quick_test_},
+    {"deep test", REPLY_ACK, 1000, 0, COMMAND_PRIORITY_TEST, &Powermust::complete_deep_test_},
+    {"timed test", REPLY_ACK, 1000, 0, COMMAND_PRIORITY_TEST, &Powermust::complete_ten_minutes_test_},
+    {"cancel test", REPLY_ACK, 1000, 1, COMMAND_PRIORITY_TEST, &Powermust::complete_cancel_test_},
+    {"beeper toggle", REPLY_ACK, 1000, 0, COMMAND_PRIORITY_NORMAL, nullptr},
+    {"shutdown", REPLY_ACK, 1000, 1, COMMAND_PRIORITY_SHUTDOWN, &Powermust::complete_shutdown_},
+    {"shutdown and restore", REPLY_ACK, 1000, 1, COMMAND_PRIORITY_SHUTDOWN, &Powermust::complete_shutdown_restore_},
+    {"cancel shutdown", REPLY_ACK, 1000, 2, COMMAND_PRIORITY_SHUTDOWN, &Powermust::complete_cancel_shutdown_},
+    {"CL", REPLY_ACK, 1000, 0, COMMAND_PRIORITY_NORMAL, nullptr},
+};
+
+// Se resuelve una sola vez al encolar; después todo se consulta por CommandId
+CommandId Powermust::resolve_command_(const char *command) {
+  if (strcmp(command, "T") == 0)
+    return COMMAND_QUICK_TEST;
+  if (strcmp(command, "TL") == 0)
+    return COMMAND_DEEP_TEST;
+  if (command[0] == 'T' && command[1] >= '0' && command[1] <= '9')
+    return COMMAND_TEN_MINUTES_TEST;  // T<n>, T10
+  if (strcmp(command, "CT") == 0)
+    return COMMAND_CANCEL_TEST;
+  if (strcmp(command, "Q") == 0)
+    return COMMAND_BEEPER_TOGGLE;
+  if (strcmp(command, "C") == 0)
+    return COMMAND_CANCEL_SHUTDOWN;
+  if (strcmp(command, "CL") == 0)
+    return COMMAND_CL;
+  if (command[0] == 'S')
+    return strchr(command, 'R') != nullptr ? COMMAND_SHUTDOWN_RESTORE : COMMAND_SHUTDOWN;
+  return COMMAND_UNKNOWN;
+}
+
+static bool is_test_command(CommandId id) {
+  return id == COMMAND_QUICK_TEST || id == COMMAND_DEEP_TEST || id == COMMAND_TEN_MINUTES_TEST;
+}
+static bool is_shutdown_command(CommandId id) { return id == COMMAND_SHUTDOWN || id == COMMAND_SHUTDOWN_RESTORE; }
+
+void Powermust::complete_quick_test_() {
+  this->publish_switch_(this->quick_test_switch_, this->quick_test_switch_filter_, false);
+}
+void Powermust::complete_deep_test_() {
+  this->publish_switch_(this->deep_test_switch_, this->deep_test_switch_filter_, false);
+}
+void Powermust::complete_ten_minutes_test_() {
+  this->publish_switch_(this->ten_minutes_test_switch_, this->ten_minutes_test_switch_filter_, false);
+}
+void Powermust::complete_cancel_test_() {
+  this->complete_quick_test_();
+  this->complete_deep_test_();
+  this->complete_ten_minutes_test_();
+}
+void Powermust::complete_shutdown_() {
+  if (this->shutdown_switch_)
+    this->shutdown_switch_->publish_state(false);
+}
+void Powermust::complete_shutdown_restore_() {
+  if (this->shutdown_restore_switch_)
+    this->shutdown_restore_switch_->publish_state(false);
+}
+void Powermust::complete_cancel_shutdown_() {
+  if (this->cancel_shutdown_switch_)
+    this->cancel_shutdown_switch_->publish_state(false);
+}
+
+// Encola un comando en un hueco fijo. Antes se combinan los comandos pendientes:
+// - un duplicado se descarta, salvo el toggle del beeper "Q", que anula al pendiente;
+// - un test nuevo o "CT" sustituye a los tests pendientes;
+// - un apagado nuevo o "C" sustituye a los apagados pendientes.
+// Con la cola llena se expulsa el comando pendiente menos prioritario y más reciente.
+int8_t Powermust::queue_command_(const char *command, size_t length) {
+  if (length == 0 || length > MAX_COMMAND_LENGTH) {
+    ESP_LOGW(TAG, "Invalid command length %u, dropping", (unsigned) length);
+    this->queue_dropped_++;
+    this->publish_command_queue_stats_();
+    return -1;
+  }
+
+  char text[MAX_COMMAND_LENGTH + 1];
+  memcpy(text, command, length);
+  text[length] = '\0';
+  CommandId id = resolve_command_(text);
+  CommandPriority priority = COMMAND_DESCRIPTORS[id].priority;
+
+  int8_t free_slot = -1;
+  for (uint8_t i = 0; i < COMMAND_QUEUE_LENGTH; i++) {
+    auto &queued = this->command_queue_[i];
+    if (queued.length == 0) {
+      if (free_slot < 0)
+        free_slot = i;
+      continue;
+    }
+    if (queued.in_flight)
+      continue;
+
+    if (queued.length == length && memcmp(queued.command, text, length) == 0) {
+      this->queue_coalesced_++;
+      if (id == COMMAND_BEEPER_TOGGLE) {
+        ESP_LOGD(TAG, "Command %s cancels the pending toggle", text);
+        this->remove_queued_command_(i);
+        return -1;
+      }
+      ESP_LOGD(TAG, "Command %s already queued", text);
+      return i;
+    }
+
+    bool replaces = (is_test_command(queued.id) && (is_test_command(id) || id == COMMAND_CANCEL_TEST)) ||
+                    (is_shutdown_command(queued.id) && (is_shutdown_command(id) || id == COMMAND_CANCEL_SHUTDOWN));
+    if (replaces) {
+      ESP_LOGD(TAG, "Command %s replaces pending %s", text, queued.command);
+      this->queue_coalesced_++;
+      this->remove_queued_command_(i);
+      if (free_slot < 0)
+        free_slot = i;
+    }
+  }
+
+  if (free_slot < 0) {
+    int8_t victim = -1;
+    for (uint8_t i = 0; i < COMMAND_QUEUE_LENGTH; i++) {
+      const auto &queued = this->command_queue_[i];
+      if (queued.in_flight || queued.priority >= priority)
+        continue;
+      if (victim < 0 || queued.priority < this->command_queue_[victim].priority ||
+          (queued.priority == this->command_queue_[victim].priority &&
+           (int32_t) (queued.sequence - this->command_queue_[victim].sequence) > 0))
+        victim = i;
+    }
+    this->queue_dropped_++;
+    if (victim < 0) {
+      ESP_LOGW(TAG, "Command queue full, dropping: %s", text);
+      this->publish_command_queue_stats_();
+      return -1;
+    }
+    ESP_LOGW(TAG, "Command queue full, dropping %s in favour of %s", this->command_queue_[victim].command, text);
+    this->remove_queued_command_(victim);
+    free_slot = victim;
+  }
+
+  auto &slot = this->command_queue_[free_slot];
+  memcpy(slot.command, text, length + 1);
+  slot.length = length;
+  slot.id = id;
+  slot.priority = priority;
+  slot.in_flight = false;
+  slot.attempts = 0;
+  slot.sequence = this->command_sequence_++;
+  slot.from_sequence = false;
+  this->queue_depth_++;
+  ESP_LOGD(TAG, "Command queued: %s (%s) at slot %d, priority %u", text, COMMAND_DESCRIPTORS[id].name, free_slot,
+           priority);
+  this->publish_command_queue_stats_();
+#ifdef USE_POWERMUST_EVENT_DRIVEN
+  this->wake_up_();
+#endif
+  return free_slot;
+}
+
+void Powermust::remove_queued_command_(uint8_t slot) {
+  if (this->command_queue_[slot].length == 0)
+    return;
+  this->command_queue_[slot].length = 0;
+  this->command_queue_[slot].in_flight = false;
+  this->command_queue_[slot].from_sequence = false;
+  this->queue_depth_--;
+  this->publish_command_queue_stats_();
+}
+
+// El comando pendiente más prioritario; a igual prioridad, el más antiguo
+int8_t Powermust::next_queued_command_() const {
+  int8_t next = -1;
+  for (uint8_t i = 0; i < COMMAND_QUEUE_LENGTH; i++) {
+    const auto &queued = this->command_queue_[i];
+    if (queued.length == 0 || queued.in_flight)
+      continue;
+    if (next < 0 || queued.priority > this->command_queue_[next].priority ||
+        (queued.priority == this->command_queue_[next].priority &&
+         (int32_t) (queued.sequence - this->command_queue_[next].sequence) < 0))
+      next = i;
+  }
+  return next;
+}
+
+void Powermust::publish_command_queue_stats_() {
+  this->publish_state_(this->command_queue_depth_, this->queue_depth_);
+  this->publish_state_(this->command_queue_dropped_, this->queue_dropped_);
+}
+
+void Powermust::switch_command(const char *command) {
+  ESP_LOGD(TAG, "got command: %s", command);
+  queue_command_(command, strlen(command));
+}
+
+#ifdef USE_POWERMUST_SEQUENCES
+// === Secuencias de comandos ===
+// Cada paso encola su comando; tras el ACK se pide Q1 sin esperar al intervalo hasta ver el
+// bit de estado esperado, y entonces se encola el siguiente paso. Los comandos van antes
+// que los polls, así que entre pasos no queda ningún hueco. Un NAK, la falta de respuesta
+// o un bit que no llega antes del timeout del paso terminan la secuencia y envían los
+// comandos de vuelta atrás.
+bool Powermust::run_sequence(const CommandSequence *sequence) {
+  if (this->sequence_ != nullptr) {
+    ESP_LOGW(TAG, "Sequence '%s' not started: '%s' is still running", sequence->get_name(),
+             this->sequence_->get_name());
+    return false;
+  }
+  if (sequence->steps() == 0)
+    return false;
+  ESP_LOGI(TAG, "Sequence '%s' started (%u steps)", sequence->get_name(), sequence->steps());
+  this->sequence_ = sequence;
+  this->sequence_step_ = 0;
+  this->start_sequence_step_();
+  return true;
+}
+
+void Powermust::start_sequence_step_() {
+  const SequenceStep &step = this->sequence_->step(this->sequence_step_);
+  ESP_LOGD(TAG, "Sequence '%s' step %u/%u: %s", this->sequence_->get_name(), this->sequence_step_ + 1,
+           this->sequence_->steps(), step.command);
+  this->sequence_phase_ = SEQUENCE_PHASE_COMMAND;
+  this->sequence_step_millis_ = millis();
+  int8_t slot = this->queue_command_(step.command, strlen(step.command));
+  if (slot < 0) {
+    this->finish_sequence_("not queued");
+    return;
+  }
+  this->command_queue_[slot].from_sequence = true;
+}
+
+void Powermust::next_sequence_step_() {
+  if (++this->sequence_step_ >= this->sequence_->steps()) {
+    this->finish_sequence_(nullptr);
+    return;
   }
-  ESP_LOGW(TAG, "Command queue full, dropping: %s", command);
+  this->start_sequence_step_();
+}
+
+void Powermust::sequence_command_complete_(bool success) {
+  if (this->sequence_ == nullptr)
+    return;
+  if (!success) {
+    this->finish_sequence_(this->command_timed_out_ ? "no response" : "rejected");
+    return;
+  }
+  if (this->sequence_->step(this->sequence_step_).expect_mask == 0) {
+    this->next_sequence_step_();
+    return;
+  }
+  this->sequence_phase_ = SEQUENCE_PHASE_VERIFY;
+#ifdef USE_POWERMUST_EVENT_DRIVEN
+  this->wake_up_();
+#endif
+}
+
+void Powermust::verify_sequence_step_(const Q1Sample &sample) {
+  if (!this->is_verifying_sequence_())
+    return;
+  const SequenceStep &step = this->sequence_->step(this->sequence_step_);
+  if ((sample.status & step.expect_mask) != step.expect_value)
+    return;
+  ESP_LOGD(TAG, "Sequence '%s' step %u confirmed after %" PRIu32 " ms", this->sequence_->get_name(),
+           this->sequence_step_ + 1, millis() - this->sequence_step_millis_);
+  this->next_sequence_step_();
+}
+
+void Powermust::check_sequence_timeout_() {
+  if (this->sequence_ == nullptr)
+    return;
+  if (millis() - this->sequence_step_millis_ > this->sequence_->step(this->sequence_step_).timeout)
+    this->finish_sequence_(this->sequence_phase_ == SEQUENCE_PHASE_VERIFY ? "status not confirmed" : "timeout");
 }
 
-void Powermust::switch_command(const std::string &command) {
-  ESP_LOGD(TAG, "got command: %s", command.c_str());
-  queue_command_(command.c_str(), command.length());
+// reason = nullptr si todos los pasos se han confirmado
+void Powermust::finish_sequence_(const char *reason) {
+  const CommandSequence *sequence = this->sequence_;
+  this->sequence_ = nullptr;
+  SequenceResult result{sequence, reason == nullptr, 0, reason};
+
+  // Los comandos de la secuencia que aún no han salido ya no se envían; la respuesta
+  // del que está en curso ya no cuenta
+  for (uint8_t i = 0; i < COMMAND_QUEUE_LENGTH; i++) {
+    auto &queued = this->command_queue_[i];
+    if (queued.length == 0 || !queued.from_sequence)
+      continue;
+    if (queued.in_flight) {
+      queued.from_sequence = false;
+    } else {
+      this->remove_queued_command_(i);
+    }
+  }
+
+  if (result.success) {
+    ESP_LOGI(TAG, "Sequence '%s' completed", sequence->get_name());
+  } else {
+    result.failed_step = this->sequence_step_ + 1;
+    ESP_LOGW(TAG, "Sequence '%s' failed at step %u (%s): %s", sequence->get_name(), result.failed_step,
+             sequence->step(this->sequence_step_).command, reason);
+    for (uint8_t i = 0; i < sequence->rollback_commands(); i++) {
+      const char *command = sequence->rollback_command(i);
+      ESP_LOGI(TAG, "Sequence '%s' rollback: %s", sequence->get_name(), command);
+      this->queue_command_(command, strlen(command));
+    }
+  }
+  this->publish_state_(this->sequence_result_, result.failed_step);
+  this->sequence_callback_.call(result);
 }
+#endif
 
 void Powermust::dump_config() {
   ESP_LOGCONFIG(TAG, "Powermust:");
+  if (PowermustBus::size() > 1) {
+    ESP_LOGCONFIG(TAG, "  Unit %u of %u, %.1f samples/min (all units: %.1f samples/min)",
+                  PowermustBus::index_of(this) + 1, PowermustBus::size(), this->sample_rate_value_,
+                  PowermustBus::total_sample_rate());
+  }
+  ESP_LOGCONFIG(TAG, "  RX frames: %" PRIu32 ", discarded bytes: %" PRIu32 ", overflows: %" PRIu32, this->rx_.frames(),
+                this->rx_.discarded_bytes(), this->rx_.overflows());
+  ESP_LOGCONFIG(TAG, "  Command queue: %u/%u queued, %" PRIu32 " dropped, %" PRIu32 " coalesced", this->queue_depth_,
+                (unsigned) COMMAND_QUEUE_LENGTH, this->queue_dropped_, this->queue_coalesced_);
   ESP_LOGCONFIG(TAG, "  Used polling commands:");
   for (auto &cmd : this->used_polling_commands_) {
     if (cmd.length > 0) {
-      ESP_LOGCONFIG(TAG, "    %s", (char*)cmd.command);
+      static const char *const POLICIES[] = {"interval", "once", "on reconnect"};
+      ESP_LOGCONFIG(TAG, "    %s: every %" PRIu32 " ms, priority %u, policy %s", cmd.command,
+                    this->polling_interval_(cmd), cmd.priority, POLICIES[cmd.policy]);
+      ESP_LOGCONFIG(TAG, "      Timeout %" PRIu32 " ms (RTT %" PRIu32 " ms, variation %" PRIu32 " ms)",
+                    cmd.rtt.timeout(), cmd.rtt.smoothed(), cmd.rtt.variation());
+    }
+  }
+  for (uint8_t id = 0; id < COMMAND_COUNT; id++) {
+    const RttEstimator &rtt = this->command_rtt_[id];
+    if (rtt.samples() > 0) {
+      ESP_LOGCONFIG(TAG, "  %s: timeout %" PRIu32 " ms (RTT %" PRIu32 " ms, variation %" PRIu32 " ms)",
+                    COMMAND_DESCRIPTORS[id].name, rtt.timeout(), rtt.smoothed(), rtt.variation());
+    }
+  }
+  if (this->is_link_lost_())
+    ESP_LOGCONFIG(TAG, "  Link: down, next poll in %" PRIu32 " ms", this->link_backoff_);
+#ifdef USE_POWERMUST_EVENT_DRIVEN
+  if (this->event_driven_)
+    ESP_LOGCONFIG(TAG, "  Event driven: loop() sleeps between polls");
+#endif
+#ifdef USE_POWERMUST_TRANSPORT_TASK
+  if (this->transport_task_) {
+    ESP_LOGCONFIG(TAG,
+                  "  Transport: UART task on core %d, %" PRIu32 " requests, %" PRIu32 " timeouts, %" PRIu32
+                  " discarded frames",
+                  this->transport_.core(), this->transport_.requests(), this->transport_.timeouts(),
+                  this->transport_.discarded_frames());
+  }
+#endif
+#ifdef USE_POWERMUST_INSTRUMENTATION
+  ESP_LOGCONFIG(TAG, "  Instrumentation:");
+  ESP_LOGCONFIG(TAG,
+                "    Timeouts: %" PRIu32 ", NAKs: %" PRIu32 ", parse failures: %" PRIu32 ", RX overflows: %" PRIu32,
+                this->timeout_counter_, this->nak_counter_, this->parse_failure_counter_, this->rx_.overflows());
+  ESP_LOGCONFIG(TAG, "    Loop time: avg %.0f us, max %" PRIu32 " us", this->loop_timer_.average(),
+                std::max(this->loop_time_max_us_, this->loop_timer_.max));
+  char histogram[128];
+  for (const auto &cmd : this->used_polling_commands_) {
+    if (cmd.length == 0)
+      continue;
+    this->poll_latency_histograms_[cmd.identifier].format(histogram, sizeof(histogram));
+    ESP_LOGCONFIG(TAG, "    %s round trip: %s, errors %u", cmd.command, histogram, cmd.errors);
+  }
+  for (uint8_t id = 0; id < COMMAND_COUNT; id++) {
+    if (this->command_latency_histograms_[id].samples == 0)
+      continue;
+    this->command_latency_histograms_[id].format(histogram, sizeof(histogram));
+    ESP_LOGCONFIG(TAG, "    %s round trip: %s", COMMAND_DESCRIPTORS[id].name, histogram);
+  }
+  this->poll_to_publish_histogram_.format(histogram, sizeof(histogram));
+  ESP_LOGCONFIG(TAG, "    Q1 poll to publish: %s", histogram);
+#endif
+  if (this->device_profile_) {
+    const DeviceProfile &profile = this->saved_profile_;
+    if (profile.key == 0) {
+      ESP_LOGCONFIG(TAG, "  Device profile: not probed yet");
+    } else {
+      ESP_LOGCONFIG(TAG, "  Device profile: '%s' (F:%s I:%s temperature:%s)", profile_name(profile),
+                    YESNO(profile.capabilities & PROFILE_HAS_F), YESNO(profile.capabilities & PROFILE_HAS_I),
+                    YESNO(profile.capabilities & PROFILE_HAS_TEMPERATURE));
+      for (uint8_t id = 0; id < COMMAND_COUNT; id++) {
+        if (profile.rejected_commands & (1 << id))
+          ESP_LOGCONFIG(TAG, "    Rejected by the UPS: %s", COMMAND_DESCRIPTORS[id].name);
+      }
+    }
+  }
+  if (this->runtime_estimation_) {
+    const RuntimeModel &model = this->runtime_estimator_.get_model();
+    ESP_LOGCONFIG(TAG, "  Runtime model: %.0f s at full load, learned from %" PRIu32 " discharges",
+                  model.full_load_runtime, model.discharges);
+  }
+#ifdef USE_POWERMUST_HISTORY
+  if (this->history_enabled_) {
+    ESP_LOGCONFIG(TAG, "  History: %u/%u raw, %u/%u 1 min, %u/%u 10 min records%s",
+                  (unsigned) this->telemetry_history_.size(TELEMETRY_TIER_RAW),
+                  (unsigned) this->telemetry_history_.capacity(TELEMETRY_TIER_RAW),
+                  (unsigned) this->telemetry_history_.size(TELEMETRY_TIER_MINUTE),
+                  (unsigned) this->telemetry_history_.capacity(TELEMETRY_TIER_MINUTE),
+                  (unsigned) this->telemetry_history_.size(TELEMETRY_TIER_TEN_MINUTES),
+                  (unsigned) this->telemetry_history_.capacity(TELEMETRY_TIER_TEN_MINUTES),
+                  this->telemetry_history_.get_downsampling() ? "" : " (downsampling disabled)");
+  }
+#endif
+#ifdef USE_POWERMUST_CAPTURE
+  ESP_LOGCONFIG(TAG, "  Capture: %" PRIu32 " records, %u/%u bytes, %" PRIu32 " dropped", this->capture_.records(),
+                (unsigned) this->capture_.size(), (unsigned) this->capture_.capacity(), this->capture_.dropped());
+#endif
+#ifdef USE_POWERMUST_POWER_QUALITY
+  if (this->power_quality_enabled_) {
+    const PowerQualityMonitor &monitor = this->power_quality_monitor_;
+    ESP_LOGCONFIG(TAG, "  Power quality: %" PRIu32 " s windows, nominal %.1f V %.1f Hz, %" PRIu32 " events",
+                  monitor.get_window() / 1000, monitor.get_nominal_voltage(), monitor.get_nominal_frequency(),
+                  monitor.events());
+    uint32_t first = monitor.events() > PowerQualityMonitor::EVENT_LOG_LENGTH
+                         ? monitor.events() - PowerQualityMonitor::EVENT_LOG_LENGTH
+                         : 0;
+    for (uint32_t index = first; index < monitor.events(); index++) {
+      const PowerQualityEvent &event = monitor.event(index);
+      ESP_LOGCONFIG(TAG, "    %s at %" PRIu32 " s for %" PRIu32 " ms, extreme %.1f",
+                    power_quality_event_name(event.type), event.start / 1000, event.duration, event.extreme);
     }
   }
+#endif
+#ifdef USE_POWERMUST_AGGREGATION
+  if (this->aggregator_.enabled()) {
+    ESP_LOGCONFIG(TAG, "  Aggregation: %" PRIu32 " ms windows, %" PRIu32 " closed, %" PRIu32 " on status change",
+                  this->aggregator_.get_window(), this->aggregator_.windows(), this->aggregator_.status_flushes());
+  }
+#endif
+  if (this->adaptive_polling_) {
+    ESP_LOGCONFIG(TAG, "  Adaptive polling: Q1 every %" PRIu32 "..%" PRIu32 " ms, hysteresis %" PRIu32 " ms",
+                  this->adaptive_min_interval_, this->adaptive_max_interval_, this->adaptive_hysteresis_);
+    ESP_LOGCONFIG(TAG, "    Fast on load change >= %d%%, grid change >= %.1f V, battery change >= %.2f V",
+                  this->adaptive_load_change_, this->adaptive_grid_voltage_change_,
+                  this->adaptive_battery_voltage_change_);
+  }
 
   LOG_SENSOR("", "Grid Voltage", this->grid_voltage_);
   LOG_SENSOR("", "Grid Fault Voltage", this->grid_fault_voltage_);
@@ -393,6 +1873,26 @@ void Powermust::dump_config() {
   LOG_SENSOR("", "Grid Frequency", this->grid_frequency_);
   LOG_SENSOR("", "Battery Voltage", this->battery_voltage_);
   LOG_SENSOR("", "Temperature", this->temperature_);
+#ifdef USE_POWERMUST_AGGREGATION
+  LOG_SENSOR("", "Grid Voltage Min", this->grid_voltage_min_);
+  LOG_SENSOR("", "Grid Voltage Max", this->grid_voltage_max_);
+  LOG_SENSOR("", "Grid Voltage Avg", this->grid_voltage_avg_);
+  LOG_SENSOR("", "AC Output Voltage Min", this->ac_output_voltage_min_);
+  LOG_SENSOR("", "AC Output Voltage Max", this->ac_output_voltage_max_);
+  LOG_SENSOR("", "AC Output Voltage Avg", this->ac_output_voltage_avg_);
+  LOG_SENSOR("", "AC Output Load Percent Min", this->ac_output_load_percent_min_);
+  LOG_SENSOR("", "AC Output Load Percent Max", this->ac_output_load_percent_max_);
+  LOG_SENSOR("", "AC Output Load Percent Avg", this->ac_output_load_percent_avg_);
+  LOG_SENSOR("", "Battery Voltage Min", this->battery_voltage_min_);
+  LOG_SENSOR("", "Battery Voltage Max", this->battery_voltage_max_);
+  LOG_SENSOR("", "Battery Voltage Avg", this->battery_voltage_avg_);
+  LOG_SENSOR("", "Grid Frequency Min", this->grid_frequency_min_);
+  LOG_SENSOR("", "Grid Frequency Max", this->grid_frequency_max_);
+  LOG_SENSOR("", "Grid Frequency Avg", this->grid_frequency_avg_);
+  LOG_SENSOR("", "Temperature Min", this->temperature_min_);
+  LOG_SENSOR("", "Temperature Max", this->temperature_max_);
+  LOG_SENSOR("", "Temperature Avg", this->temperature_avg_);
+#endif
   LOG_SENSOR("", "AC Output Rating Voltage", this->ac_output_rating_voltage_);
   LOG_SENSOR("", "AC Output Rating Current", this->ac_output_rating_current_);
   LOG_SENSOR("", "Battery Rating Voltage", this->battery_rating_voltage_);
@@ -406,9 +1906,31 @@ void Powermust::dump_config() {
   LOG_BINARY_SENSOR("", "Test In Progress", this->test_in_progress_);
   LOG_BINARY_SENSOR("", "Shutdown Active", this->shutdown_active_);
   LOG_BINARY_SENSOR("", "Beeper On", this->beeper_on_);
+  LOG_BINARY_SENSOR("", "Link", this->link_);
+
+  LOG_SENSOR("", "Estimated Runtime", this->estimated_runtime_);
+  LOG_SENSOR("", "State Of Charge", this->state_of_charge_);
+
+  LOG_SENSOR("", "Command Queue Depth", this->command_queue_depth_);
+  LOG_SENSOR("", "Command Queue Dropped", this->command_queue_dropped_);
+  LOG_SENSOR("", "Sample Rate", this->sample_rate_);
+  LOG_SENSOR("", "Sequence Result", this->sequence_result_);
+  LOG_SENSOR("", "Poll Latency", this->poll_latency_);
+  LOG_SENSOR("", "Command Latency", this->command_latency_);
+  LOG_SENSOR("", "Poll To Publish Latency", this->poll_to_publish_latency_);
+  LOG_SENSOR("", "Timeout Count", this->timeout_count_);
+  LOG_SENSOR("", "NAK Count", this->nak_count_);
+  LOG_SENSOR("", "Parse Failure Count", this->parse_failure_count_);
+  LOG_SENSOR("", "RX Overflow Count", this->rx_overflow_count_);
+  LOG_SENSOR("", "Loop Time Average", this->loop_time_average_);
+  LOG_SENSOR("", "Loop Time Max", this->loop_time_max_);
 
   LOG_TEXT_SENSOR("", "Last Q1", this->last_q1_);
   LOG_TEXT_SENSOR("", "Last F", this->last_f_);
+  LOG_TEXT_SENSOR("", "History", this->history_);
+  LOG_TEXT_SENSOR("", "Telemetry", this->telemetry_);
+  LOG_TEXT_SENSOR("", "Power Quality", this->power_quality_);
+  LOG_TEXT_SENSOR("", "Power Quality Event", this->power_quality_event_);
   LOG_TEXT_SENSOR("", "UPS Information", this->ups_info_);
 }
 
@@ -420,12 +1942,18 @@ void Powermust::add_polling_command_(const char *command, ENUMPollingCommand pol
   for (auto &used : this->used_polling_commands_) {
     if (used.length == 0) {
       size_t len = strlen(command);
-      used.command = new uint8_t[len + 1];
-      memcpy(used.command, command, len);
-      used.command[len] = '\0';
+      if (len > MAX_POLLING_COMMAND_LENGTH) {
+        ESP_LOGE(TAG, "Polling command %s too long", command);
+        return;
+      }
+      memcpy(used.command, command, len + 1);
       used.length = len;
+      used.rtt = RttEstimator(COMMAND_TIMEOUT);
       used.identifier = polling_command;
       used.errors = 0;
+      used.pending = true;
+      used.attempts = 0;
+      used.last_run = 0;
       return;
     }
     if (used.length == strlen(command) && memcmp(used.command, command, used.length) == 0) {
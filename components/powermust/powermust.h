@@ -6,6 +6,36 @@
 #include "esphome/components/uart/uart.h"
 #include "esphome/core/automation.h"
 #include "esphome/core/component.h"
+#include "esphome/core/defines.h"
+#include "esphome/core/preferences.h"
+#include "device_profile.h"
+#include "frame_assembler.h"
+#include "megatec_decoder.h"
+#include "powermust_bus.h"
+#include "rtt_estimator.h"
+#include "runtime_estimator.h"
+#ifdef USE_POWERMUST_HISTORY
+#include "telemetry_history.h"
+#endif
+#ifdef USE_POWERMUST_INSTRUMENTATION
+#include "instrumentation.h"
+#endif
+#ifdef USE_POWERMUST_POWER_QUALITY
+#include "power_quality.h"
+#endif
+#ifdef USE_POWERMUST_CAPTURE
+#include "capture_buffer.h"
+#endif
+#ifdef USE_POWERMUST_SEQUENCES
+#include "command_sequence.h"
+#endif
+#ifdef USE_POWERMUST_TRANSPORT_TASK
+#include "uart_transport.h"
+#endif
+#ifdef USE_POWERMUST_AGGREGATION
+#include "sample_aggregator.h"
+#endif
+#include <limits>
 
 namespace esphome {
 namespace powermust {
@@ -16,21 +46,154 @@ enum ENUMPollingCommand {
   POLLING_I = 2,  // ← Comando I: UPS Information
 };
 
+enum PollingPolicy : uint8_t {
+  POLLING_POLICY_INTERVAL = 0,      // Cada `interval`
+  POLLING_POLICY_ONCE = 1,          // Una sola vez al arrancar
+  POLLING_POLICY_ON_RECONNECT = 2,  // Al arrancar, cada `interval` y cuando el SAI vuelve a responder
+};
+
+struct PollingSchedule {
+  uint32_t interval;  // 0 = update_interval
+  uint8_t priority;   // Mayor valor, antes se envía
+  PollingPolicy policy;
+};
+
+// Longitud máxima de un comando de polling ("Q1")
+static const uint8_t MAX_POLLING_COMMAND_LENGTH = 3;
+
 struct PollingCommand {
-  uint8_t *command;
+  char command[MAX_POLLING_COMMAND_LENGTH + 1];  // Almacenamiento estático, sin new
   uint8_t length = 0;
   uint8_t errors;
   ENUMPollingCommand identifier;
+  uint32_t interval;
+  uint8_t priority;
+  PollingPolicy policy;
+  uint32_t last_run;
+  bool pending;      // Aún no ha respondido desde el arranque / reconexión
+  uint8_t attempts;  // Envíos sin respuesta válida
+  RttEstimator rtt;  // Timeout según el tiempo de respuesta medido
+};
+
+// Longitud máxima de un comando en cola (S02R0060 ocupa 8)
+static const uint8_t MAX_COMMAND_LENGTH = 15;
+
+// Clases de prioridad de la cola de comandos: a mayor valor, antes se envía
+enum CommandPriority : uint8_t {
+  COMMAND_PRIORITY_NORMAL = 0,    // Q (beeper) y comandos desconocidos
+  COMMAND_PRIORITY_TEST = 1,      // T, TL, T10, CT
+  COMMAND_PRIORITY_SHUTDOWN = 2,  // S.., C
+};
+
+// Comandos Megatec conocidos; índice en Powermust::COMMAND_DESCRIPTORS
+enum CommandId : uint8_t {
+  COMMAND_UNKNOWN = 0,
+  COMMAND_QUICK_TEST,        // T
+  COMMAND_DEEP_TEST,         // TL
+  COMMAND_TEN_MINUTES_TEST,  // T<n>, T10
+  COMMAND_CANCEL_TEST,       // CT
+  COMMAND_BEEPER_TOGGLE,     // Q
+  COMMAND_SHUTDOWN,          // S<n>
+  COMMAND_SHUTDOWN_RESTORE,  // S<n>R<m>
+  COMMAND_CANCEL_SHUTDOWN,   // C
+  COMMAND_CL,                // CL
+  COMMAND_COUNT,
+};
+
+enum ReplyType : uint8_t {
+  REPLY_NONE = 0,  // No se espera respuesta
+  REPLY_ACK = 1,   // ACK / NAK
 };
 
+// Flancos de los bits de estado del Q1 que disparan automatizaciones
+enum PowerEvent : uint8_t {
+  POWER_EVENT_UTILITY_FAIL = 0,  // utility fail 0 → 1
+  POWER_EVENT_UTILITY_RESTORED,  // utility fail 1 → 0
+  POWER_EVENT_BATTERY_LOW,       // battery low 0 → 1
+  POWER_EVENT_UPS_FAILED,        // UPS failed 0 → 1
+  POWER_EVENT_TEST_FINISHED,     // test in progress 1 → 0
+};
+
+class Powermust;
+
+struct CommandDescriptor {
+  const char *name;
+  ReplyType reply;
+  uint16_t timeout;  // ms; inicial, después se ajusta al tiempo de respuesta medido
+  uint8_t retries;   // Reenvíos si no hay respuesta
+  CommandPriority priority;
+  void (Powermust::*on_complete)();  // Al recibir ACK (o sin respuesta si no se espera)
+};
+
+// Hueco de la cola de comandos con el texto en línea, sin std::string
+struct QueuedCommand {
+  char command[MAX_COMMAND_LENGTH + 1];
+  uint8_t length{0};  // 0 = hueco libre
+  CommandId id;
+  CommandPriority priority;
+  uint8_t attempts;
+  bool in_flight;     // Enviado, esperando ACK/NAK
+  uint32_t sequence;  // Orden de llegada dentro de la misma prioridad
+  bool from_sequence;  // Paso de la secuencia en curso (USE_POWERMUST_SEQUENCES)
+};
+
+// Decide si una entidad se publica: cuando el valor sale de la banda muerta respecto
+// al último valor publicado, o cuando lleva max_silence ms sin publicarse (heartbeat).
+struct PublishFilter {
+  bool on_change{false};  // false = publicar cada muestra
+  float absolute{0.0f};
+  float relative{0.0f};     // Fracción del último valor publicado
+  uint32_t max_silence{0};  // 0 = sin heartbeat
+  float last_value{0.0f};
+  uint32_t last_millis{0};
+  bool published{false};
+
+  void configure(float absolute, float relative, uint32_t max_silence);
+  bool check(float value, uint32_t now);
+};
+
+// Filtro compartido por las entidades desactivadas en compilación; nunca se llega a usar
+inline PublishFilter disabled_publish_filter;  // NOLINT
+
+// La configuración generada define POWERMUST_HAS_<entidad> a 1 para las entidades
+// configuradas en cualquier unidad y a 0 para las demás (USE_POWERMUST_ENTITIES). Una
+// entidad desactivada no ocupa RAM: su puntero es un nullptr constante, su filtro es el
+// compartido, su valor decodificado es una constante (NAN o 0) que POWERMUST_STORE_ no
+// escribe, y el compilador elimina las comprobaciones y publicaciones que la usan. El
+// histórico, la telemetría y las estimaciones leen la muestra Q1 y el perfil, no estos
+// valores. Sin USE_POWERMUST_ENTITIES todas las entidades están disponibles.
+#ifdef USE_POWERMUST_ENTITIES
+#define POWERMUST_HAS_(name) POWERMUST_HAS_##name
+#else
+#define POWERMUST_HAS_(name) 1
+#endif
+#define POWERMUST_CONCAT_(prefix, enabled) prefix##enabled
+#define POWERMUST_SELECT_(prefix, enabled) POWERMUST_CONCAT_(prefix, enabled)
+
 #define POWERMUST_VALUED_ENTITY_(type, name, polling_command, value_type) \
- protected: \
-  value_type value_##name##_; \
+  POWERMUST_SELECT_(POWERMUST_VALUE_ENABLED_, POWERMUST_HAS_(name))(name, value_type) \
   POWERMUST_ENTITY_(type, name, polling_command)
 
+#define POWERMUST_VALUE_ENABLED_1(name, value_type) \
+ protected: \
+  value_type value_##name##_;
+
+#define POWERMUST_VALUE_ENABLED_0(name, value_type) \
+ protected: \
+  static constexpr value_type value_##name##_ = std::numeric_limits<value_type>::quiet_NaN(); /* NOLINT */
+
+// Guarda el valor de una entidad; no hace nada si la entidad no está compilada
+#define POWERMUST_STORE_(name, value) POWERMUST_SELECT_(POWERMUST_STORE_ENABLED_, POWERMUST_HAS_(name))(name, value)
+#define POWERMUST_STORE_ENABLED_1(name, value) (this->value_##name##_ = (value))
+#define POWERMUST_STORE_ENABLED_0(name, value) ((void) 0)
+
 #define POWERMUST_ENTITY_(type, name, polling_command) \
+  POWERMUST_SELECT_(POWERMUST_ENTITY_ENABLED_, POWERMUST_HAS_(name))(type, name, polling_command)
+
+#define POWERMUST_ENTITY_ENABLED_1(type, name, polling_command) \
  protected: \
   type *name##_{}; /* NOLINT */ \
+  PublishFilter name##_filter_{}; /* NOLINT */ \
 \
  public: \
   void set_##name(type *name) { /* NOLINT */ \
@@ -38,8 +201,18 @@ struct PollingCommand {
     this->add_polling_command_(#polling_command, POLLING_##polling_command); \
   }
 
+#define POWERMUST_ENTITY_ENABLED_0(type, name, polling_command) \
+ protected: \
+  static constexpr type *name##_ = nullptr; /* NOLINT */ \
+  static inline PublishFilter &name##_filter_ = disabled_publish_filter; /* NOLINT */ \
+\
+ public:
+
 #define POWERMUST_SENSOR(name, polling_command, value_type) \
-  POWERMUST_VALUED_ENTITY_(sensor::Sensor, name, polling_command, value_type)
+  POWERMUST_VALUED_ENTITY_(sensor::Sensor, name, polling_command, value_type) \
+  void set_##name##_publish_filter(float absolute, float relative, uint32_t max_silence) { /* NOLINT */ \
+    this->name##_filter_.configure(absolute, relative, max_silence); \
+  }
 
 #define POWERMUST_SWITCH(name, polling_command) POWERMUST_ENTITY_(switch_::Switch, name, polling_command)
 
@@ -51,6 +224,97 @@ struct PollingCommand {
 
 #define POWERMUST_TEXT_SENSOR(name, polling_command) POWERMUST_ENTITY_(text_sensor::TextSensor, name, polling_command)
 
+// Sensores de diagnóstico del propio componente: no registran comandos de polling
+#define POWERMUST_DIAGNOSTIC_SENSOR(name) \
+  POWERMUST_SELECT_(POWERMUST_DIAGNOSTIC_SENSOR_ENABLED_, POWERMUST_HAS_(name))(name)
+
+#define POWERMUST_DIAGNOSTIC_SENSOR_ENABLED_1(name) \
+ protected: \
+  sensor::Sensor *name##_{}; /* NOLINT */ \
+\
+ public: \
+  void set_##name(sensor::Sensor *name) { this->name##_ = name; } /* NOLINT */
+
+#define POWERMUST_DIAGNOSTIC_SENSOR_ENABLED_0(name) \
+ protected: \
+  static constexpr sensor::Sensor *name##_ = nullptr; /* NOLINT */ \
+\
+ public:
+
+// Mínimo, máximo y media por ventana de un valor del Q1 (USE_POWERMUST_AGGREGATION)
+#define POWERMUST_AGGREGATE_SENSOR(name) \
+  POWERMUST_SELECT_(POWERMUST_AGGREGATE_SENSOR_ENABLED_, POWERMUST_HAS_(name))(name)
+
+#define POWERMUST_AGGREGATE_SENSOR_ENABLED_1(name) \
+ protected: \
+  sensor::Sensor *name##_{}; /* NOLINT */ \
+\
+ public: \
+  void set_##name(sensor::Sensor *name) { /* NOLINT */ \
+    this->name##_ = name; \
+    this->add_polling_command_("Q1", POLLING_Q1); \
+  }
+
+#define POWERMUST_AGGREGATE_SENSOR_ENABLED_0(name) POWERMUST_DIAGNOSTIC_SENSOR_ENABLED_0(name)
+
+#define POWERMUST_AGGREGATE_SENSORS(name) \
+  POWERMUST_AGGREGATE_SENSOR(name##_min) \
+  POWERMUST_AGGREGATE_SENSOR(name##_max) \
+  POWERMUST_AGGREGATE_SENSOR(name##_avg)
+
+#define POWERMUST_DIAGNOSTIC_BINARY_SENSOR(name) \
+  POWERMUST_SELECT_(POWERMUST_DIAGNOSTIC_BINARY_SENSOR_ENABLED_, POWERMUST_HAS_(name))(name)
+
+#define POWERMUST_DIAGNOSTIC_BINARY_SENSOR_ENABLED_1(name) \
+ protected: \
+  binary_sensor::BinarySensor *name##_{}; /* NOLINT */ \
+  PublishFilter name##_filter_{}; /* NOLINT */ \
+\
+ public: \
+  void set_##name(binary_sensor::BinarySensor *name) { this->name##_ = name; } /* NOLINT */
+
+#define POWERMUST_DIAGNOSTIC_BINARY_SENSOR_ENABLED_0(name) POWERMUST_ENTITY_ENABLED_0(binary_sensor::BinarySensor, name, )
+
+// Campos del Q1 que se convierten al decodificar: los de las entidades compiladas y los
+// que leen el polling adaptativo (USE_POWERMUST_ADAPTIVE_POLLING) y la estimación de
+// autonomía. El histórico, la calidad de red, la agregación, la telemetría y los disparadores
+// de eventos de alimentación (USE_POWERMUST_POWER_EVENTS) usan la muestra entera.
+#if defined(USE_POWERMUST_HISTORY) || defined(USE_POWERMUST_POWER_QUALITY) || defined(USE_POWERMUST_AGGREGATION) || \
+    defined(USE_POWERMUST_POWER_EVENTS) || POWERMUST_HAS_(telemetry)
+static constexpr uint8_t Q1_DECODED_FIELDS = Q1_ALL_FIELDS;
+#else
+#ifdef USE_POWERMUST_ADAPTIVE_POLLING
+static constexpr bool Q1_ADAPTIVE_FIELDS = true;  // Red, carga y batería
+#else
+static constexpr bool Q1_ADAPTIVE_FIELDS = false;
+#endif
+static constexpr bool Q1_RUNTIME_FIELDS = POWERMUST_HAS_(estimated_runtime) || POWERMUST_HAS_(state_of_charge);
+static constexpr uint8_t Q1_DECODED_FIELDS =
+    (POWERMUST_HAS_(grid_voltage) || Q1_ADAPTIVE_FIELDS ? Q1_FIELD_GRID_VOLTAGE : 0) |
+    (POWERMUST_HAS_(grid_fault_voltage) ? Q1_FIELD_GRID_FAULT_VOLTAGE : 0) |
+    (POWERMUST_HAS_(ac_output_voltage) ? Q1_FIELD_AC_OUTPUT_VOLTAGE : 0) |
+    (POWERMUST_HAS_(ac_output_load_percent) || Q1_ADAPTIVE_FIELDS || Q1_RUNTIME_FIELDS
+         ? Q1_FIELD_AC_OUTPUT_LOAD_PERCENT
+         : 0) |
+    (POWERMUST_HAS_(grid_frequency) ? Q1_FIELD_GRID_FREQUENCY : 0) |
+    (POWERMUST_HAS_(battery_voltage) || Q1_ADAPTIVE_FIELDS || Q1_RUNTIME_FIELDS ? Q1_FIELD_BATTERY_VOLTAGE : 0) |
+    (POWERMUST_HAS_(temperature) ? Q1_FIELD_TEMPERATURE : 0);
+#endif
+
+#ifdef USE_POWERMUST_TRANSPORT_TASK
+// La tarea de transporte es la única que usa la UART del componente
+class UartTransportStream : public TransportStream {
+ public:
+  explicit UartTransportStream(uart::UARTDevice *device) : device_(device) {}
+  size_t available() override { return this->device_->available(); }
+  bool read(uint8_t *data, size_t length) override { return this->device_->read_array(data, length); }
+  void write(const uint8_t *data, size_t length) override { this->device_->write_array(data, length); }
+
+ protected:
+  uart::UARTDevice *device_;
+};
+#endif
+
 class Powermust : public uart::UARTDevice, public PollingComponent {
   // ------------------- Q1 -------------------
   POWERMUST_SENSOR(grid_voltage, Q1, float)
@@ -75,6 +339,18 @@ class Powermust : public uart::UARTDevice, public PollingComponent {
   POWERMUST_SWITCH(deep_test_switch, Q1)
   POWERMUST_SWITCH(ten_minutes_test_switch, Q1)
 
+  // Agregados por ventana del Q1
+  POWERMUST_AGGREGATE_SENSORS(grid_voltage)
+  POWERMUST_AGGREGATE_SENSORS(ac_output_voltage)
+  POWERMUST_AGGREGATE_SENSORS(ac_output_load_percent)
+  POWERMUST_AGGREGATE_SENSORS(battery_voltage)
+  POWERMUST_AGGREGATE_SENSORS(grid_frequency)
+  POWERMUST_AGGREGATE_SENSORS(temperature)
+
+  // Estimación a partir de Q1 (y de la tensión nominal de F)
+  POWERMUST_SENSOR(estimated_runtime, Q1, float)
+  POWERMUST_SENSOR(state_of_charge, Q1, float)
+
   // ------------------- F -------------------
   POWERMUST_SENSOR(ac_output_rating_voltage, F, float)
   POWERMUST_SENSOR(ac_output_rating_current, F, int)
@@ -83,17 +359,99 @@ class Powermust : public uart::UARTDevice, public PollingComponent {
 
   POWERMUST_TEXT_SENSOR(last_q1, Q1)
   POWERMUST_TEXT_SENSOR(last_f, F)
+  POWERMUST_TEXT_SENSOR(history, Q1)
+  POWERMUST_TEXT_SENSOR(telemetry, Q1)
+  POWERMUST_TEXT_SENSOR(power_quality, Q1)
+  POWERMUST_TEXT_SENSOR(power_quality_event, Q1)
 
   // ------------------- I: UPS Information -------------------
   POWERMUST_TEXT_SENSOR(ups_info, I)  // ← Comando I: #MUST 800VA 12V 50Hz 1.0
 
+  // ------------------- Diagnóstico -------------------
+  POWERMUST_DIAGNOSTIC_SENSOR(command_queue_depth)
+  POWERMUST_DIAGNOSTIC_SENSOR(command_queue_dropped)
+  POWERMUST_DIAGNOSTIC_SENSOR(sample_rate)
+  POWERMUST_DIAGNOSTIC_SENSOR(sequence_result)
+  POWERMUST_DIAGNOSTIC_BINARY_SENSOR(link)
+
+  // Instrumentación (USE_POWERMUST_INSTRUMENTATION)
+  POWERMUST_DIAGNOSTIC_SENSOR(poll_latency)
+  POWERMUST_DIAGNOSTIC_SENSOR(command_latency)
+  POWERMUST_DIAGNOSTIC_SENSOR(poll_to_publish_latency)
+  POWERMUST_DIAGNOSTIC_SENSOR(timeout_count)
+  POWERMUST_DIAGNOSTIC_SENSOR(nak_count)
+  POWERMUST_DIAGNOSTIC_SENSOR(parse_failure_count)
+  POWERMUST_DIAGNOSTIC_SENSOR(rx_overflow_count)
+  POWERMUST_DIAGNOSTIC_SENSOR(loop_time_average)
+  POWERMUST_DIAGNOSTIC_SENSOR(loop_time_max)
+
   // ------------------- SHUTDOWN SWITCHES -------------------
   void set_shutdown_switch(switch_::Switch *s) { shutdown_switch_ = s; }
   void set_shutdown_restore_switch(switch_::Switch *s) { shutdown_restore_switch_ = s; }
   void set_cancel_shutdown_switch(switch_::Switch *s) { cancel_shutdown_switch_ = s; }
 
   // -----------------------------------------------------------------
-  void switch_command(const std::string &command);
+  void set_polling_schedule(ENUMPollingCommand command, uint32_t interval, uint8_t priority, PollingPolicy policy);
+  void set_device_profile(bool device_profile) { this->device_profile_ = device_profile; }
+  // Hash del id de la unidad; distingue sus preferencias de las de las demás unidades
+  void set_preference_key(uint32_t preference_key) { this->preference_key_ = preference_key; }
+  void set_adaptive_polling(uint32_t min_interval, uint32_t max_interval, uint32_t hysteresis);
+  void set_adaptive_thresholds(int load_change, float grid_voltage_change, float battery_voltage_change);
+  void switch_command(const char *command);
+#ifdef USE_POWERMUST_HISTORY
+  // El define compila el historial; solo lo usan las unidades configuradas con history
+  void set_history_downsampling(bool downsampling) {
+    this->telemetry_history_.set_downsampling(downsampling);
+    this->history_enabled_ = true;
+  }
+#endif
+#ifdef USE_POWERMUST_POWER_QUALITY
+  // El define compila el monitor; solo lo usan las unidades configuradas con estos setters
+  void set_power_quality_window(uint32_t window) {
+    this->power_quality_monitor_.set_window(window);
+    this->power_quality_enabled_ = true;
+  }
+  void set_power_quality_thresholds(float sag, float swell, float frequency_deviation) {
+    this->power_quality_monitor_.set_thresholds(sag, swell, frequency_deviation);
+    this->power_quality_enabled_ = true;
+  }
+  void set_power_quality_nominal(float voltage, float frequency) {
+    this->power_quality_monitor_.set_nominal(voltage, frequency);
+    this->power_quality_enabled_ = true;
+  }
+#endif
+#ifdef USE_POWERMUST_AGGREGATION
+  // 0 = la unidad publica cada muestra, como sin el define
+  void set_aggregation_window(uint32_t window) { this->aggregator_.set_window(window); }
+#endif
+#ifdef USE_POWERMUST_EVENT_DRIVEN
+  // El define compila el soporte; cada unidad decide si su loop() se detiene entre polls
+  void set_event_driven(bool event_driven) { this->event_driven_ = event_driven; }
+#endif
+#ifdef USE_POWERMUST_TRANSPORT_TASK
+  // El define compila la tarea; cada unidad decide si su UART la atiende la tarea o loop()
+  void set_transport_task(bool transport_task) { this->transport_task_ = transport_task; }
+#endif
+  // Publica en el text sensor "history" los registros guardados desde la última exportación
+  void export_history();
+  // Vuelca al log, en base64, el tráfico capturado de la UART (tools/powermust_capture.py)
+  void dump_capture();
+#ifdef USE_POWERMUST_CAPTURE
+  void set_capture_size(size_t size) { this->capture_.set_capacity(size); }
+#endif
+#ifdef USE_POWERMUST_SEQUENCES
+  // Ejecuta los pasos de la secuencia en orden; false si ya hay otra en curso
+  bool run_sequence(const CommandSequence *sequence);
+  void add_on_sequence_finished_callback(std::function<void(const SequenceResult &)> &&callback) {
+    this->sequence_callback_.add(std::move(callback));
+  }
+#endif
+  // Se llama desde la decodificación del Q1, antes de publicar ninguna entidad
+  void add_on_power_event_callback(std::function<void(PowerEvent, const Q1Sample &)> &&callback) {
+    this->power_event_callback_.add(std::move(callback));
+  }
+  // Muestras Q1 decodificadas por minuto en la última ventana
+  float get_sample_rate() const { return this->sample_rate_value_; }
   void setup() override;
   void loop() override;
   void dump_config() override;
@@ -101,25 +459,155 @@ class Powermust : public uart::UARTDevice, public PollingComponent {
 
  protected:
   // -----------------------------------------------------------------
-  static const size_t POWERMUST_READ_BUFFER_LENGTH = 110;
   static const size_t COMMAND_QUEUE_LENGTH = 10;
-  static const size_t COMMAND_TIMEOUT = 1000;
-
-  uint32_t last_poll_ = 0;
+  // Timeout inicial de los polls, hasta tener medidas del tiempo de respuesta
+  static const uint16_t COMMAND_TIMEOUT = 1000;
+  static const CommandDescriptor COMMAND_DESCRIPTORS[COMMAND_COUNT];
+  static const uint8_t MAX_POLLING_COMMANDS = 15;
+  // Polls fallidos seguidos a partir de los cuales se considera perdido el enlace
+  static const uint8_t LINK_LOST_POLL_FAILURES = 3;
+  static const uint8_t MAX_PENDING_ATTEMPTS = 3;
+  // Reenvíos inmediatos de un poll perdido o corrupto con el enlace activo
+  static const uint8_t MAX_POLL_RETRIES = 2;
+  // Con el enlace caído el intervalo entre polls se duplica tras cada fallo hasta este límite
+  static const uint32_t MAX_LINK_BACKOFF = 60000;
+  // En modo por eventos loop() se reactiva al menos con esta frecuencia
+  static const uint32_t MAX_IDLE_SLEEP = 60000;
+  static const uint32_t SAMPLE_RATE_WINDOW = 60000;
+  static const uint32_t INSTRUMENTATION_INTERVAL = 60000;
+  // 14 registros en base64 más la cabecera caben en los 255 caracteres de un estado
+  static const uint8_t HISTORY_CHUNK_RECORDS = 14;
+  // Registro de telemetría más largo (~210 caracteres) con margen, dentro de los 255 de un estado
+  static const size_t TELEMETRY_LENGTH = 256;
+  // Resumen de ventana y evento de calidad de red (~170 y ~80 caracteres)
+  static const size_t POWER_QUALITY_LENGTH = 192;
+  // 144 bytes de captura son 192 caracteres en base64 por línea de log
+  static const size_t CAPTURE_CHUNK_LENGTH = 144;
 
   void add_polling_command_(const char *command, ENUMPollingCommand polling_command);
+  void read_uart_();
+  void write_frame_(const char *command, size_t length);
+  void send_frame_(const char *command, size_t length, char expect, uint32_t timeout);
+  bool next_frame_();
+  uint32_t reply_elapsed_() const;
+  bool reply_timed_out_(uint32_t timeout) const;
+  bool frame_matches_poll_();
+  bool frame_matches_command_();
   void empty_uart_buffer_();
-  uint8_t check_incoming_crc_();
-  uint8_t check_incoming_length_(uint8_t length);
+  // El nullptr se comprueba en línea: con una entidad desactivada en compilación la llamada desaparece
+  void publish_sensor_(sensor::Sensor *sensor, PublishFilter &filter, float value) {
+    if (sensor != nullptr)
+      this->publish_sensor_state_(sensor, filter, value);
+  }
+  void publish_binary_sensor_(binary_sensor::BinarySensor *binary_sensor, PublishFilter &filter, bool value) {
+    if (binary_sensor != nullptr)
+      this->publish_binary_sensor_state_(binary_sensor, filter, value);
+  }
+  void publish_switch_(switch_::Switch *a_switch, PublishFilter &filter, bool value) {
+    if (a_switch != nullptr)
+      this->publish_switch_state_(a_switch, filter, value);
+  }
+  void publish_text_sensor_(text_sensor::TextSensor *text_sensor, PublishFilter &filter, const char *value,
+                            size_t length) {
+    if (text_sensor != nullptr)
+      this->publish_text_sensor_state_(text_sensor, filter, value, length);
+  }
+  // Publicación directa, sin filtro (diagnóstico y registros)
+  template<typename T, typename V> void publish_state_(T *entity, const V &value) {
+    if (entity != nullptr)
+      entity->publish_state(value);
+  }
+  void publish_sensor_state_(sensor::Sensor *sensor, PublishFilter &filter, float value);
+  void publish_binary_sensor_state_(binary_sensor::BinarySensor *binary_sensor, PublishFilter &filter, bool value);
+  void publish_switch_state_(switch_::Switch *a_switch, PublishFilter &filter, bool value);
+  void publish_text_sensor_state_(text_sensor::TextSensor *text_sensor, PublishFilter &filter, const char *value,
+                            size_t length);
+  void apply_q1_(const Q1Sample &sample);
+  void publish_telemetry_(const Q1Sample &sample);
+#ifdef USE_POWERMUST_POWER_QUALITY
+  void publish_power_quality_();
+#endif
+#ifdef USE_POWERMUST_AGGREGATION
+  void publish_aggregates_();
+#endif
+  void fire_power_events_(const Q1Sample &sample);
   uint8_t send_next_command_();
   void send_next_poll_();
-  void queue_command_(const char *command, uint8_t length);
+  void write_poll_(const PollingCommand &cmd, uint32_t now);
+  bool is_poll_due_(const PollingCommand &cmd, uint32_t now) const;
+  uint32_t poll_due_in_(const PollingCommand &cmd, uint32_t now) const;
+#ifdef USE_POWERMUST_EVENT_DRIVEN
+  void sleep_until_next_poll_();
+  void wake_up_();
+  bool event_driven_{false};
+#endif
+  uint32_t polling_interval_(const PollingCommand &cmd) const;
+  void update_adaptive_interval_();
+  void update_runtime_estimate_();
+  void apply_device_profile_();
+  void update_device_profile_();
+  void save_device_profile_();
+  bool is_probe_settled_(ENUMPollingCommand identifier) const;
+  bool is_probe_failed_(ENUMPollingCommand identifier) const;
+#ifdef USE_POWERMUST_CAPTURE
+  void dump_capture_chunk_();
+#endif
+#ifdef USE_POWERMUST_HISTORY
+  void export_history_chunk_();
+#endif
+  void poll_succeeded_();
+  enum PollFailure : uint8_t { POLL_FAILURE_TIMEOUT, POLL_FAILURE_NAK, POLL_FAILURE_PARSE };
+  void poll_failed_(PollFailure reason);
+  bool is_link_lost_() const { return this->poll_failures_ >= LINK_LOST_POLL_FAILURES; }
+  void link_lost_();
+  uint32_t command_timeout_(CommandId id) const;
+  // Hueco de la cola que ejecutará el comando, -1 si se ha descartado
+  int8_t queue_command_(const char *command, size_t length);
+  static CommandId resolve_command_(const char *command);
+  void remove_queued_command_(uint8_t slot);
+  void complete_quick_test_();
+  void complete_deep_test_();
+  void complete_ten_minutes_test_();
+  void complete_cancel_test_();
+  void complete_shutdown_();
+  void complete_shutdown_restore_();
+  void complete_cancel_shutdown_();
+  int8_t next_queued_command_() const;
+  void publish_command_queue_stats_();
+#ifdef USE_POWERMUST_SEQUENCES
+  enum SequencePhase : uint8_t {
+    SEQUENCE_PHASE_COMMAND,  // Esperando el ACK del comando del paso
+    SEQUENCE_PHASE_VERIFY,   // Q1 seguidos hasta ver el bit de estado esperado
+  };
+  bool is_verifying_sequence_() const {
+    return this->sequence_ != nullptr && this->sequence_phase_ == SEQUENCE_PHASE_VERIFY;
+  }
+  void start_sequence_step_();
+  void next_sequence_step_();
+  void sequence_command_complete_(bool success);
+  void verify_sequence_step_(const Q1Sample &sample);
+  void check_sequence_timeout_();
+  void finish_sequence_(const char *reason);
+#endif
 
-  std::string command_queue_[COMMAND_QUEUE_LENGTH];
-  uint8_t command_queue_position_ = 0;
+  QueuedCommand command_queue_[COMMAND_QUEUE_LENGTH];
+  RttEstimator command_rtt_[COMMAND_COUNT];
+  uint8_t current_command_{0};
+  bool command_timed_out_{false};
+  uint32_t command_sequence_{0};
+  uint8_t queue_depth_{0};
+  uint32_t queue_dropped_{0};
+  uint32_t queue_coalesced_{0};
 
-  uint8_t read_buffer_[POWERMUST_READ_BUFFER_LENGTH];
-  size_t read_pos_{0};
+  FrameAssembler rx_;
+#ifdef USE_POWERMUST_TRANSPORT_TASK
+  UartTransport transport_;
+  UartTransportStream transport_stream_{this};
+  bool transport_task_{false};
+  bool transport_timed_out_{false};  // La tarea ha dado por perdida la respuesta
+  uint32_t transport_elapsed_{0};
+#endif
+  bool poll_timed_out_{false};
   uint32_t command_start_millis_ = 0;
 
   uint8_t state_;
@@ -134,7 +622,105 @@ class Powermust : public uart::UARTDevice, public PollingComponent {
   };
 
   uint8_t last_polling_command_ = 0;
-  PollingCommand used_polling_commands_[15];
+  PollingCommand used_polling_commands_[MAX_POLLING_COMMANDS];
+  uint8_t poll_failures_{0};
+  uint8_t poll_retries_{0};   // Reenvíos inmediatos del último poll
+  bool poll_retry_{false};    // Reenviar el último poll en la siguiente pasada
+  bool poll_resent_{false};   // El poll en curso es un reenvío: no se mide su RTT
+  uint32_t link_backoff_{0};  // Intervalo entre polls con el enlace caído, 0 = enlace activo
+  uint32_t last_poll_millis_{0};
+
+  CallbackManager<void(PowerEvent, const Q1Sample &)> power_event_callback_;
+  Q1Sample q1_sample_{};  // Última muestra Q1 decodificada
+
+  uint32_t telemetry_sequence_{0};
+  bool telemetry_ratings_{false};  // Valores nominales nuevos pendientes de enviar
+  uint32_t telemetry_f_hash_{0};
+  uint8_t last_q1_status_{0};  // Al arrancar todo en reposo: un corte ya presente dispara on_utility_fail
+
+  uint32_t setup_millis_{0};
+  bool phase_aligned_{false};
+  uint32_t q1_samples_{0};
+  float sample_rate_value_{0.0f};
+
+  // Polling adaptativo del Q1: rápido ante eventos, lento con la red estable
+  bool adaptive_polling_{false};
+  uint32_t adaptive_min_interval_{1000};
+  uint32_t adaptive_max_interval_{30000};
+  uint32_t adaptive_hysteresis_{60000};
+  int adaptive_load_change_{10};
+  float adaptive_grid_voltage_change_{5.0f};
+  float adaptive_battery_voltage_change_{0.3f};
+  uint32_t adaptive_interval_{0};
+  uint32_t adaptive_changed_millis_{0};
+  int adaptive_last_load_{-1};
+  float adaptive_last_grid_voltage_{NAN};
+  float adaptive_last_battery_voltage_{NAN};
+
+#ifdef USE_POWERMUST_INSTRUMENTATION
+  void publish_instrumentation_();
+
+  LatencyHistogram poll_latency_histograms_[3];  // Por ENUMPollingCommand
+  LatencyHistogram command_latency_histograms_[COMMAND_COUNT];
+  LatencyHistogram poll_to_publish_histogram_;
+  LoopTimer loop_timer_;  // Ventana actual, se reinicia al publicar
+  uint32_t loop_time_max_us_{0};  // Desde el arranque
+  uint32_t timeout_counter_{0};
+  uint32_t nak_counter_{0};
+  uint32_t parse_failure_counter_{0};
+#endif
+
+  // Perfil del SAI: F e I solo se piden en la exploración inicial y al reconectar
+  bool device_profile_{true};
+  DeviceProfile profile_{};
+  DeviceProfile saved_profile_{};
+  ESPPreferenceObject profile_pref_;
+  uint8_t profile_answered_{0};  // Capacidades F/I vistas desde la última exploración
+  bool profile_verifying_{false};  // Arranque en caliente: falta confirmar que es el mismo SAI
+
+  RuntimeEstimator runtime_estimator_;
+  uint32_t preference_key_{0};
+  ESPPreferenceObject runtime_model_pref_;
+  bool runtime_estimation_{false};
+
+#ifdef USE_POWERMUST_HISTORY
+  TelemetryHistory telemetry_history_;
+  bool history_enabled_{false};
+  bool history_exporting_{false};
+#endif
+
+#ifdef USE_POWERMUST_CAPTURE
+  CaptureBuffer capture_;
+  size_t capture_offset_{0};
+  bool capture_dumping_{false};  // La captura se pausa mientras se vuelca
+#endif
+
+#ifdef USE_POWERMUST_SEQUENCES
+  const CommandSequence *sequence_{nullptr};  // Secuencia en curso
+  uint8_t sequence_step_{0};
+  SequencePhase sequence_phase_{SEQUENCE_PHASE_COMMAND};
+  uint32_t sequence_step_millis_{0};
+  CallbackManager<void(const SequenceResult &)> sequence_callback_;
+#endif
+
+#ifdef USE_POWERMUST_POWER_QUALITY
+  PowerQualityMonitor power_quality_monitor_;
+  bool power_quality_enabled_{false};
+  uint32_t power_quality_windows_published_{0};
+  uint32_t power_quality_events_published_{0};
+#endif
+
+#ifdef USE_POWERMUST_AGGREGATION
+  SampleAggregator aggregator_;
+  bool aggregate_window_closed_{false};  // El último Q1 ha cerrado la ventana
+#endif
+
+  // Q1 cada update_interval; F e I al arrancar, al reconectar y cada hora
+  PollingSchedule polling_schedules_[3] = {
+      {0, 10, POLLING_POLICY_INTERVAL},
+      {3600000, 5, POLLING_POLICY_ON_RECONNECT},
+      {3600000, 1, POLLING_POLICY_ON_RECONNECT},
+  };
 
   // ------------------- VARIABLES DE LOS SWITCHES -------------------
 
@@ -0,0 +1,46 @@
+#include "powermust_bus.h"
+#include "powermust.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace powermust {
+
+static const char *const TAG = "powermust.bus";
+
+Powermust *PowermustBus::units_[PowermustBus::MAX_UNITS] = {};
+uint8_t PowermustBus::count_ = 0;
+
+void PowermustBus::register_unit(Powermust *unit) {
+  if (index_of(unit) < count_)
+    return;
+  if (count_ >= MAX_UNITS) {
+    ESP_LOGW(TAG, "Too many UPS units, polling phase of unit %u not coordinated", count_ + 1);
+    return;
+  }
+  units_[count_++] = unit;
+}
+
+uint8_t PowermustBus::index_of(const Powermust *unit) {
+  for (uint8_t i = 0; i < count_; i++) {
+    if (units_[i] == unit)
+      return i;
+  }
+  return count_;
+}
+
+uint32_t PowermustBus::phase_offset(const Powermust *unit, uint32_t interval) {
+  uint8_t index = index_of(unit);
+  if (count_ < 2 || index >= count_)
+    return 0;
+  return (uint32_t) ((uint64_t) interval * index / count_);
+}
+
+float PowermustBus::total_sample_rate() {
+  float total = 0.0f;
+  for (uint8_t i = 0; i < count_; i++)
+    total += units_[i]->get_sample_rate();
+  return total;
+}
+
+}  // namespace powermust
+}  // namespace esphome
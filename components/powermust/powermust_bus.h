@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome {
+namespace powermust {
+
+class Powermust;
+
+// Registro de todos los SAI de un mismo nodo (MULTI_CONF).
+//
+// Cada instancia tiene su propia UART y su máquina de estados no bloqueante, así que el
+// timeout de un SAI lento o muerto nunca retrasa el Q1 de otro. El registro reparte la
+// fase de polling de las instancias a lo largo del intervalo, para que las ráfagas de
+// decodificación y publicación no coincidan en la misma pasada del loop principal, y
+// agrega la tasa de muestras de todas ellas.
+class PowermustBus {
+ public:
+  static const uint8_t MAX_UNITS = 8;
+
+  static void register_unit(Powermust *unit);
+  static uint8_t size() { return count_; }
+  static uint8_t index_of(const Powermust *unit);
+  // Desfase del primer polling de la unidad dentro de su intervalo
+  static uint32_t phase_offset(const Powermust *unit, uint32_t interval);
+  // Muestras Q1 por minuto de todas las unidades
+  static float total_sample_rate();
+#ifdef USE_HOST
+  // Las pruebas del host crean y destruyen unidades en el mismo proceso
+  static void reset() { count_ = 0; }
+#endif
+
+ protected:
+  static Powermust *units_[MAX_UNITS];
+  static uint8_t count_;
+};
+
+}  // namespace powermust
+}  // namespace esphome
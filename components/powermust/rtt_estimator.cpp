@@ -0,0 +1,44 @@
+#include "rtt_estimator.h"
+
+namespace esphome {
+namespace powermust {
+
+// Aritmética entera de Jacobson: SRTT en octavos y RTTVAR en cuartos de ms
+void RttEstimator::add(uint32_t rtt) {
+  if (rtt > MAX_TIMEOUT)
+    rtt = MAX_TIMEOUT;
+  if (this->samples_ == 0) {
+    this->srtt_ = rtt << 3;
+    this->rttvar_ = rtt << 1;
+  } else {
+    int32_t error = (int32_t) rtt - (int32_t) (this->srtt_ >> 3);
+    this->srtt_ += error;  // SRTT += error / 8
+    if (error < 0)
+      error = -error;
+    this->rttvar_ += error - (int32_t) (this->rttvar_ >> 2);  // RTTVAR += (|error| - RTTVAR) / 4
+  }
+  this->samples_++;
+  this->backoff_ = 0;
+
+  // rttvar_ ya está en cuartos: su valor en ms es 4·RTTVAR
+  uint32_t variation = this->rttvar_ > GRANULARITY ? this->rttvar_ : GRANULARITY;
+  uint32_t timeout = (this->srtt_ >> 3) + variation;
+  if (timeout < MIN_TIMEOUT)
+    timeout = MIN_TIMEOUT;
+  if (timeout > MAX_TIMEOUT)
+    timeout = MAX_TIMEOUT;
+  this->base_timeout_ = timeout;
+}
+
+void RttEstimator::backoff() {
+  if (this->timeout() < MAX_TIMEOUT)
+    this->backoff_++;
+}
+
+uint32_t RttEstimator::timeout() const {
+  uint32_t timeout = (uint32_t) this->base_timeout_ << this->backoff_;
+  return timeout < MAX_TIMEOUT ? timeout : MAX_TIMEOUT;
+}
+
+}  // namespace powermust
+}  // namespace esphome
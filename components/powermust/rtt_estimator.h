@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome {
+namespace powermust {
+
+// Timeout de respuesta a partir del tiempo de ida y vuelta medido, como el RTO de TCP
+// (RFC 6298): SRTT y RTTVAR suavizados, RTO = SRTT + max(G, 4·RTTVAR).
+//
+// backoff() duplica el RTO hasta el máximo y la siguiente medida lo recalcula. Solo se
+// deben medir respuestas a un primer envío (algoritmo de Karn): tras un reenvío no se
+// sabe a qué envío responde.
+class RttEstimator {
+ public:
+  static const uint16_t MIN_TIMEOUT = 250;   // ms; Q1 a 2400 baudios ya tarda ~200 ms
+  static const uint16_t MAX_TIMEOUT = 3000;  // ms
+  static const uint16_t GRANULARITY = 50;    // ms; resolución de loop() y de la UART
+
+  explicit RttEstimator(uint16_t initial_timeout = 1000) : base_timeout_(initial_timeout) {}
+
+  void add(uint32_t rtt);
+  void backoff();
+  void reset_backoff() { this->backoff_ = 0; }
+  uint32_t timeout() const;
+  uint32_t smoothed() const { return this->srtt_ >> 3; }
+  uint32_t variation() const { return this->rttvar_ >> 2; }
+  uint32_t samples() const { return this->samples_; }
+
+ protected:
+  uint32_t srtt_{0};    // ms × 8
+  uint32_t rttvar_{0};  // ms × 4
+  uint32_t samples_{0};
+  uint16_t base_timeout_;
+  uint8_t backoff_{0};  // Duplicaciones desde la última medida
+};
+
+}  // namespace powermust
+}  // namespace esphome
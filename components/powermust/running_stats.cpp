@@ -0,0 +1,25 @@
+#include "running_stats.h"
+
+namespace esphome {
+namespace powermust {
+
+void RunningStats::add(float value) {
+  if (std::isnan(value))
+    return;
+  if (this->count_ == 0) {
+    this->min_ = value;
+    this->max_ = value;
+  } else {
+    if (value < this->min_)
+      this->min_ = value;
+    if (value > this->max_)
+      this->max_ = value;
+  }
+  this->count_++;
+  float delta = value - this->mean_;
+  this->mean_ += delta / this->count_;
+  this->m2_ += delta * (value - this->mean_);
+}
+
+}  // namespace powermust
+}  // namespace esphome
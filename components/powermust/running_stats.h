@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace esphome {
+namespace powermust {
+
+// Mínimo, máximo, media y varianza de una serie en una sola pasada (Welford), O(1) en
+// memoria y numéricamente estable en float. Los valores NAN (campo desconocido) no cuentan.
+class RunningStats {
+ public:
+  void add(float value);
+  void reset() { *this = RunningStats(); }
+
+  uint32_t count() const { return this->count_; }
+  float min() const { return this->count_ > 0 ? this->min_ : NAN; }
+  float max() const { return this->count_ > 0 ? this->max_ : NAN; }
+  float mean() const { return this->count_ > 0 ? this->mean_ : NAN; }
+  // Varianza muestral (n - 1); NAN con menos de dos valores
+  float variance() const { return this->count_ > 1 ? this->m2_ / (this->count_ - 1) : NAN; }
+  float stddev() const { return std::sqrt(this->variance()); }
+
+ protected:
+  uint32_t count_{0};
+  float min_{0.0f};
+  float max_{0.0f};
+  float mean_{0.0f};
+  float m2_{0.0f};  // Suma de cuadrados de las desviaciones a la media
+};
+
+}  // namespace powermust
+}  // namespace esphome
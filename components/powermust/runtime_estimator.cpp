@@ -0,0 +1,113 @@
+#include "runtime_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace esphome {
+namespace powermust {
+
+// Tensión por celda en reposo frente a estado de carga (plomo-ácido)
+static const float SOC_CURVE[][2] = {
+    {1.75f, 0.0f}, {1.85f, 10.0f}, {1.93f, 25.0f}, {1.98f, 40.0f}, {2.03f, 60.0f}, {2.08f, 80.0f}, {2.12f, 100.0f},
+};
+static const uint8_t SOC_CURVE_POINTS = sizeof(SOC_CURVE) / sizeof(SOC_CURVE[0]);
+// Caída de tensión por celda a plena carga
+static const float CELL_SAG_FULL_LOAD = 0.15f;
+static const float PEUKERT_EXPONENT = 1.2f;
+// Por debajo de esta carga la autonomía deja de tener sentido
+static const float MIN_LOAD = 0.05f;
+// Peso de la tensión frente al descuento por consumo en cada muestra en batería
+static const float VOLTAGE_WEIGHT = 0.1f;
+// Una descarga solo enseña algo si es lo bastante larga y profunda
+static const uint32_t MIN_LEARN_DURATION = 60000;
+static const float MIN_LEARN_SOC_DROP = 10.0f;
+static const float MIN_FULL_LOAD_RUNTIME = 30.0f;
+static const float MAX_FULL_LOAD_RUNTIME = 36000.0f;
+
+float RuntimeEstimator::voltage_state_of_charge_(float battery_voltage, float load) const {
+  // Algunos SAI dan la tensión por celda y otros la del banco completo
+  float cells;
+  if (!std::isnan(this->battery_rating_voltage_) && this->battery_rating_voltage_ > 0.0f) {
+    cells = battery_voltage < this->battery_rating_voltage_ / 3.0f ? 1.0f
+                                                                    : std::round(this->battery_rating_voltage_ / 2.0f);
+  } else {
+    cells = battery_voltage < 3.0f ? 1.0f : 6.0f * std::max(1.0f, std::round(battery_voltage / 13.0f));
+  }
+  float cell_voltage = battery_voltage / cells + CELL_SAG_FULL_LOAD * load;
+
+  if (cell_voltage <= SOC_CURVE[0][0])
+    return SOC_CURVE[0][1];
+  for (uint8_t i = 1; i < SOC_CURVE_POINTS; i++) {
+    if (cell_voltage < SOC_CURVE[i][0]) {
+      float fraction = (cell_voltage - SOC_CURVE[i - 1][0]) / (SOC_CURVE[i][0] - SOC_CURVE[i - 1][0]);
+      return SOC_CURVE[i - 1][1] + fraction * (SOC_CURVE[i][1] - SOC_CURVE[i - 1][1]);
+    }
+  }
+  return SOC_CURVE[SOC_CURVE_POINTS - 1][1];
+}
+
+// Segundos a plena carga equivalentes a un segundo con esta carga
+float RuntimeEstimator::full_load_equivalent_(float load) {
+  return std::pow(std::max(load, MIN_LOAD), PEUKERT_EXPONENT);
+}
+
+bool RuntimeEstimator::update(float battery_voltage, int load_percent, bool on_battery, uint32_t now) {
+  if (std::isnan(battery_voltage) || load_percent < 0)
+    return false;
+
+  float load = load_percent / 100.0f;
+  float voltage_soc = this->voltage_state_of_charge_(battery_voltage, load);
+  float elapsed = std::isnan(this->state_of_charge_) ? 0.0f : (now - this->last_millis_) / 1000.0f;
+  this->last_millis_ = now;
+
+  bool learned = false;
+  if (on_battery) {
+    if (!this->discharging_) {
+      this->discharging_ = true;
+      this->discharge_start_millis_ = now;
+      this->discharge_start_soc_ = voltage_soc;
+      this->discharge_full_load_seconds_ = 0.0f;
+      elapsed = 0.0f;
+    }
+    float consumed = elapsed * full_load_equivalent_(load);
+    this->discharge_full_load_seconds_ += consumed;
+    this->discharge_last_soc_ = voltage_soc;
+    this->discharge_last_millis_ = now;
+
+    float counted = std::isnan(this->state_of_charge_)
+                        ? voltage_soc
+                        : this->state_of_charge_ - 100.0f * consumed / this->model_.full_load_runtime;
+    this->state_of_charge_ = (1.0f - VOLTAGE_WEIGHT) * counted + VOLTAGE_WEIGHT * voltage_soc;
+  } else {
+    if (this->discharging_) {
+      this->discharging_ = false;
+      learned = this->learn_();
+    }
+    // En red la tensión de flotación manda; se suaviza para no saltar con cada muestra
+    this->state_of_charge_ = std::isnan(this->state_of_charge_)
+                                 ? voltage_soc
+                                 : (1.0f - VOLTAGE_WEIGHT) * this->state_of_charge_ + VOLTAGE_WEIGHT * voltage_soc;
+  }
+  this->state_of_charge_ = std::max(0.0f, std::min(100.0f, this->state_of_charge_));
+
+  this->runtime_ = this->state_of_charge_ / 100.0f * this->model_.full_load_runtime / full_load_equivalent_(load);
+  return learned;
+}
+
+bool RuntimeEstimator::learn_() {
+  float soc_drop = this->discharge_start_soc_ - this->discharge_last_soc_;
+  uint32_t duration = this->discharge_last_millis_ - this->discharge_start_millis_;
+  if (duration < MIN_LEARN_DURATION || soc_drop < MIN_LEARN_SOC_DROP)
+    return false;
+
+  float observed = this->discharge_full_load_seconds_ / (soc_drop / 100.0f);
+  observed = std::max(MIN_FULL_LOAD_RUNTIME, std::min(MAX_FULL_LOAD_RUNTIME, observed));
+  // Media de las primeras descargas; después pesan más las recientes (la batería envejece)
+  float weight = std::max(0.2f, 1.0f / (this->model_.discharges + 1));
+  this->model_.full_load_runtime += weight * (observed - this->model_.full_load_runtime);
+  this->model_.discharges++;
+  return true;
+}
+
+}  // namespace powermust
+}  // namespace esphome
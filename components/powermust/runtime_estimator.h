@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace esphome {
+namespace powermust {
+
+// Coeficientes aprendidos, guardados en preferencias
+struct RuntimeModel {
+  float full_load_runtime;  // s a plena carga con la batería llena
+  uint32_t discharges;      // Descargas observadas
+};
+
+// Estimación de estado de carga y autonomía, O(1) por muestra Q1.
+//
+// El estado de carga sale de la tensión por celda (corregida por la caída bajo carga)
+// sobre la curva de una batería de plomo. En batería se descuenta además la energía
+// consumida según la carga (Peukert) y ambas estimaciones se combinan. La autonomía a
+// plena carga se aprende de las descargas observadas: segundos equivalentes a plena
+// carga consumidos divididos por el estado de carga perdido.
+class RuntimeEstimator {
+ public:
+  static constexpr float DEFAULT_FULL_LOAD_RUNTIME = 300.0f;
+
+  void set_model(const RuntimeModel &model) { this->model_ = model; }
+  const RuntimeModel &get_model() const { return this->model_; }
+  void set_battery_rating_voltage(float battery_rating_voltage) {
+    this->battery_rating_voltage_ = battery_rating_voltage;
+  }
+
+  // Devuelve true si al terminar una descarga se ha actualizado el modelo
+  bool update(float battery_voltage, int load_percent, bool on_battery, uint32_t now);
+
+  float get_state_of_charge() const { return this->state_of_charge_; }  // %
+  float get_runtime() const { return this->runtime_; }                  // s
+
+ protected:
+  float voltage_state_of_charge_(float battery_voltage, float load) const;
+  static float full_load_equivalent_(float load);
+  bool learn_();
+
+  RuntimeModel model_{DEFAULT_FULL_LOAD_RUNTIME, 0};
+  float battery_rating_voltage_{NAN};
+  float state_of_charge_{NAN};
+  float runtime_{NAN};
+  uint32_t last_millis_{0};
+
+  // Descarga en curso
+  bool discharging_{false};
+  uint32_t discharge_start_millis_{0};
+  uint32_t discharge_last_millis_{0};
+  float discharge_start_soc_{NAN};
+  float discharge_last_soc_{NAN};
+  float discharge_full_load_seconds_{0.0f};
+};
+
+}  // namespace powermust
+}  // namespace esphome
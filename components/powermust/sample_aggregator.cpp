@@ -0,0 +1,36 @@
+#include "sample_aggregator.h"
+
+namespace esphome {
+namespace powermust {
+
+bool SampleAggregator::add(const Q1Sample &sample, uint32_t now) {
+  bool status_changed = this->window_started_ && sample.status != this->status_;
+  if (!this->window_started_) {
+    this->window_start_ = now;
+    this->window_started_ = true;
+  }
+  this->status_ = sample.status;
+
+  this->current_[AGGREGATE_GRID_VOLTAGE].add(sample.grid_voltage);
+  this->current_[AGGREGATE_AC_OUTPUT_VOLTAGE].add(sample.ac_output_voltage);
+  this->current_[AGGREGATE_AC_OUTPUT_LOAD_PERCENT].add(sample.ac_output_load_percent);
+  this->current_[AGGREGATE_BATTERY_VOLTAGE].add(sample.battery_voltage);
+  this->current_[AGGREGATE_GRID_FREQUENCY].add(sample.grid_frequency);
+  this->current_[AGGREGATE_TEMPERATURE].add(sample.temperature);
+
+  if (!status_changed && now - this->window_start_ < this->window_)
+    return false;
+  if (status_changed)
+    this->status_flushes_++;
+  for (uint8_t metric = 0; metric < AGGREGATE_METRIC_COUNT; metric++) {
+    this->completed_[metric] = this->current_[metric];
+    this->current_[metric].reset();
+  }
+  this->completed_length_ = now - this->window_start_;
+  this->window_start_ = now;
+  this->windows_++;
+  return true;
+}
+
+}  // namespace powermust
+}  // namespace esphome
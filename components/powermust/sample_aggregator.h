@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#include "megatec_decoder.h"
+#include "running_stats.h"
+
+namespace esphome {
+namespace powermust {
+
+enum AggregateMetric : uint8_t {
+  AGGREGATE_GRID_VOLTAGE = 0,
+  AGGREGATE_AC_OUTPUT_VOLTAGE = 1,
+  AGGREGATE_AC_OUTPUT_LOAD_PERCENT = 2,
+  AGGREGATE_BATTERY_VOLTAGE = 3,
+  AGGREGATE_GRID_FREQUENCY = 4,
+  AGGREGATE_TEMPERATURE = 5,
+  AGGREGATE_METRIC_COUNT = 6,
+};
+
+// Agregación por ventanas de los valores analógicos del Q1 (USE_POWERMUST_AGGREGATION).
+//
+// Desacopla la frecuencia de publicación de la de polling: cada muestra se acumula en
+// mínimo, máximo y media O(1) y solo se publica al cerrar la ventana. La ventana se cierra
+// con la primera muestra que llega después de window ms o, antes, con la primera cuyos
+// bits de estado cambian, para que un corte o un test no esperen al final de la ventana.
+// La muestra que cierra la ventana cuenta en ella.
+//
+// El define compila la agregación para todas las unidades; la activa, por unidad, una
+// ventana mayor que 0.
+class SampleAggregator {
+ public:
+  void set_window(uint32_t window) { this->window_ = window; }
+  uint32_t get_window() const { return this->window_; }
+  bool enabled() const { return this->window_ > 0; }
+
+  // true si la muestra ha cerrado la ventana; window_stats() tiene entonces sus agregados
+  bool add(const Q1Sample &sample, uint32_t now);
+
+  uint32_t windows() const { return this->windows_; }
+  const RunningStats &window_stats(AggregateMetric metric) const { return this->completed_[metric]; }
+  uint32_t window_length() const { return this->completed_length_; }
+  // Ventanas cerradas antes de tiempo por un cambio en los bits de estado
+  uint32_t status_flushes() const { return this->status_flushes_; }
+
+ protected:
+  uint32_t window_{0};  // 0 = sin agregación
+
+  RunningStats current_[AGGREGATE_METRIC_COUNT];
+  RunningStats completed_[AGGREGATE_METRIC_COUNT];
+  uint32_t window_start_{0};
+  uint32_t completed_length_{0};
+  uint32_t windows_{0};
+  uint32_t status_flushes_{0};
+  uint8_t status_{0};
+  bool window_started_{false};
+};
+
+}  // namespace powermust
+}  // namespace esphome
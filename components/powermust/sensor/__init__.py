@@ -4,21 +4,39 @@ import esphome.config_validation as cv
 from esphome.const import (
     CONF_BATTERY_VOLTAGE,
     CONF_TEMPERATURE,
+    DEVICE_CLASS_BATTERY,
     DEVICE_CLASS_CURRENT,
+    DEVICE_CLASS_DURATION,
     DEVICE_CLASS_TEMPERATURE,
     DEVICE_CLASS_VOLTAGE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     ICON_CURRENT_AC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
     UNIT_AMPERE,
     UNIT_CELSIUS,
     UNIT_HERTZ,
+    UNIT_MILLISECOND,
     UNIT_PERCENT,
+    UNIT_SECOND,
     UNIT_VOLT,
 )
 
-from .. import CONF_POWERMUST_ID, POWERMUST_COMPONENT_SCHEMA
+from .. import CONF_AGGREGATION, CONF_POWERMUST_ID, CONF_SEQUENCES, POWERMUST_COMPONENT_SCHEMA, powermust_config
 
 DEPENDENCIES = ["uart"]
 
+# Publicación solo si el valor cambia
+CONF_DEADBAND = "deadband"
+CONF_DEADBAND_PERCENT = "deadband_percent"
+CONF_MAX_SILENCE = "max_silence"
+
+PUBLISH_FILTER_SCHEMA = cv.Schema({
+    cv.Optional(CONF_DEADBAND): cv.positive_float,
+    cv.Optional(CONF_DEADBAND_PERCENT): cv.percentage,
+    cv.Optional(CONF_MAX_SILENCE): cv.positive_time_period_milliseconds,
+})
+
 # Q1 sensors
 CONF_GRID_VOLTAGE = "grid_voltage"
 CONF_GRID_FAULT_VOLTAGE = "grid_fault_voltage"
@@ -34,6 +52,28 @@ CONF_AC_OUTPUT_RATING_CURRENT = "ac_output_rating_current"
 CONF_BATTERY_RATING_VOLTAGE = "battery_rating_voltage"
 CONF_AC_OUTPUT_RATING_FREQUENCY = "ac_output_rating_frequency"
 
+# Estimación de autonomía
+CONF_ESTIMATED_RUNTIME = "estimated_runtime"
+CONF_STATE_OF_CHARGE = "state_of_charge"
+
+# Diagnóstico
+CONF_COMMAND_QUEUE_DEPTH = "command_queue_depth"
+CONF_COMMAND_QUEUE_DROPPED = "command_queue_dropped"
+CONF_SAMPLE_RATE = "sample_rate"
+# Paso en el que ha fallado la última secuencia, 0 si ha terminado bien
+CONF_SEQUENCE_RESULT = "sequence_result"
+
+# Instrumentación: activan USE_POWERMUST_INSTRUMENTATION
+CONF_POLL_LATENCY = "poll_latency"
+CONF_COMMAND_LATENCY = "command_latency"
+CONF_POLL_TO_PUBLISH_LATENCY = "poll_to_publish_latency"
+CONF_TIMEOUT_COUNT = "timeout_count"
+CONF_NAK_COUNT = "nak_count"
+CONF_PARSE_FAILURE_COUNT = "parse_failure_count"
+CONF_RX_OVERFLOW_COUNT = "rx_overflow_count"
+CONF_LOOP_TIME_AVERAGE = "loop_time_average"
+CONF_LOOP_TIME_MAX = "loop_time_max"
+
 TYPES = {
     CONF_GRID_VOLTAGE: sensor.sensor_schema(
         unit_of_measurement=UNIT_VOLT,
@@ -89,13 +129,154 @@ TYPES = {
         icon=ICON_CURRENT_AC,
         accuracy_decimals=1,
     ),
+    CONF_ESTIMATED_RUNTIME: sensor.sensor_schema(
+        unit_of_measurement=UNIT_SECOND,
+        icon="mdi:timer-sand",
+        accuracy_decimals=0,
+        device_class=DEVICE_CLASS_DURATION,
+        state_class=STATE_CLASS_MEASUREMENT,
+    ),
+    CONF_STATE_OF_CHARGE: sensor.sensor_schema(
+        unit_of_measurement=UNIT_PERCENT,
+        accuracy_decimals=0,
+        device_class=DEVICE_CLASS_BATTERY,
+        state_class=STATE_CLASS_MEASUREMENT,
+    ),
+}
+
+# Mínimo, máximo y media por ventana de agregación: <tipo>_min, <tipo>_max, <tipo>_avg
+AGGREGATE_SCHEMAS = {
+    CONF_GRID_VOLTAGE: {"unit_of_measurement": UNIT_VOLT, "device_class": DEVICE_CLASS_VOLTAGE},
+    CONF_AC_OUTPUT_VOLTAGE: {"unit_of_measurement": UNIT_VOLT, "device_class": DEVICE_CLASS_VOLTAGE},
+    CONF_AC_OUTPUT_LOAD_PERCENT: {"unit_of_measurement": UNIT_PERCENT},
+    CONF_BATTERY_VOLTAGE: {"unit_of_measurement": UNIT_VOLT, "device_class": DEVICE_CLASS_VOLTAGE},
+    CONF_GRID_FREQUENCY: {"unit_of_measurement": UNIT_HERTZ, "icon": ICON_CURRENT_AC},
+    CONF_TEMPERATURE: {"unit_of_measurement": UNIT_CELSIUS, "device_class": DEVICE_CLASS_TEMPERATURE},
+}
+
+AGGREGATE_TYPES = {
+    f"{type}_{suffix}": sensor.sensor_schema(accuracy_decimals=1, state_class=STATE_CLASS_MEASUREMENT, **schema)
+    for type, schema in AGGREGATE_SCHEMAS.items()
+    for suffix in ("min", "max", "avg")
+}
+
+DIAGNOSTIC_TYPES = {
+    CONF_COMMAND_QUEUE_DEPTH: sensor.sensor_schema(
+        icon="mdi:tray-full",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_COMMAND_QUEUE_DROPPED: sensor.sensor_schema(
+        icon="mdi:tray-remove",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_SAMPLE_RATE: sensor.sensor_schema(
+        unit_of_measurement="samples/min",
+        icon="mdi:speedometer",
+        accuracy_decimals=1,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_SEQUENCE_RESULT: sensor.sensor_schema(
+        icon="mdi:playlist-check",
+        accuracy_decimals=0,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+}
+
+# Percentil 95 de las latencias y contadores desde el arranque; tiempo de loop() por minuto
+INSTRUMENTATION_TYPES = {
+    CONF_POLL_LATENCY: sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        icon="mdi:timer-outline",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_COMMAND_LATENCY: sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        icon="mdi:timer-outline",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_POLL_TO_PUBLISH_LATENCY: sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        icon="mdi:timer-outline",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_TIMEOUT_COUNT: sensor.sensor_schema(
+        icon="mdi:timer-alert-outline",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_NAK_COUNT: sensor.sensor_schema(
+        icon="mdi:close-circle-outline",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_PARSE_FAILURE_COUNT: sensor.sensor_schema(
+        icon="mdi:alert-circle-outline",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_RX_OVERFLOW_COUNT: sensor.sensor_schema(
+        icon="mdi:tray-alert",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_LOOP_TIME_AVERAGE: sensor.sensor_schema(
+        unit_of_measurement="µs",
+        icon="mdi:timer-cog-outline",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
+    CONF_LOOP_TIME_MAX: sensor.sensor_schema(
+        unit_of_measurement="µs",
+        icon="mdi:timer-cog-outline",
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ),
 }
 
 CONFIG_SCHEMA = POWERMUST_COMPONENT_SCHEMA.extend(
-    {cv.Optional(type): schema for type, schema in TYPES.items()}
+    {cv.Optional(type): schema.extend(PUBLISH_FILTER_SCHEMA) for type, schema in TYPES.items()}
+).extend(
+    {cv.Optional(type): schema for type, schema in AGGREGATE_TYPES.items()}
+).extend(
+    {cv.Optional(type): schema for type, schema in DIAGNOSTIC_TYPES.items()}
+).extend(
+    {cv.Optional(type): schema for type, schema in INSTRUMENTATION_TYPES.items()}
 )
 
 
+def validate_sequences(config):
+    if CONF_SEQUENCE_RESULT in config and CONF_SEQUENCES not in powermust_config(config[CONF_POWERMUST_ID]):
+        raise cv.Invalid(f"'{CONF_SEQUENCE_RESULT}' requires '{CONF_SEQUENCES}' in the powermust configuration")
+    return config
+
+
+def validate_aggregation(config):
+    aggregates = [type for type in AGGREGATE_TYPES if type in config]
+    if aggregates and CONF_AGGREGATION not in powermust_config(config[CONF_POWERMUST_ID]):
+        raise cv.Invalid(f"'{aggregates[0]}' requires '{CONF_AGGREGATION}' in the powermust configuration")
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = cv.All(validate_sequences, validate_aggregation)
+
+
 async def to_code(config):
     paren = await cg.get_variable(config[CONF_POWERMUST_ID])
 
@@ -104,3 +285,25 @@ async def to_code(config):
             conf = config[type]
             sens = await sensor.new_sensor(conf)
             cg.add(getattr(paren, f"set_{type}")(sens))
+
+            if any(key in conf for key in (CONF_DEADBAND, CONF_DEADBAND_PERCENT, CONF_MAX_SILENCE)):
+                max_silence = conf[CONF_MAX_SILENCE].total_milliseconds if CONF_MAX_SILENCE in conf else 0
+                cg.add(getattr(paren, f"set_{type}_publish_filter")(
+                    conf.get(CONF_DEADBAND, 0.0), conf.get(CONF_DEADBAND_PERCENT, 0.0), max_silence
+                ))
+
+    for type, _ in AGGREGATE_TYPES.items():
+        if type in config:
+            sens = await sensor.new_sensor(config[type])
+            cg.add(getattr(paren, f"set_{type}")(sens))
+
+    for type, _ in DIAGNOSTIC_TYPES.items():
+        if type in config:
+            sens = await sensor.new_sensor(config[type])
+            cg.add(getattr(paren, f"set_{type}")(sens))
+
+    for type, _ in INSTRUMENTATION_TYPES.items():
+        if type in config:
+            cg.add_define("USE_POWERMUST_INSTRUMENTATION")
+            sens = await sensor.new_sensor(config[type])
+            cg.add(getattr(paren, f"set_{type}")(sens))
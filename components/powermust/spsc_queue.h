@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace esphome {
+namespace powermust {
+
+// Cola sin bloqueos de un solo productor y un solo consumidor, con almacenamiento fijo.
+//
+// head_ solo lo escribe el productor y tail_ solo el consumidor. La escritura con
+// release del índice propio publica el hueco y la lectura con acquire del ajeno garantiza
+// ver su contenido, así que no hace falta ningún mutex ni sección crítica entre la tarea
+// de transporte y el loop principal, aunque corran en núcleos distintos.
+template<typename T, size_t N> class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N debe ser potencia de dos");
+
+ public:
+  // Productor
+  bool push(const T &item) {
+    size_t head = this->head_.load(std::memory_order_relaxed);
+    if (head - this->tail_.load(std::memory_order_acquire) == N)
+      return false;
+    this->items_[head & (N - 1)] = item;
+    this->head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumidor
+  bool pop(T &item) {
+    size_t tail = this->tail_.load(std::memory_order_relaxed);
+    if (this->head_.load(std::memory_order_acquire) == tail)
+      return false;
+    item = this->items_[tail & (N - 1)];
+    this->tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Exacto desde el productor o el consumidor; desde el otro lado puede estar desfasado
+  size_t size() const {
+    return this->head_.load(std::memory_order_acquire) - this->tail_.load(std::memory_order_acquire);
+  }
+
+ protected:
+  T items_[N];
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+};
+
+}  // namespace powermust
+}  // namespace esphome
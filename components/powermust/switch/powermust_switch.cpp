@@ -10,11 +10,11 @@ static const char *const TAG = "powermust.switch";
 void PowermustSwitch::dump_config() { LOG_SWITCH("", "Powermust Switch", this); }
 void PowermustSwitch::write_state(bool state) {
   if (state) {
-    if (!this->on_command_.empty()) {
+    if (this->on_command_ != nullptr) {
       this->parent_->switch_command(this->on_command_);
     }
   } else {
-    if (!this->off_command_.empty()) {
+    if (this->off_command_ != nullptr) {
       this->parent_->switch_command(this->off_command_);
     }
   }
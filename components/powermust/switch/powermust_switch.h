@@ -10,14 +10,15 @@ class Powermust;
 class PowermustSwitch : public switch_::Switch, public Component {
  public:
   void set_parent(Powermust *parent) { this->parent_ = parent; };
-  void set_on_command(const std::string &command) { this->on_command_ = command; };
-  void set_off_command(const std::string &command) { this->off_command_ = command; };
+  void set_on_command(const char *command) { this->on_command_ = command; };
+  void set_off_command(const char *command) { this->off_command_ = command; };
   void dump_config() override;
 
  protected:
   void write_state(bool state) override;
-  std::string on_command_;
-  std::string off_command_;
+  // Literales generados en el código, sin copia en el heap
+  const char *on_command_{nullptr};
+  const char *off_command_{nullptr};
   Powermust *parent_;
 };
 
@@ -0,0 +1,172 @@
+#include "telemetry_history.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace esphome {
+namespace powermust {
+
+static const uint32_t MINUTE = 60000;
+static const uint32_t TEN_MINUTES = 600000;
+
+static void put_bits(uint8_t *data, uint8_t offset, uint8_t width, uint32_t value) {
+  for (uint8_t i = 0; i < width; i++, offset++) {
+    if (value & (1UL << i)) {
+      data[offset / 8] |= 1 << (offset % 8);
+    } else {
+      data[offset / 8] &= ~(1 << (offset % 8));
+    }
+  }
+}
+
+static uint32_t get_bits(const uint8_t *data, uint8_t offset, uint8_t width) {
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < width; i++, offset++) {
+    if (data[offset / 8] & (1 << (offset % 8)))
+      value |= 1UL << i;
+  }
+  return value;
+}
+
+// Valor en pasos de "scale" saturado al campo; el máximo queda reservado para NAN
+static uint32_t encode(float value, float scale, uint8_t width) {
+  uint32_t unknown = (1UL << width) - 1;
+  if (std::isnan(value))
+    return unknown;
+  float steps = std::round(value / scale);
+  if (steps <= 0.0f)
+    return 0;
+  return std::min((uint32_t) steps, unknown - 1);
+}
+
+static float decode(uint32_t raw, float scale, uint8_t width) {
+  if (raw == (1UL << width) - 1)
+    return NAN;
+  return raw * scale;
+}
+
+void TelemetryRecord::pack(const Q1Sample &sample, uint16_t dt) {
+  put_bits(this->data, 0, 12, encode(sample.grid_voltage, 0.1f, 12));
+  put_bits(this->data, 12, 12, encode(sample.grid_fault_voltage, 0.1f, 12));
+  put_bits(this->data, 24, 12, encode(sample.ac_output_voltage, 0.1f, 12));
+  put_bits(this->data, 36, 7, sample.ac_output_load_percent < 0 ? 127 : std::min(sample.ac_output_load_percent, 126));
+  put_bits(this->data, 43, 10, encode(sample.grid_frequency, 0.1f, 10));
+  put_bits(this->data, 53, 11, encode(sample.battery_voltage, 0.05f, 11));
+  int8_t temperature = -128;
+  if (!std::isnan(sample.temperature))
+    temperature = (int8_t) std::max(-127.0f, std::min(127.0f, std::round(sample.temperature)));
+  put_bits(this->data, 64, 8, (uint8_t) temperature);
+  put_bits(this->data, 72, 8, sample.status);
+  put_bits(this->data, 80, 16, dt);
+}
+
+void TelemetryRecord::unpack(Q1Sample *sample, uint16_t *dt) const {
+  sample->grid_voltage = decode(get_bits(this->data, 0, 12), 0.1f, 12);
+  sample->grid_fault_voltage = decode(get_bits(this->data, 12, 12), 0.1f, 12);
+  sample->ac_output_voltage = decode(get_bits(this->data, 24, 12), 0.1f, 12);
+  uint32_t load = get_bits(this->data, 36, 7);
+  sample->ac_output_load_percent = load == 127 ? -1 : (int) load;
+  sample->grid_frequency = decode(get_bits(this->data, 43, 10), 0.1f, 10);
+  sample->battery_voltage = decode(get_bits(this->data, 53, 11), 0.05f, 11);
+  int8_t temperature = (int8_t) get_bits(this->data, 64, 8);
+  sample->temperature = temperature == -128 ? NAN : temperature;
+  sample->status = get_bits(this->data, 72, 8);
+  *dt = get_bits(this->data, 80, 16);
+}
+
+void TelemetryHistory::Ring::push(const Q1Sample &sample, uint32_t now) {
+  uint32_t dt = this->written == 0 ? 0 : (now - this->last_millis) / 1000;
+  this->records[this->written % this->capacity].pack(sample, std::min(dt, (uint32_t) UINT16_MAX));
+  this->written++;
+  this->last_millis = now;
+}
+
+void TelemetryHistory::Accumulator::add(const Q1Sample &sample, uint32_t now) {
+  if (!this->active) {
+    *this = {};
+    this->active = true;
+    this->start_millis = now;
+  }
+  const float values[7] = {sample.grid_voltage,   sample.grid_fault_voltage,
+                           sample.ac_output_voltage, (float) sample.ac_output_load_percent,
+                           sample.grid_frequency, sample.battery_voltage,
+                           sample.temperature};
+  for (uint8_t i = 0; i < 7; i++) {
+    if (std::isnan(values[i]) || (i == 3 && values[i] < 0))
+      continue;
+    this->sums[i] += values[i];
+    this->counts[i]++;
+  }
+  // Un evento dentro del periodo queda visible en la media
+  this->status |= sample.status;
+}
+
+Q1Sample TelemetryHistory::Accumulator::average() const {
+  float averages[7];
+  for (uint8_t i = 0; i < 7; i++)
+    averages[i] = this->counts[i] > 0 ? this->sums[i] / this->counts[i] : NAN;
+  Q1Sample sample{};
+  sample.grid_voltage = averages[0];
+  sample.grid_fault_voltage = averages[1];
+  sample.ac_output_voltage = averages[2];
+  sample.ac_output_load_percent = std::isnan(averages[3]) ? -1 : (int) std::round(averages[3]);
+  sample.grid_frequency = averages[4];
+  sample.battery_voltage = averages[5];
+  sample.temperature = averages[6];
+  sample.status = this->status;
+  return sample;
+}
+
+void TelemetryHistory::flush_(Accumulator &accumulator, Ring &ring, uint32_t period, uint32_t now) {
+  if (!accumulator.active || now - accumulator.start_millis < period)
+    return;
+  ring.push(accumulator.average(), now);
+  accumulator.active = false;
+}
+
+void TelemetryHistory::add(const Q1Sample &sample, uint32_t now) {
+  this->rings_[TELEMETRY_TIER_RAW].push(sample, now);
+  if (!this->downsampling_)
+    return;
+
+  // Se cierra el periodo anterior antes de sumar la muestra al siguiente
+  this->flush_(this->minute_accumulator_, this->rings_[TELEMETRY_TIER_MINUTE], MINUTE, now);
+  this->flush_(this->ten_minutes_accumulator_, this->rings_[TELEMETRY_TIER_TEN_MINUTES], TEN_MINUTES, now);
+  this->minute_accumulator_.add(sample, now);
+  this->ten_minutes_accumulator_.add(sample, now);
+}
+
+size_t TelemetryHistory::size(TelemetryTier tier) const {
+  const Ring &ring = this->rings_[tier];
+  return std::min((size_t) ring.written, ring.capacity);
+}
+
+size_t TelemetryHistory::unexported(TelemetryTier tier) const {
+  const Ring &ring = this->rings_[tier];
+  return std::min((size_t) (ring.written - ring.exported), ring.capacity);
+}
+
+size_t TelemetryHistory::export_records(TelemetryTier tier, TelemetryRecord *out, size_t max, uint32_t now,
+                                        uint32_t *age) {
+  Ring &ring = this->rings_[tier];
+  size_t count = std::min(this->unexported(tier), max);
+  uint32_t first = ring.written - this->unexported(tier);
+  for (size_t i = 0; i < count; i++)
+    out[i] = ring.at(first + i);
+  ring.exported = first + count;
+
+  // Antigüedad del último registro copiado: la del más reciente más los dt posteriores
+  uint32_t newer = 0;
+  for (uint32_t index = ring.exported; index < ring.written; index++) {
+    Q1Sample sample;
+    uint16_t dt;
+    ring.at(index).unpack(&sample, &dt);
+    newer += dt;
+  }
+  *age = now - ring.last_millis + newer * 1000;
+  return count;
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "megatec_decoder.h"
+
+namespace esphome {
+namespace powermust {
+
+// Registro empaquetado de 12 bytes (96 bits, little endian, en este orden):
+//
+//   grid 12 | fault 12 | output 12   (0.1 V)
+//   load 7                           (%)
+//   frequency 10                     (0.1 Hz)
+//   battery 11                       (0.05 V)
+//   temperature 8                    (°C, con signo)
+//   status 8                         (bits del Q1)
+//   dt 16                            (s desde el registro anterior del mismo nivel)
+//
+// El valor máximo de cada campo (-128 en la temperatura) significa "desconocido".
+struct TelemetryRecord {
+  static const size_t SIZE = 12;
+  uint8_t data[SIZE];
+
+  void pack(const Q1Sample &sample, uint16_t dt);
+  void unpack(Q1Sample *sample, uint16_t *dt) const;
+};
+
+enum TelemetryTier : uint8_t {
+  TELEMETRY_TIER_RAW = 0,
+  TELEMETRY_TIER_MINUTE = 1,
+  TELEMETRY_TIER_TEN_MINUTES = 2,
+  TELEMETRY_TIER_COUNT = 3,
+};
+
+// Histórico de muestras Q1 en RAM, en tres niveles de resolución:
+// cada muestra, medias de 1 minuto y medias de 10 minutos. Con los tamaños por defecto
+// son ~2 min de muestras a 1 s, 2 h y 24 h respectivamente en 4.6 KB.
+class TelemetryHistory {
+ public:
+  static const size_t RAW_LENGTH = 128;
+  static const size_t MINUTE_LENGTH = 120;
+  static const size_t TEN_MINUTES_LENGTH = 144;
+
+  void set_downsampling(bool downsampling) { this->downsampling_ = downsampling; }
+  bool get_downsampling() const { return this->downsampling_; }
+
+  void add(const Q1Sample &sample, uint32_t now);
+
+  size_t size(TelemetryTier tier) const;
+  size_t capacity(TelemetryTier tier) const { return this->rings_[tier].capacity; }
+  // Registros guardados desde la última exportación que aún no se han sobrescrito
+  size_t unexported(TelemetryTier tier) const;
+  // Copia hasta max registros no exportados, del más antiguo al más reciente, y los marca
+  // como exportados. age recibe la antigüedad en ms del último registro copiado.
+  size_t export_records(TelemetryTier tier, TelemetryRecord *out, size_t max, uint32_t now, uint32_t *age);
+
+ protected:
+  struct Ring {
+    TelemetryRecord *records;
+    size_t capacity;
+    uint32_t written;   // Registros escritos desde el arranque
+    uint32_t exported;  // Valor de written en la última exportación
+    uint32_t last_millis;
+
+    void push(const Q1Sample &sample, uint32_t now);
+    const TelemetryRecord &at(uint32_t index) const { return this->records[index % this->capacity]; }
+  };
+
+  // Suma de muestras para las medias; los campos desconocidos no cuentan
+  struct Accumulator {
+    float sums[7];
+    uint16_t counts[7];
+    uint8_t status;
+    uint32_t start_millis;
+    bool active;
+
+    void add(const Q1Sample &sample, uint32_t now);
+    Q1Sample average() const;
+  };
+
+  void flush_(Accumulator &accumulator, Ring &ring, uint32_t period, uint32_t now);
+
+  TelemetryRecord raw_[RAW_LENGTH];
+  TelemetryRecord minute_[MINUTE_LENGTH];
+  TelemetryRecord ten_minutes_[TEN_MINUTES_LENGTH];
+  Ring rings_[TELEMETRY_TIER_COUNT] = {
+      {raw_, RAW_LENGTH, 0, 0, 0},
+      {minute_, MINUTE_LENGTH, 0, 0, 0},
+      {ten_minutes_, TEN_MINUTES_LENGTH, 0, 0, 0},
+  };
+  Accumulator minute_accumulator_{};
+  Accumulator ten_minutes_accumulator_{};
+  bool downsampling_{true};
+};
+
+}  // namespace powermust
+}  // namespace esphome
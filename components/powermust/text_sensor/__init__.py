@@ -2,16 +2,29 @@ import esphome.codegen as cg
 from esphome.components import text_sensor
 import esphome.config_validation as cv
 
-from .. import CONF_POWERMUST_ID, POWERMUST_COMPONENT_SCHEMA
+from .. import (
+    CONF_HEAP_FREE,
+    CONF_POWER_QUALITY,
+    CONF_POWERMUST_ID,
+    POWERMUST_COMPONENT_SCHEMA,
+    powermust_config,
+)
 
 DEPENDENCIES = ["uart"]
 
 CONF_LAST_Q1 = "last_q1"
 CONF_LAST_F = "last_f"
+CONF_HISTORY = "history"
+CONF_TELEMETRY = "telemetry"
+CONF_POWER_QUALITY_EVENT = "power_quality_event"
 
 TYPES = [
     CONF_LAST_Q1,
     CONF_LAST_F,
+    CONF_HISTORY,
+    CONF_TELEMETRY,
+    CONF_POWER_QUALITY,
+    CONF_POWER_QUALITY_EVENT,
 ]
 
 CONFIG_SCHEMA = POWERMUST_COMPONENT_SCHEMA.extend(
@@ -19,6 +32,27 @@ CONFIG_SCHEMA = POWERMUST_COMPONENT_SCHEMA.extend(
 )
 
 
+def validate_heap_free(config):
+    # Las tramas en crudo y la telemetría cambian en cada polling y cada publicación crea un std::string
+    if powermust_config(config[CONF_POWERMUST_ID]).get(CONF_HEAP_FREE, False):
+        for type in TYPES:
+            if type in config:
+                raise cv.Invalid(f"'{type}' allocates on every change and is not available with '{CONF_HEAP_FREE}'")
+    return config
+
+
+def validate_power_quality(config):
+    if CONF_POWER_QUALITY in powermust_config(config[CONF_POWERMUST_ID]):
+        return config
+    for type in (CONF_POWER_QUALITY, CONF_POWER_QUALITY_EVENT):
+        if type in config:
+            raise cv.Invalid(f"'{type}' requires '{CONF_POWER_QUALITY}' in the powermust configuration")
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = cv.All(validate_heap_free, validate_power_quality)
+
+
 async def to_code(config):
     paren = await cg.get_variable(config[CONF_POWERMUST_ID])
 
@@ -0,0 +1,137 @@
+#include "uart_transport.h"
+#include <cstring>
+#if defined(USE_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "esphome/core/hal.h"
+#elif defined(USE_HOST)
+#include <chrono>
+#endif
+
+namespace esphome {
+namespace powermust {
+
+#if defined(USE_ESP32)
+// Por encima del loop principal (prioridad 1) para atender la UART aunque compartan núcleo
+static const UBaseType_t TRANSPORT_TASK_PRIORITY = 5;
+static const uint32_t TRANSPORT_TASK_STACK_SIZE = 3072;
+
+static void transport_task(void *arg) {
+  auto *transport = static_cast<UartTransport *>(arg);
+  // Al menos un tick: con vTaskDelay(0) la tarea no cedería nunca el núcleo a la tarea idle
+  TickType_t ticks = pdMS_TO_TICKS(UartTransport::TASK_INTERVAL) > 0 ? pdMS_TO_TICKS(UartTransport::TASK_INTERVAL) : 1;
+  for (;;) {
+    transport->run_once(millis());
+    vTaskDelay(ticks);
+  }
+}
+
+bool UartTransport::start(TransportStream *stream) {
+  this->stream_ = stream;
+  // En el núcleo contrario al del loop principal
+  BaseType_t core = portNUM_PROCESSORS > 1 && xPortGetCoreID() == 0 ? 1 : 0;
+  if (xTaskCreatePinnedToCore(transport_task, "powermust_uart", TRANSPORT_TASK_STACK_SIZE, this,
+                              TRANSPORT_TASK_PRIORITY, nullptr, core) != pdPASS)
+    return false;
+  this->core_ = core;
+  return true;
+}
+#elif defined(USE_HOST)
+static uint32_t steady_millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool UartTransport::start(TransportStream *stream) {
+  this->stream_ = stream;
+  this->running_ = true;
+  this->thread_ = std::thread([this]() {
+    while (this->running_.load(std::memory_order_relaxed)) {
+      this->run_once(steady_millis());
+      std::this_thread::sleep_for(std::chrono::milliseconds(TASK_INTERVAL));
+    }
+  });
+  return true;
+}
+
+void UartTransport::stop() {
+  if (this->running_.exchange(false) && this->thread_.joinable())
+    this->thread_.join();
+}
+#else
+// Sin tareas ni hilos en esta plataforma; la validación solo permite ESP32 y host
+bool UartTransport::start(TransportStream * /*stream*/) { return false; }
+#endif
+
+bool UartTransport::send(const char *command, size_t length, char expect, uint32_t timeout) {
+  TransportRequest request;
+  if (length + 1 > TransportRequest::MAX_LENGTH)
+    return false;
+  memcpy(request.data, command, length);
+  request.data[length] = '\r';
+  request.length = length + 1;
+  request.expect = expect;
+  request.timeout = timeout;
+  return this->requests_.push(request);
+}
+
+void UartTransport::run_once(uint32_t now) {
+  this->read_stream_();
+  while (this->rx_.assemble()) {
+    if (this->busy_ && frame_matches(this->rx_.frame(), this->rx_.frame_length(), this->current_.expect)) {
+      this->push_reply_(TRANSPORT_REPLY_FRAME, now - this->sent_millis_);
+      this->busy_ = false;
+    } else if (!this->busy_ && this->replies_.size() < REPLY_QUEUE_LENGTH - 1) {
+      // El último hueco queda para la respuesta a la siguiente petición
+      this->push_reply_(TRANSPORT_REPLY_UNSOLICITED, 0);
+    } else {
+      this->discarded_frames_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  if (this->busy_ && now - this->sent_millis_ > this->current_.timeout) {
+    this->timeouts_.fetch_add(1, std::memory_order_relaxed);
+    this->push_reply_(TRANSPORT_REPLY_TIMEOUT, now - this->sent_millis_);
+    this->busy_ = false;
+  }
+
+  if (!this->busy_ && this->requests_.pop(this->current_)) {
+    // Como empty_uart_buffer_(): lo recibido hasta ahora es obsoleto
+    this->read_stream_();
+    while (this->rx_.pending() > 0) {
+      this->rx_.clear();
+      this->read_stream_();
+    }
+    this->rx_.clear();
+    this->stream_->write(this->current_.data, this->current_.length);
+    this->sent_millis_ = now;
+    this->busy_ = true;
+    this->requests_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void UartTransport::read_stream_() {
+  size_t available;
+  while ((available = this->stream_->available()) > 0) {
+    size_t capacity = this->rx_.write_capacity();
+    if (capacity == 0)
+      return;
+    size_t length = available < capacity ? available : capacity;
+    if (!this->stream_->read(this->rx_.write_pointer(), length))
+      return;
+    this->rx_.commit_write(length);
+  }
+}
+
+void UartTransport::push_reply_(TransportReplyType type, uint32_t elapsed) {
+  TransportReply reply;
+  reply.type = type;
+  reply.elapsed = elapsed;
+  reply.length = type == TRANSPORT_REPLY_TIMEOUT ? 0 : this->rx_.frame_length();
+  memcpy(reply.frame, this->rx_.frame(), reply.length);
+  // Siempre cabe: una sola petición en curso y las no solicitadas dejan un hueco libre
+  this->replies_.push(reply);
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "frame_assembler.h"
+#include "spsc_queue.h"
+#if defined(USE_HOST)
+#include <thread>
+#endif
+
+namespace esphome {
+namespace powermust {
+
+// Petición del loop principal a la tarea de transporte
+struct TransportRequest {
+  static const uint8_t MAX_LENGTH = 16;  // MAX_COMMAND_LENGTH más el '\r'
+
+  uint8_t data[MAX_LENGTH];  // Con el '\r'
+  uint8_t length;
+  char expect;       // Inicio de la respuesta: '(' Q1, '#' F/I, 0 ACK/NAK (frame_matches)
+  uint32_t timeout;  // ms desde el envío real
+};
+
+enum TransportReplyType : uint8_t {
+  TRANSPORT_REPLY_FRAME = 0,    // Respuesta a la petición en curso
+  TRANSPORT_REPLY_TIMEOUT,      // Sin respuesta dentro del timeout
+  TRANSPORT_REPLY_UNSOLICITED,  // Trama sin petición en curso (respuesta tardía)
+};
+
+struct TransportReply {
+  TransportReplyType type;
+  uint32_t elapsed;  // ms desde el envío hasta la trama o el timeout, medido en la tarea
+  uint8_t length;
+  uint8_t frame[FrameAssembler::FRAME_LENGTH];
+};
+
+// Acceso de la tarea a los bytes de la UART
+class TransportStream {
+ public:
+  virtual ~TransportStream() = default;
+  virtual size_t available() = 0;
+  virtual bool read(uint8_t *data, size_t length) = 0;
+  virtual void write(const uint8_t *data, size_t length) = 0;
+};
+
+// Transporte Megatec en una tarea propia (USE_POWERMUST_TRANSPORT_TASK).
+//
+// La tarea es la única que toca la UART: envía la petición, ensambla las tramas y decide
+// el timeout con su propio reloj, así que un loop principal parado por el Wi-Fi, la API o
+// el logger no adelanta timeouts ni alarga los tiempos de respuesta medidos. El loop
+// principal solo encola peticiones y recoge respuestas por dos colas SPSC sin bloqueos.
+// Hay como mucho una petición en curso; la cola de respuestas reserva siempre un hueco
+// para su respuesta, de modo que las tramas no solicitadas nunca la desplazan.
+//
+// En ESP32 la tarea es de FreeRTOS y corre en el otro núcleo; en host (USE_HOST) es un
+// std::thread, para probar la concurrencia y medirla en Linux.
+class UartTransport {
+ public:
+  static const size_t REQUEST_QUEUE_LENGTH = 2;
+  static const size_t REPLY_QUEUE_LENGTH = 4;
+  // Pausa entre pasadas de la tarea; a 2400 baudios llega un byte cada ~4 ms
+  static constexpr uint32_t TASK_INTERVAL = 1;
+
+#if defined(USE_HOST)
+  ~UartTransport() { this->stop(); }
+  void stop();
+#endif
+
+  // Loop principal
+  bool start(TransportStream *stream);
+  bool send(const char *command, size_t length, char expect, uint32_t timeout);
+  bool receive(TransportReply &reply) { return this->replies_.pop(reply); }
+
+  // Tarea: una pasada de la máquina de estados con el instante actual en ms
+  void run_once(uint32_t now);
+
+  uint32_t requests() const { return this->requests_count_.load(std::memory_order_relaxed); }
+  uint32_t timeouts() const { return this->timeouts_.load(std::memory_order_relaxed); }
+  uint32_t discarded_frames() const { return this->discarded_frames_.load(std::memory_order_relaxed); }
+  int8_t core() const { return this->core_; }
+
+ protected:
+  void read_stream_();
+  void push_reply_(TransportReplyType type, uint32_t elapsed);
+
+  TransportStream *stream_{nullptr};
+  SpscQueue<TransportRequest, REQUEST_QUEUE_LENGTH> requests_;
+  SpscQueue<TransportReply, REPLY_QUEUE_LENGTH> replies_;
+
+  // Solo los usa la tarea
+  FrameAssembler rx_;
+  TransportRequest current_{};
+  bool busy_{false};
+  uint32_t sent_millis_{0};
+
+  std::atomic<uint32_t> requests_count_{0};
+  std::atomic<uint32_t> timeouts_{0};
+  std::atomic<uint32_t> discarded_frames_{0};
+  int8_t core_{-1};
+
+#if defined(USE_HOST)
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+#endif
+};
+
+}  // namespace powermust
+}  // namespace esphome
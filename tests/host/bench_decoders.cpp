@@ -0,0 +1,93 @@
+// ns por trama de cada tipo: decodificadores Megatec y FrameAssembler por separado, sin el
+// componente. Una iteración es una trama, así que la columna Time es el coste por trama.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "powermust/frame_assembler.h"
+#include "powermust/megatec_decoder.h"
+
+namespace esphome {
+namespace powermust {
+
+static const char *const Q1_FRAMES[] = {
+    "(232.4 232.4 232.4 003 49.9 13.4 25.0 00001000\r",  // En línea
+    "(005.2 005.2 226.4 002 50.1 12.7 25.0 10001000\r",  // Fallo de red
+    "(232.4 232.4 232.4 003 49.9 13.4 --.- 00001000\r",  // Sin temperatura
+    "(232.4 232.4 232.4 003 49.9 13.4 25.0 0000\r",      // Truncada: falla en los bits
+};
+static const char *const F_FRAME = "#220.0 003 12.00 50.0\r";
+static const char *const I_FRAME = "#MUSTEK           PowerMust 800   V1.0      \r";
+
+static void BM_DecodeQ1(benchmark::State &state) {
+  const char *frame = Q1_FRAMES[state.range(0)];
+  size_t length = strlen(frame);
+  Q1Sample sample;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decode_q1((const uint8_t *) frame, length, &sample));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_DecodeQ1)->ArgName("frame")->DenseRange(0, 3);
+
+// Solo los campos de una configuración mínima (battery_voltage y utility_fail): el resto se
+// valida sin convertirlo
+static void BM_DecodeQ1Minimal(benchmark::State &state) {
+  const char *frame = Q1_FRAMES[0];
+  size_t length = strlen(frame);
+  Q1Sample sample;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decode_q1((const uint8_t *) frame, length, &sample, Q1_FIELD_BATTERY_VOLTAGE));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeQ1Minimal);
+
+static void BM_DecodeF(benchmark::State &state) {
+  size_t length = strlen(F_FRAME);
+  FSample sample;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decode_f((const uint8_t *) F_FRAME, length, &sample));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_DecodeF);
+
+// Bytes de la UART hasta la trama completa, en lecturas de `chunk` bytes como read_array()
+static void assemble_frames(benchmark::State &state, const char *frame) {
+  size_t length = strlen(frame);
+  size_t chunk = state.range(0);
+  FrameAssembler rx;
+  for (auto _ : state) {
+    for (size_t offset = 0; offset < length; offset += chunk) {
+      // Hasta dos copias si la lectura cruza el final del buffer circular
+      size_t n = std::min(chunk, length - offset);
+      for (size_t copied = 0; copied < n;) {
+        size_t part = std::min(n - copied, rx.write_capacity());
+        memcpy(rx.write_pointer(), frame + offset + copied, part);
+        rx.commit_write(part);
+        copied += part;
+      }
+      if (rx.assemble())
+        benchmark::DoNotOptimize(frame_matches(rx.frame(), rx.frame_length(), frame[0]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * length);
+}
+
+static void BM_AssembleQ1(benchmark::State &state) { assemble_frames(state, Q1_FRAMES[0]); }
+static void BM_AssembleF(benchmark::State &state) { assemble_frames(state, F_FRAME); }
+static void BM_AssembleI(benchmark::State &state) { assemble_frames(state, I_FRAME); }
+BENCHMARK(BM_AssembleQ1)->ArgName("chunk")->Arg(1)->Arg(16)->Arg(64);
+BENCHMARK(BM_AssembleF)->ArgName("chunk")->Arg(1)->Arg(64);
+BENCHMARK(BM_AssembleI)->ArgName("chunk")->Arg(1)->Arg(64);
+
+}  // namespace powermust
+}  // namespace esphome
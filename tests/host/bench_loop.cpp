@@ -0,0 +1,148 @@
+// Coste de Powermust::loop(), latencia de polling a publicación y tramas por segundo contra el
+// SAI simulado. El tiempo medido es solo el de las pasadas del componente (planificador y
+// loop()); el SAI y el reloj simulado quedan fuera.
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+
+#include "fake_ups.h"
+#include "host_runtime.h"
+#include "powermust/powermust.h"
+
+namespace esphome {
+namespace powermust {
+
+struct BenchUnit {
+  explicit BenchUnit(const host::FakeUpsConfig &config) : ups(unit.host_uart(), config) {
+    unit.set_update_interval(1000);
+    unit.set_grid_voltage(&grid_voltage);
+    unit.set_battery_voltage(&battery_voltage);
+    unit.set_ac_output_load_percent(&load);
+    unit.set_utility_fail(&utility_fail);
+    unit.set_ups_info(&ups_info);
+  }
+
+  // Una pasada del bucle principal; devuelve los ns que ha costado
+  uint64_t step(uint32_t step_us) {
+    host::advance_us(step_us);
+    ups.poll(host::now_us());
+    auto start = std::chrono::steady_clock::now();
+    host::run_once(&unit);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  Powermust unit;
+  host::FakeUps ups;
+  sensor::Sensor grid_voltage;
+  sensor::Sensor battery_voltage;
+  sensor::Sensor load;
+  binary_sensor::BinarySensor utility_fail;
+  text_sensor::TextSensor ups_info;
+};
+
+static void reset_host() {
+  host::reset();
+  PowermustBus::reset();
+}
+
+// Avanza en pasos de 1 ms hasta la siguiente publicación de grid_voltage. Con un límite: si el
+// componente deja de publicar el benchmark falla en vez de quedarse colgado
+static bool step_until_published(BenchUnit &bench, uint64_t *component_ns, uint64_t *loop_calls) {
+  uint32_t published = bench.grid_voltage.publish_count();
+  for (uint32_t i = 0; i < 60000; i++) {
+    *component_ns += bench.step(1000);
+    (*loop_calls)++;
+    if (bench.grid_voltage.publish_count() != published)
+      return true;
+  }
+  return false;
+}
+
+// Un ciclo Q1 completo por iteración: petición, bytes a 2400 baudios, decodificación y
+// publicación, con una pasada del bucle principal por ms
+static void BM_Q1Cycle(benchmark::State &state) {
+  reset_host();
+  host::FakeUpsConfig config;
+  config.latency_ms = state.range(0);
+  config.baud_rate = state.range(1);
+  BenchUnit bench(config);
+  bench.unit.setup();
+  host::run_for(&bench.unit, bench.ups, 5000);  // F, I y primeros Q1
+
+  uint64_t loop_calls = 0;
+  uint64_t component_ns = 0;
+  uint64_t latency_us = 0;
+  for (auto _ : state) {
+    uint64_t cycle_ns = 0;
+    if (!step_until_published(bench, &cycle_ns, &loop_calls)) {
+      state.SkipWithError("no Q1 publish");
+      return;
+    }
+    latency_us += host::now_us() - bench.ups.last_q1_request_us();
+    component_ns += cycle_ns;
+    state.SetIterationTime(cycle_ns / 1e9);
+  }
+  state.counters["loop_ns"] = (double) component_ns / loop_calls;
+  state.counters["poll_to_publish_ms"] = latency_us / 1000.0 / state.iterations();
+  state.counters["frames_per_s"] = state.iterations() / (component_ns / 1e9);
+}
+BENCHMARK(BM_Q1Cycle)->ArgNames({"latency_ms", "baud"})->Args({30, 2400})->Args({200, 2400})->Args({0, 0})
+    ->UseManualTime();
+
+// loop() sin nada que hacer entre dos polls: el coste que se paga en cada pasada del bucle
+static void BM_LoopIdle(benchmark::State &state) {
+  reset_host();
+  BenchUnit bench(host::FakeUpsConfig{});
+  bench.unit.setup();
+  host::run_for(&bench.unit, bench.ups, 5000);
+  // Justo después de una publicación queda casi todo el intervalo sin trabajo
+  uint64_t ignored_ns = 0, ignored_calls = 0;
+  if (!step_until_published(bench, &ignored_ns, &ignored_calls)) {
+    state.SkipWithError("no Q1 publish");
+    return;
+  }
+
+  for (auto _ : state)
+    bench.unit.loop();
+}
+BENCHMARK(BM_LoopIdle);
+
+// Decodificación y publicación de una trama Q1 que llega entera en una sola pasada
+static void BM_Q1FrameBurst(benchmark::State &state) {
+  reset_host();
+  host::FakeUpsConfig config;
+  config.latency_ms = 0;
+  config.baud_rate = 0;
+  BenchUnit bench(config);
+  bench.unit.setup();
+  host::run_for(&bench.unit, bench.ups, 5000);
+
+  uint64_t frames = 0;
+  uint64_t component_ns = 0;
+  for (auto _ : state) {
+    // Hasta el siguiente Q1 sin medir; después, solo la pasada que recibe la respuesta
+    state.PauseTiming();
+    uint32_t requests = bench.ups.requests();
+    while (bench.ups.requests() == requests)
+      bench.step(1000);
+    uint32_t published = bench.grid_voltage.publish_count();
+    host::advance_us(1000);
+    bench.ups.poll(host::now_us());
+    state.ResumeTiming();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < 100 && bench.grid_voltage.publish_count() == published; i++)
+      host::run_once(&bench.unit);
+    if (bench.grid_voltage.publish_count() == published) {
+      state.SkipWithError("Q1 reply not decoded in one burst");
+      return;
+    }
+    component_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                        .count();
+    frames++;
+  }
+  state.counters["ns_per_frame"] = (double) component_ns / frames;
+}
+BENCHMARK(BM_Q1FrameBurst);
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,59 @@
+// libFuzzer: decode_q1 y decode_f sobre tramas arbitrarias. El fuzzer entrega un buffer del
+// tamaño exacto, así que ASan detecta cualquier lectura fuera de [data, data + size).
+#include <cmath>
+#include <cstdlib>
+
+#include "powermust/frame_assembler.h"
+#include "powermust/megatec_decoder.h"
+
+using namespace esphome::powermust;
+
+static bool plausible(float value) { return std::isnan(value) || std::fabs(value) <= 1e9f; }
+
+// Un campo sin convertir vale NAN; uno convertido, lo mismo que con todos los campos
+static bool same_or_skipped(float masked, float full, bool converted) {
+  if (!converted)
+    return std::isnan(masked);
+  return masked == full || (std::isnan(masked) && std::isnan(full));
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  Q1Sample q1;
+  uint8_t fields = decode_q1(data, size, &q1);
+  if (fields > Q1_FIELD_COUNT)
+    abort();
+  if (fields == Q1_FIELD_COUNT) {
+    // Como mucho 9 dígitos por campo; los marcadores "--.-" se decodifican como NAN
+    if (!plausible(q1.grid_voltage) || !plausible(q1.grid_fault_voltage) || !plausible(q1.ac_output_voltage) ||
+        !plausible(q1.grid_frequency) || !plausible(q1.battery_voltage) || !plausible(q1.temperature))
+      abort();
+  }
+
+  // La máscara de campos solo quita conversiones: el resultado y los campos convertidos no cambian
+  Q1Sample masked;
+  uint8_t mask = size > 0 ? data[size / 2] & Q1_ALL_FIELDS : Q1_ALL_FIELDS;
+  if (decode_q1(data, size, &masked, mask) != fields)
+    abort();
+  if (fields == Q1_FIELD_COUNT &&
+      (!same_or_skipped(masked.grid_voltage, q1.grid_voltage, mask & Q1_FIELD_GRID_VOLTAGE) ||
+       !same_or_skipped(masked.grid_fault_voltage, q1.grid_fault_voltage, mask & Q1_FIELD_GRID_FAULT_VOLTAGE) ||
+       !same_or_skipped(masked.ac_output_voltage, q1.ac_output_voltage, mask & Q1_FIELD_AC_OUTPUT_VOLTAGE) ||
+       masked.ac_output_load_percent != (mask & Q1_FIELD_AC_OUTPUT_LOAD_PERCENT ? q1.ac_output_load_percent : 0) ||
+       !same_or_skipped(masked.grid_frequency, q1.grid_frequency, mask & Q1_FIELD_GRID_FREQUENCY) ||
+       !same_or_skipped(masked.battery_voltage, q1.battery_voltage, mask & Q1_FIELD_BATTERY_VOLTAGE) ||
+       !same_or_skipped(masked.temperature, q1.temperature, mask & Q1_FIELD_TEMPERATURE) ||
+       masked.status != q1.status))
+    abort();
+
+  FSample f;
+  fields = decode_f(data, size, &f);
+  if (fields > F_FIELD_COUNT)
+    abort();
+  if (fields == F_FIELD_COUNT && (!plausible(f.ac_output_rating_voltage) || !plausible(f.battery_rating_voltage)))
+    abort();
+
+  frame_matches(data, size, '(');
+  frame_matches(data, size, '#');
+  frame_matches(data, size, 0);
+  return 0;
+}
@@ -0,0 +1,99 @@
+// main() para compilar los objetivos de fuzzing sin libFuzzer (gcc): ejecuta cada fichero
+// del corpus y, con --mutations=N, N mutaciones deterministas de cada uno. No sustituye
+// al fuzzer, pero mantiene el corpus como prueba de regresión en ctest.
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static const std::vector<uint8_t> *current = nullptr;
+
+// Como libFuzzer: la entrada que aborta se guarda en crash-input para reproducirla
+static void save_crash(int signal) {
+  if (current != nullptr) {
+    FILE *file = fopen("crash-input", "wb");
+    if (file != nullptr) {
+      fwrite(current->data(), 1, current->size(), file);
+      fclose(file);
+    }
+    fprintf(stderr, "Input that crashed saved to crash-input (%zu bytes)\n", current->size());
+  }
+  std::signal(signal, SIG_DFL);
+  std::raise(signal);
+}
+
+static void run(const std::vector<uint8_t> &input) {
+  current = &input;
+  // Copia del tamaño exacto para que ASan vea las lecturas fuera de rango
+  uint8_t *data = (uint8_t *) malloc(input.size() + 1);
+  if (!input.empty())
+    memcpy(data, input.data(), input.size());
+  LLVMFuzzerTestOneInput(data, input.size());
+  free(data);
+}
+
+static void mutate(std::vector<uint8_t> &input, std::mt19937 &rng) {
+  static const uint8_t TOKENS[] = {'(', '#', '\r', ' ', '.', '-', '0', '9', 0x00, 0xFF};
+  switch (rng() % 5) {
+    case 0:
+      if (!input.empty())
+        input[rng() % input.size()] ^= 1 << (rng() % 8);
+      break;
+    case 1:
+      if (!input.empty())
+        input.resize(rng() % input.size());
+      break;
+    case 2:
+      input.insert(input.begin() + (input.empty() ? 0 : rng() % (input.size() + 1)), TOKENS[rng() % sizeof(TOKENS)]);
+      break;
+    case 3:
+      if (!input.empty())
+        input.erase(input.begin() + rng() % input.size());
+      break;
+    case 4:
+      if (!input.empty())
+        input[rng() % input.size()] = TOKENS[rng() % sizeof(TOKENS)];
+      break;
+  }
+}
+
+int main(int argc, char **argv) {
+  unsigned mutations = 0;
+  std::vector<std::filesystem::path> files;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--mutations=", 12) == 0) {
+      mutations = strtoul(argv[i] + 12, nullptr, 10);
+    } else if (std::filesystem::is_directory(argv[i])) {
+      for (const auto &entry : std::filesystem::directory_iterator(argv[i]))
+        files.push_back(entry.path());
+    } else {
+      files.emplace_back(argv[i]);
+    }
+  }
+
+  std::signal(SIGABRT, save_crash);
+  std::signal(SIGSEGV, save_crash);
+  std::mt19937 rng(1);
+  for (const auto &path : files) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    run(input);
+    for (unsigned n = 0; n < mutations; n++) {
+      std::vector<uint8_t> mutated = input;
+      for (unsigned k = 1 + rng() % 4; k > 0; k--)
+        mutate(mutated, rng);
+      run(mutated);
+    }
+  }
+  printf("%zu inputs, %u mutations each\n", files.size(), mutations);
+  return 0;
+}
@@ -0,0 +1,61 @@
+// libFuzzer: el FrameAssembler con la entrada troceada en lecturas de tamaño variable, como
+// llegan de read_array(). El primer byte elige los tamaños de las lecturas.
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "powermust/frame_assembler.h"
+#include "powermust/megatec_decoder.h"
+
+using namespace esphome::powermust;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (size == 0)
+    return 0;
+  uint32_t chunk_seed = data[0];
+  data++;
+  size--;
+
+  static FrameAssembler rx;
+  rx = FrameAssembler();
+  size_t written = 0;
+  size_t delivered = 0;
+  while (written < size) {
+    chunk_seed = chunk_seed * 1103515245u + 12345u;
+    size_t chunk = 1 + (chunk_seed >> 16) % 48;
+    while (chunk > 0 && written < size) {
+      size_t length = std::min({chunk, rx.write_capacity(), size - written});
+      if (length == 0)
+        break;
+      memcpy(rx.write_pointer(), data + written, length);
+      rx.commit_write(length);
+      written += length;
+      chunk -= length;
+    }
+
+    while (rx.assemble()) {
+      const uint8_t *frame = rx.frame();
+      size_t length = rx.frame_length();
+      // Trama completa: termina en el único '\r' y cabe con el '\0' detrás
+      if (length == 0 || length >= FrameAssembler::FRAME_LENGTH || frame[length - 1] != '\r' || frame[length] != '\0')
+        abort();
+      if (memchr(frame, '\r', length - 1) != nullptr)
+        abort();
+      delivered += length;
+
+      Q1Sample q1;
+      FSample f;
+      if (frame_matches(frame, length, '('))
+        decode_q1(frame, length, &q1);
+      if (frame_matches(frame, length, '#'))
+        decode_f(frame, length, &f);
+    }
+    if (rx.pending() != 0)
+      abort();
+  }
+
+  // Cada byte acaba en una trama entregada, descartado o en la trama parcial en curso
+  if (delivered + rx.discarded_bytes() + rx.frame_length() != written)
+    abort();
+  return 0;
+}
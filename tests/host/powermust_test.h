@@ -0,0 +1,32 @@
+#pragma once
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "fake_ups.h"
+#include "host_runtime.h"
+#include "powermust/powermust.h"
+
+namespace esphome {
+namespace powermust {
+
+// Base de las pruebas: un SAI simulado conectado a la UART de una unidad recién creada, y
+// el ESPHome del host (reloj, planificador, preferencias) vuelto al estado de arranque.
+class PowermustTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    host::reset();
+    PowermustBus::reset();
+    this->ups_ = std::make_unique<host::FakeUps>(this->unit_.host_uart(), this->ups_config_);
+    this->unit_.set_update_interval(1000);
+  }
+
+  void run_for(uint32_t ms) { host::run_for(&this->unit_, *this->ups_, ms); }
+
+  host::FakeUpsConfig ups_config_{};
+  Powermust unit_;
+  std::unique_ptr<host::FakeUps> ups_;
+};
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,111 @@
+#include "capture_replay.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+namespace esphome {
+namespace host {
+
+static const size_t HEADER_LENGTH = 5;
+static const uint8_t FLAG_TX = 0x80;
+static const uint8_t LENGTH_MASK = 0x7F;
+
+std::vector<CaptureRecord> parse_capture(const std::vector<uint8_t> &data) {
+  std::vector<CaptureRecord> records;
+  size_t offset = 0;
+  while (offset + HEADER_LENGTH <= data.size()) {
+    uint32_t timestamp;
+    memcpy(&timestamp, data.data() + offset, sizeof(timestamp));  // Little endian, como el nodo
+    uint8_t flags = data[offset + 4];
+    offset += HEADER_LENGTH;
+    size_t length = std::min<size_t>(flags & LENGTH_MASK, data.size() - offset);
+    records.push_back({timestamp, (flags & FLAG_TX) != 0, std::string((const char *) data.data() + offset, length)});
+    offset += length;
+  }
+  return records;
+}
+
+static std::vector<uint8_t> base64_decode(const std::string &text) {
+  static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::vector<uint8_t> out;
+  uint32_t buffer = 0;
+  int bits = 0;
+  for (char c : text) {
+    const char *pos = strchr(ALPHABET, c);
+    if (c == '=' || c == '\0' || pos == nullptr)
+      break;
+    buffer = (buffer << 6) | (pos - ALPHABET);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back((buffer >> bits) & 0xFF);
+    }
+  }
+  return out;
+}
+
+std::vector<uint8_t> parse_capture_log(const std::string &log) {
+  std::map<unsigned, std::vector<uint8_t>> chunks;
+  std::vector<uint8_t> complete;
+  size_t start = 0;
+  while (start < log.size()) {
+    size_t end = log.find('\n', start);
+    if (end == std::string::npos)
+      end = log.size();
+    std::string line = log.substr(start, end - start);
+    start = end + 1;
+
+    unsigned index, total;
+    char encoded[256];
+    const char *chunk = strstr(line.c_str(), "Capture ");
+    if (line.find("Capture start") != std::string::npos) {
+      chunks.clear();
+    } else if (chunk != nullptr && sscanf(chunk, "Capture %u/%u: %255s", &index, &total, encoded) == 3) {
+      chunks[index] = base64_decode(encoded);
+    } else if (line.find("Capture end") != std::string::npos && !chunks.empty()) {
+      complete.clear();
+      for (auto &entry : chunks)
+        complete.insert(complete.end(), entry.second.begin(), entry.second.end());
+    }
+  }
+  return complete;
+}
+
+std::vector<uint8_t> read_file(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void CaptureReplay::poll(uint64_t now_us) {
+  this->tx_ += this->uart_.take_tx();
+  while (!this->done()) {
+    const CaptureRecord &record = this->records_[this->next_];
+    if (record.tx) {
+      size_t end = this->tx_.find('\r');
+      if (end == std::string::npos)
+        return;
+      std::string frame = this->tx_.substr(0, end + 1);
+      this->tx_.erase(0, end + 1);
+      if (frame != record.data) {
+        if (this->tx_mismatches_++ == 0)
+          this->first_mismatch_ = "record " + std::to_string(this->next_) + ": expected '" + record.data +
+                                  "', received '" + frame + "'";
+      }
+    } else {
+      // micros() da la vuelta cada 71 minutos: la diferencia se hace en 32 bits
+      uint64_t due = this->previous_us_ + (uint32_t) (record.timestamp - this->previous_timestamp_);
+      if (!this->fast_ && this->started_ && now_us < due)
+        return;
+      this->uart_.inject((const uint8_t *) record.data.data(), record.data.size());
+    }
+    this->started_ = true;
+    this->previous_timestamp_ = record.timestamp;
+    this->previous_us_ = now_us;
+    this->next_++;
+  }
+}
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esphome/components/uart/uart.h"
+
+namespace esphome {
+namespace host {
+
+// Un registro de la captura de la UART (powermust/capture_buffer.h)
+struct CaptureRecord {
+  uint32_t timestamp;  // micros() del nodo
+  bool tx;
+  std::string data;
+};
+
+// Registros del binario de captura, el mismo que guarda `powermust_capture.py decode -o`
+std::vector<CaptureRecord> parse_capture(const std::vector<uint8_t> &data);
+// Binario del último volcado completo ("Capture n/m: <base64>") de un log de ESPHome
+std::vector<uint8_t> parse_capture_log(const std::string &log);
+std::vector<uint8_t> read_file(const std::string &path);
+
+// Juega el lado del SAI de una captura contra la UART simulada, como
+// `powermust_capture.py replay`: espera cada TX del nodo y lo compara con el capturado, y
+// entrega cada RX con la separación original respecto al registro anterior o, con fast,
+// en cuanto le toca.
+class CaptureReplay {
+ public:
+  CaptureReplay(uart::HostUart &uart, std::vector<CaptureRecord> records, bool fast)
+      : uart_(uart), records_(std::move(records)), fast_(fast) {}
+
+  void poll(uint64_t now_us);
+
+  bool done() const { return this->next_ == this->records_.size(); }
+  size_t replayed() const { return this->next_; }
+  uint32_t tx_mismatches() const { return this->tx_mismatches_; }
+  const std::string &first_mismatch() const { return this->first_mismatch_; }
+
+ protected:
+  uart::HostUart &uart_;
+  std::vector<CaptureRecord> records_;
+  bool fast_;
+  size_t next_{0};
+  std::string tx_;  // TX del nodo pendiente de comparar
+  bool started_{false};
+  uint32_t previous_timestamp_{0};
+  uint64_t previous_us_{0};
+  uint32_t tx_mismatches_{0};
+  std::string first_mismatch_;
+};
+
+}  // namespace host
+}  // namespace esphome
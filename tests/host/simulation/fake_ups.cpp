@@ -0,0 +1,111 @@
+#include "fake_ups.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "host_runtime.h"
+
+namespace esphome {
+namespace host {
+
+static const uint32_t TEST_DURATION_US = 10000000;  // Un test dura 10 s
+
+void FakeUps::poll(uint64_t now_us) {
+  std::string tx = this->uart_.take_tx();
+  for (char c : tx) {
+    if (c != '\r') {
+      this->request_ += c;
+      continue;
+    }
+    std::string command;
+    command.swap(this->request_);
+    this->requests_++;
+    this->last_command_ = command;
+    if (command == "Q1")
+      this->last_q1_request_us_ = now_us;
+    if (this->on_request)
+      this->on_request(command);
+    if (this->random_percent_() < this->config_.drop_percent)
+      continue;
+
+    std::string reply = this->reply_to_(command, now_us);
+    if (reply.empty())
+      continue;
+    if (this->random_percent_() < this->config_.garbage_percent) {
+      static const char GARBAGE[] = {'\x00', '\xFF', 'x', '(', '#', '\x7F'};
+      reply.insert(0, GARBAGE, 1 + this->rng_() % sizeof(GARBAGE));
+    }
+    uint32_t latency = this->config_.latency_ms;
+    if (this->config_.jitter_ms > 0)
+      latency += this->rng_() % this->config_.jitter_ms;
+    this->pending_.push_back({now_us + (uint64_t) latency * 1000, reply});
+  }
+
+  // La respuesta en curso sale byte a byte a la velocidad de la línea
+  while (!this->pending_.empty()) {
+    PendingReply &reply = this->pending_.front();
+    if (now_us < reply.due_us)
+      return;
+    size_t due = reply.bytes.size();
+    if (this->config_.baud_rate > 0) {
+      uint64_t byte_us = 10000000ULL / this->config_.baud_rate;  // 8N1: 10 bits por byte
+      due = std::min<size_t>(due, 1 + (now_us - reply.due_us) / byte_us);
+    }
+    if (due > this->sent_) {
+      this->uart_.inject((const uint8_t *) reply.bytes.data() + this->sent_, due - this->sent_);
+      this->sent_ = due;
+    }
+    if (this->sent_ < reply.bytes.size())
+      return;
+    this->pending_.pop_front();
+    this->sent_ = 0;
+    this->replies_++;
+  }
+}
+
+std::string FakeUps::reply_to_(const std::string &command, uint64_t now_us) {
+  char reply[64];
+  if (command == "Q1") {
+    if (this->test_active_ && now_us - this->test_us_ >= TEST_DURATION_US)
+      this->test_active_ = false;
+    snprintf(reply, sizeof(reply), "(%05.1f %05.1f %05.1f %03d %04.1f %04.1f 25.0 %d%d001%d%d0\r",
+             this->utility_fail_ ? 5.2f : this->grid_voltage_, 232.4f, 232.4f, this->load_, 49.9f,
+             this->battery_voltage_, this->utility_fail_ ? 1 : 0, this->battery_voltage_ < 11.0f ? 1 : 0,
+             this->test_active_ ? 1 : 0, this->shutdown_active_ ? 1 : 0);
+    return reply;
+  }
+  if (command == "F")
+    return "#220.0 003 12.00 50.0\r";
+  if (command == "I")
+    return this->identity_ + "\r";
+  if (command.empty())
+    return "NAK\r";
+  // Los comandos que no conoce los ignora sin responder, como el equipo real
+  if (command != "Q" && command[0] != 'T' && command[0] != 'C' && command[0] != 'S')
+    return "";
+  if (this->random_percent_() < this->config_.nak_percent)
+    return "NAK\r";
+  if (command[0] == 'T') {
+    this->test_active_ = true;
+    this->test_us_ = now_us;
+  }
+  if (command == "CT")
+    this->test_active_ = false;
+  if (command[0] == 'S')
+    this->shutdown_active_ = true;
+  if (command == "C")
+    this->shutdown_active_ = false;
+  return "ACK\r";
+}
+
+void run_for(Component *component, FakeUps &ups, uint32_t ms, uint32_t step_us) {
+  uint64_t end = now_us() + (uint64_t) ms * 1000;
+  while (now_us() < end) {
+    advance_us(step_us);
+    ups.poll(now_us());
+    run_once(component);
+  }
+}
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+
+#include "esphome/components/uart/uart.h"
+
+namespace esphome {
+namespace host {
+
+struct FakeUpsConfig {
+  uint32_t latency_ms{30};     // Desde el '\r' de la petición hasta el primer byte
+  uint32_t jitter_ms{0};       // Latencia extra aleatoria, 0..jitter_ms
+  uint32_t baud_rate{2400};    // 0 = la respuesta llega entera de golpe
+  uint8_t drop_percent{0};     // Peticiones sin respuesta
+  uint8_t nak_percent{0};      // Comandos ACK/NAK respondidos con NAK
+  uint8_t garbage_percent{0};  // Respuestas precedidas de basura de la línea
+  uint32_t seed{1};
+};
+
+// SAI Megatec simulado, el mismo modelo que tests/esp32-megatec-simulator.yaml: responde
+// Q1, F, I y los comandos ACK/NAK con latencia, jitter, basura y respuestas perdidas, y
+// sube los bits de test y apagado tras "T.." y "S..". Los comandos desconocidos no tienen
+// respuesta.
+class FakeUps {
+ public:
+  FakeUps(uart::HostUart &uart, const FakeUpsConfig &config) : uart_(uart), config_(config), rng_(config.seed) {}
+
+  // Lee las peticiones nuevas y entrega los bytes de respuesta que ya tocan
+  void poll(uint64_t now_us);
+
+  void set_utility_fail(bool utility_fail) { this->utility_fail_ = utility_fail; }
+  void set_load(int load) { this->load_ = load; }
+  void set_battery_voltage(float battery_voltage) { this->battery_voltage_ = battery_voltage; }
+  void set_grid_voltage(float grid_voltage) { this->grid_voltage_ = grid_voltage; }
+  void set_identity(const std::string &identity) { this->identity_ = identity; }
+  FakeUpsConfig &config() { return this->config_; }
+
+  uint32_t requests() const { return this->requests_; }
+  uint32_t replies() const { return this->replies_; }
+  uint64_t last_q1_request_us() const { return this->last_q1_request_us_; }
+  const std::string &last_command() const { return this->last_command_; }
+  // Se llama con cada petición completa, sin el '\r'
+  std::function<void(const std::string &)> on_request;
+
+ protected:
+  struct PendingReply {
+    uint64_t due_us;
+    std::string bytes;
+  };
+
+  std::string reply_to_(const std::string &command, uint64_t now_us);
+  uint32_t random_percent_() { return this->rng_() % 100; }
+
+  uart::HostUart &uart_;
+  FakeUpsConfig config_;
+  std::mt19937 rng_;
+  std::string request_;
+  std::deque<PendingReply> pending_;
+  size_t sent_{0};  // Bytes ya entregados de la respuesta en curso
+
+  bool utility_fail_{false};
+  int load_{3};
+  float battery_voltage_{13.4f};
+  float grid_voltage_{232.4f};
+  std::string identity_{"#MUSTEK           PowerMust 800   V1.0      "};
+  uint64_t test_us_{0};
+  bool test_active_{false};
+  bool shutdown_active_{false};
+
+  uint32_t requests_{0};
+  uint32_t replies_{0};
+  uint64_t last_q1_request_us_{0};
+  std::string last_command_;
+};
+
+// Avanza el reloj simulado en pasos de step_us durante ms milisegundos: en cada paso el
+// SAI entrega sus bytes y se ejecuta una pasada del bucle principal del componente.
+void run_for(Component *component, FakeUps &ups, uint32_t ms, uint32_t step_us = 1000);
+
+}  // namespace host
+}  // namespace esphome
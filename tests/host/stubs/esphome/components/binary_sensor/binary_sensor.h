@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace binary_sensor {
+
+class BinarySensor {
+ public:
+  void publish_state(bool state) {
+    this->state = state;
+    this->has_state_ = true;
+    this->publish_count_++;
+  }
+  void invalidate_state() { this->has_state_ = false; }
+  bool has_state() const { return this->has_state_; }
+  uint32_t publish_count() const { return this->publish_count_; }
+
+  bool state{false};
+
+ protected:
+  bool has_state_{false};
+  uint32_t publish_count_{0};
+};
+
+}  // namespace binary_sensor
+}  // namespace esphome
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace switch_ {
+
+class Switch {
+ public:
+  virtual ~Switch() = default;
+  void publish_state(bool state) {
+    this->state = state;
+    this->publish_count_++;
+  }
+  void turn_on() { this->write_state(true); }
+  void turn_off() { this->write_state(false); }
+  uint32_t publish_count() const { return this->publish_count_; }
+
+  bool state{false};
+
+ protected:
+  virtual void write_state(bool state) = 0;
+
+  uint32_t publish_count_{0};
+};
+
+}  // namespace switch_
+}  // namespace esphome
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor {
+ public:
+  void publish_state(const std::string &state) {
+    this->state = state;
+    this->has_state_ = true;
+    this->publish_count_++;
+  }
+  bool has_state() const { return this->has_state_; }
+  uint32_t publish_count() const { return this->publish_count_; }
+
+  std::string state;
+
+ protected:
+  bool has_state_{false};
+  uint32_t publish_count_{0};
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
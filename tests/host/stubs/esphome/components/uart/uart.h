@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace uart {
+
+// Los dos extremos de una UART del host. El lado del componente lee rx y escribe tx; el
+// SAI simulado (o la captura reproducida) hace lo contrario. El mutex permite que la tarea
+// de transporte y el SAI corran en hilos distintos.
+class HostUart {
+ public:
+  // Lado del SAI
+  void inject(const uint8_t *data, size_t length);
+  void inject(const std::string &data) { this->inject((const uint8_t *) data.data(), data.size()); }
+  std::string take_tx();
+  size_t rx_pending();
+
+  // Lado del componente
+  size_t available();
+  bool read_array(uint8_t *data, size_t length);
+  void write_array(const uint8_t *data, size_t length);
+
+  uint32_t bytes_written() const { return this->bytes_written_; }
+
+ protected:
+  std::mutex mutex_;
+  std::deque<uint8_t> rx_;
+  std::string tx_;
+  uint32_t bytes_written_{0};
+};
+
+class UARTComponent {};
+
+class UARTDevice {
+ public:
+  UARTDevice() {}
+
+  void write_byte(uint8_t data) { this->uart_.write_array(&data, 1); }
+  void write(uint8_t data) { this->uart_.write_array(&data, 1); }
+  void write_array(const uint8_t *data, size_t len) { this->uart_.write_array(data, len); }
+  void write_array(const std::vector<uint8_t> &data) { this->uart_.write_array(data.data(), data.size()); }
+  void write_str(const char *str);
+  bool read_byte(uint8_t *data) { return this->uart_.read_array(data, 1); }
+  bool read_array(uint8_t *data, size_t len) { return this->uart_.read_array(data, len); }
+  int available() { return (int) this->uart_.available(); }
+  void flush() {}
+
+  HostUart &host_uart() { return this->uart_; }
+
+ protected:
+  HostUart uart_;
+};
+
+}  // namespace uart
+}  // namespace esphome
@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <tuple>
+#include <vector>
+
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+
+template<typename... Ts> class Trigger {
+ public:
+  virtual ~Trigger() = default;
+  void trigger(Ts... x) {
+    if (this->on_trigger_)
+      this->on_trigger_(x...);
+  }
+  // Solo en el host: lo que haría la automatización configurada
+  void set_host_action(std::function<void(Ts...)> &&action) { this->on_trigger_ = std::move(action); }
+
+ protected:
+  std::function<void(Ts...)> on_trigger_;
+};
+
+template<typename T, typename... X> class TemplatableValue {
+ public:
+  TemplatableValue() {}
+  TemplatableValue(T value) : value_(value) {}
+  template<typename F> TemplatableValue(F f) : f_(f) {}
+  bool has_value() const { return true; }
+  T value(X... x) { return this->f_ ? this->f_(x...) : this->value_; }
+
+ protected:
+  T value_{};
+  std::function<T(X...)> f_;
+};
+
+#define TEMPLATABLE_VALUE_(type, name) \
+ protected: \
+  TemplatableValue<type, Ts...> name##_{}; \
+\
+ public: \
+  template<typename V> void set_##name(V name) { this->name##_ = name; }
+#define TEMPLATABLE_VALUE(type, name) TEMPLATABLE_VALUE_(type, name)
+
+template<typename... Ts> class Action {
+ public:
+  virtual ~Action() = default;
+  virtual void play(Ts... x) = 0;
+};
+
+template<typename... Ts> class Condition {
+ public:
+  virtual ~Condition() = default;
+  virtual bool check(Ts... x) = 0;
+};
+
+}  // namespace esphome
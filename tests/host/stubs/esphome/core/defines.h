@@ -0,0 +1,2 @@
+#pragma once
+// Las defines de las funciones opcionales las pasa CMake por objetivo
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome {
+
+uint32_t millis();
+uint32_t micros();
+void yield();
+void delay(uint32_t ms);
+
+}  // namespace esphome
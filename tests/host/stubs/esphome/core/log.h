@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdarg>
+
+namespace esphome {
+
+enum HostLogLevel : int {
+  HOST_LOG_NONE = 0,
+  HOST_LOG_ERROR = 1,
+  HOST_LOG_WARN = 2,
+  HOST_LOG_INFO = 3,
+  HOST_LOG_CONFIG = 4,
+  HOST_LOG_DEBUG = 5,
+  HOST_LOG_VERBOSE = 6,
+};
+
+// Nivel de log del host; por defecto solo avisos y errores (POWERMUST_HOST_LOG lo cambia)
+void host_log_set_level(int level);
+// Recibe todas las líneas de log, de cualquier nivel, además de la salida a stderr
+void host_log_set_sink(void (*sink)(int level, const char *tag, const char *message));
+bool host_log_enabled(int level);
+void host_log(int level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+}  // namespace esphome
+
+// Los argumentos no se evalúan con el nivel desactivado, como en el firmware
+#define ESPHOME_HOST_LOG_(level, tag, ...) \
+  do { \
+    if (::esphome::host_log_enabled(level)) \
+      ::esphome::host_log(level, tag, __VA_ARGS__); \
+  } while (0)
+
+#define ESP_LOGE(tag, ...) ESPHOME_HOST_LOG_(::esphome::HOST_LOG_ERROR, tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ESPHOME_HOST_LOG_(::esphome::HOST_LOG_WARN, tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ESPHOME_HOST_LOG_(::esphome::HOST_LOG_INFO, tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ESPHOME_HOST_LOG_(::esphome::HOST_LOG_CONFIG, tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ESPHOME_HOST_LOG_(::esphome::HOST_LOG_DEBUG, tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ESPHOME_HOST_LOG_(::esphome::HOST_LOG_VERBOSE, tag, __VA_ARGS__)
+#define ESP_LOGVV(tag, ...) ESPHOME_HOST_LOG_(::esphome::HOST_LOG_VERBOSE, tag, __VA_ARGS__)
+
+#define LOG_SENSOR(prefix, type, obj) (void) (obj)
+#define LOG_BINARY_SENSOR(prefix, type, obj) (void) (obj)
+#define LOG_TEXT_SENSOR(prefix, type, obj) (void) (obj)
+#define LOG_SWITCH(prefix, type, obj) (void) (obj)
+#define LOG_UPDATE_INTERVAL(obj) (void) (obj)
+#define YESNO(b) ((b) ? "YES" : "NO")
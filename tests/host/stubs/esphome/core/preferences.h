@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace esphome {
+
+// Preferencias en memoria; sobreviven a host::reboot() y host::reset() las borra
+std::map<uint32_t, std::vector<uint8_t>> &host_preference_store();
+
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() {}
+  explicit ESPPreferenceObject(uint32_t key) : key(key) {}
+
+  template<typename T> bool save(const T *src) {
+    host_preference_store()[this->key].assign((const uint8_t *) src, (const uint8_t *) src + sizeof(T));
+    return true;
+  }
+  template<typename T> bool load(T *dest) {
+    auto it = host_preference_store().find(this->key);
+    if (it == host_preference_store().end() || it->second.size() != sizeof(T))
+      return false;
+    memcpy(dest, it->second.data(), sizeof(T));
+    return true;
+  }
+
+  uint32_t key{0};
+};
+
+class ESPPreferences {
+ public:
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash) {
+    return ESPPreferenceObject(type);
+  }
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type) { return ESPPreferenceObject(type); }
+  bool sync() { return true; }
+};
+
+extern ESPPreferences *global_preferences;
+
+}  // namespace esphome
@@ -0,0 +1,276 @@
+#include "host_runtime.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "esphome/components/uart/uart.h"
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+
+namespace esphome {
+
+namespace setup_priority {
+const float DATA = 600.0f;
+const float LATE = -100.0f;
+}  // namespace setup_priority
+
+// ------------------- Reloj -------------------
+
+static bool real_clock = false;
+static uint64_t simulated_us = 0;
+static const auto clock_origin = std::chrono::steady_clock::now();
+
+uint64_t host::now_us() {
+  if (real_clock)
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - clock_origin)
+        .count();
+  return simulated_us;
+}
+void host::use_real_clock(bool real) { real_clock = real; }
+void host::advance_us(uint64_t us) { simulated_us += us; }
+
+uint32_t millis() { return (uint32_t) (host::now_us() / 1000); }
+uint32_t micros() { return (uint32_t) host::now_us(); }
+void yield() {}
+void delay(uint32_t ms) {
+  if (!real_clock)
+    host::advance_ms(ms);
+}
+
+// ------------------- Log -------------------
+
+static int log_level = -1;
+static void (*log_sink)(int level, const char *tag, const char *message) = nullptr;
+
+void host_log_set_level(int level) { log_level = level; }
+void host_log_set_sink(void (*sink)(int level, const char *tag, const char *message)) { log_sink = sink; }
+
+static bool host_log_printed(int level) {
+  if (log_level < 0) {
+    const char *env = getenv("POWERMUST_HOST_LOG");
+    log_level = env != nullptr ? atoi(env) : HOST_LOG_WARN;
+  }
+  return level <= log_level;
+}
+
+bool host_log_enabled(int level) { return log_sink != nullptr || host_log_printed(level); }
+
+void host_log(int level, const char *tag, const char *format, ...) {
+  static const char LETTERS[] = "-EWICDV";
+  char message[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  if (log_sink != nullptr)
+    log_sink(level, tag, message);
+  if (host_log_printed(level))
+    fprintf(stderr, "[%c][%s] %s\n", LETTERS[level], tag, message);
+}
+
+// ------------------- Utilidades -------------------
+
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= (uint8_t) c;
+  }
+  return hash;
+}
+
+uint32_t random_uint32() { return (uint32_t) rand(); }
+
+std::string format_hex(const uint8_t *data, size_t length) {
+  static const char DIGITS[] = "0123456789abcdef";
+  std::string out;
+  for (size_t i = 0; i < length; i++) {
+    out += DIGITS[data[i] >> 4];
+    out += DIGITS[data[i] & 0x0F];
+  }
+  return out;
+}
+
+std::string format_hex_pretty(const uint8_t *data, size_t length) { return format_hex(data, length); }
+
+std::string base64_encode(const uint8_t *buf, size_t buf_len) {
+  static const char CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  size_t i = 0;
+  for (; i + 2 < buf_len; i += 3) {
+    uint32_t v = (uint32_t) buf[i] << 16 | (uint32_t) buf[i + 1] << 8 | buf[i + 2];
+    out += CHARS[v >> 18];
+    out += CHARS[(v >> 12) & 63];
+    out += CHARS[(v >> 6) & 63];
+    out += CHARS[v & 63];
+  }
+  if (i < buf_len) {
+    uint32_t v = (uint32_t) buf[i] << 16 | (i + 1 < buf_len ? (uint32_t) buf[i + 1] << 8 : 0);
+    out += CHARS[v >> 18];
+    out += CHARS[(v >> 12) & 63];
+    out += i + 1 < buf_len ? CHARS[(v >> 6) & 63] : '=';
+    out += '=';
+  }
+  return out;
+}
+
+// ------------------- Preferencias -------------------
+
+std::map<uint32_t, std::vector<uint8_t>> &host_preference_store() {
+  static std::map<uint32_t, std::vector<uint8_t>> store;
+  return store;
+}
+
+static ESPPreferences host_preferences;
+ESPPreferences *global_preferences = &host_preferences;
+
+// ------------------- Planificador -------------------
+
+// Como el planificador de ESPHome, cada set_timeout / set_interval crea un item en el heap
+// y uno con el mismo nombre sustituye al anterior del mismo componente.
+struct ScheduledItem {
+  Component *component;
+  std::string name;
+  uint32_t due;
+  uint32_t interval;  // 0 = timeout
+  std::function<void()> callback;
+  bool removed;
+};
+
+static std::vector<ScheduledItem *> scheduled_items;
+
+static bool cancel_item(Component *component, const std::string &name, bool interval) {
+  if (name.empty())
+    return false;
+  bool found = false;
+  for (auto *item : scheduled_items) {
+    if (!item->removed && item->component == component && item->name == name && (item->interval != 0) == interval) {
+      item->removed = true;
+      found = true;
+    }
+  }
+  return found;
+}
+
+static void schedule(Component *component, const std::string &name, uint32_t delay, uint32_t interval,
+                     std::function<void()> &&callback) {
+  cancel_item(component, name, interval != 0);
+  scheduled_items.push_back(new ScheduledItem{component, name, millis() + delay, interval, std::move(callback), false});
+}
+
+void Component::set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f) {
+  schedule(this, name, timeout, 0, std::move(f));
+}
+void Component::set_timeout(uint32_t timeout, std::function<void()> &&f) { schedule(this, "", timeout, 0, std::move(f)); }
+bool Component::cancel_timeout(const std::string &name) { return cancel_item(this, name, false); }
+void Component::set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f) {
+  schedule(this, name, interval, interval, std::move(f));
+}
+void Component::set_interval(uint32_t interval, std::function<void()> &&f) {
+  schedule(this, "", interval, interval, std::move(f));
+}
+bool Component::cancel_interval(const std::string &name) { return cancel_item(this, name, true); }
+
+void host::run_scheduler() {
+  uint32_t now = millis();
+  // Los callbacks pueden programar items nuevos: solo se recorren los que ya existían
+  size_t count = scheduled_items.size();
+  for (size_t i = 0; i < count; i++) {
+    ScheduledItem *item = scheduled_items[i];
+    if (item->removed || (int32_t) (now - item->due) < 0)
+      continue;
+    if (item->interval == 0) {
+      item->removed = true;
+    } else {
+      item->due += item->interval;
+    }
+    item->callback();
+  }
+  size_t kept = 0;
+  for (auto *item : scheduled_items) {
+    if (item->removed) {
+      delete item;
+    } else {
+      scheduled_items[kept++] = item;
+    }
+  }
+  scheduled_items.resize(kept);
+}
+
+size_t host::scheduler_items() { return scheduled_items.size(); }
+
+void host::run_once(Component *component) {
+  host::run_scheduler();
+  if (component->is_loop_enabled())
+    component->loop();
+}
+
+void host::reboot() {
+  log_sink = nullptr;
+  for (auto *item : scheduled_items)
+    delete item;
+  scheduled_items.clear();
+  simulated_us = 0;
+  real_clock = false;
+}
+
+void host::reset() {
+  host::reboot();
+  host_preference_store().clear();
+}
+
+// ------------------- UART -------------------
+
+namespace uart {
+
+void HostUart::inject(const uint8_t *data, size_t length) {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->rx_.insert(this->rx_.end(), data, data + length);
+}
+
+std::string HostUart::take_tx() {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  // clear() conserva la capacidad: escribir no vuelve a reservar memoria en el lado del componente
+  std::string tx = this->tx_;
+  this->tx_.clear();
+  return tx;
+}
+
+size_t HostUart::rx_pending() {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  return this->rx_.size();
+}
+
+size_t HostUart::available() {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  return this->rx_.size();
+}
+
+bool HostUart::read_array(uint8_t *data, size_t length) {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  if (this->rx_.size() < length)
+    return false;
+  for (size_t i = 0; i < length; i++) {
+    data[i] = this->rx_.front();
+    this->rx_.pop_front();
+  }
+  return true;
+}
+
+void HostUart::write_array(const uint8_t *data, size_t length) {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->tx_.append((const char *) data, length);
+  this->bytes_written_ += length;
+}
+
+void UARTDevice::write_str(const char *str) { this->uart_.write_array((const uint8_t *) str, strlen(str)); }
+
+}  // namespace uart
+}  // namespace esphome
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+
+class Component;
+
+namespace host {
+
+// Reloj simulado en µs: millis() y micros() avanzan solo con advance_*(). Con el reloj
+// real (tarea de transporte, hilos) siguen a steady_clock desde el arranque del proceso.
+void use_real_clock(bool real);
+uint64_t now_us();
+void advance_us(uint64_t us);
+inline void advance_ms(uint32_t ms) { advance_us((uint64_t) ms * 1000); }
+
+// Ejecuta los set_timeout / set_interval vencidos, como App.loop() antes de cada componente
+void run_scheduler();
+// Items del planificador pendientes (timeouts e intervalos)
+size_t scheduler_items();
+// Una pasada del bucle principal para un componente: planificador y loop() si está activo
+void run_once(Component *component);
+
+// Reinicio del nodo: reloj a cero y planificador vacío; las preferencias se conservan
+void reboot();
+// Vuelve al estado de fábrica: además, preferencias vacías
+void reset();
+
+}  // namespace host
+}  // namespace esphome
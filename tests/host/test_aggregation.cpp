@@ -0,0 +1,68 @@
+// Agregación por ventanas (USE_POWERMUST_AGGREGATION): el define la compila para todas las
+// unidades, pero solo agrega la que tiene ventana; las demás publican cada muestra.
+#include "powermust_test.h"
+
+namespace esphome {
+namespace powermust {
+
+class AggregationTest : public PowermustTest {
+ protected:
+  void SetUp() override {
+    PowermustTest::SetUp();
+    this->unit_.set_grid_voltage(&this->grid_voltage_);
+    this->unit_.set_grid_voltage_avg(&this->grid_voltage_avg_);
+    this->plain_unit_.set_update_interval(1000);
+    this->plain_unit_.set_grid_voltage(&this->plain_grid_voltage_);
+  }
+
+  // Las dos unidades, cada una con su SAI, en pasos de 1 ms
+  void run_both_for(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      host::advance_us(1000);
+      this->ups_->poll(host::now_us());
+      this->plain_ups_.poll(host::now_us());
+      host::run_once(&this->unit_);
+      host::run_once(&this->plain_unit_);
+    }
+  }
+
+  sensor::Sensor grid_voltage_;
+  sensor::Sensor grid_voltage_avg_;
+  Powermust plain_unit_;
+  sensor::Sensor plain_grid_voltage_;
+  host::FakeUps plain_ups_{this->plain_unit_.host_uart(), host::FakeUpsConfig{}};
+};
+
+TEST_F(AggregationTest, WindowIsPerUnit) {
+  this->unit_.set_aggregation_window(5000);
+  this->unit_.setup();
+  this->plain_unit_.setup();
+  this->run_both_for(5000);  // F, I y primeros Q1
+  uint32_t q1_before = this->plain_ups_.requests();
+  uint32_t plain_before = this->plain_grid_voltage_.publish_count();
+  uint32_t average_before = this->grid_voltage_avg_.publish_count();
+
+  this->run_both_for(20000);
+  uint32_t q1 = this->plain_ups_.requests() - q1_before;
+  ASSERT_GE(q1, 15u);
+  // Sin ventana, una publicación por Q1
+  EXPECT_EQ(this->plain_grid_voltage_.publish_count() - plain_before, q1);
+  // Con ventana de 5 s, solo la media de cada ventana; el sensor suelto no se publica
+  uint32_t windows = this->grid_voltage_avg_.publish_count() - average_before;
+  EXPECT_GE(windows, 3u);
+  EXPECT_LE(windows, 5u);
+  EXPECT_EQ(this->grid_voltage_.publish_count(), 0u);
+  EXPECT_FLOAT_EQ(this->grid_voltage_avg_.state, 232.4f);
+}
+
+TEST_F(AggregationTest, ZeroWindowPublishesEverySample) {
+  this->unit_.setup();
+  this->plain_unit_.setup();
+  this->run_both_for(10000);
+  EXPECT_EQ(this->grid_voltage_avg_.publish_count(), 0u);
+  EXPECT_EQ(this->grid_voltage_.publish_count(), this->plain_grid_voltage_.publish_count());
+  EXPECT_GE(this->grid_voltage_.publish_count(), 5u);
+}
+
+}  // namespace powermust
+}  // namespace esphome
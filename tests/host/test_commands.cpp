@@ -0,0 +1,119 @@
+// Cola de comandos: reintentos, ACK/NAK y contadores de la instrumentación
+#include "powermust_test.h"
+
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace powermust {
+
+class CommandTest : public PowermustTest {
+ protected:
+  void SetUp() override {
+    PowermustTest::SetUp();
+    this->unit_.set_timeout_count(&this->timeout_count_);
+    this->unit_.set_nak_count(&this->nak_count_);
+    this->unit_.setup();
+    this->run_for(5000);
+  }
+
+  // La instrumentación publica cada minuto
+  void run_until_instrumentation() { this->run_for(60000); }
+
+  sensor::Sensor timeout_count_;
+  sensor::Sensor nak_count_;
+};
+
+TEST_F(CommandTest, NoReplyCommandIsNotATimeout) {
+  this->unit_.switch_command("PW");
+  this->run_until_instrumentation();
+
+  EXPECT_EQ(this->ups_->last_command(), "Q1");
+  ASSERT_TRUE(this->timeout_count_.has_state());
+  EXPECT_FLOAT_EQ(this->timeout_count_.state, 0.0f);
+}
+
+TEST_F(CommandTest, MissingAckCountsAsTimeout) {
+  // Solo se pierden las respuestas al comando, no las de los polls
+  this->ups_->on_request = [this](const std::string &command) {
+    this->ups_->config().drop_percent = command == "Q" ? 100 : 0;
+  };
+  this->unit_.switch_command("Q");
+  this->run_until_instrumentation();
+
+  ASSERT_TRUE(this->timeout_count_.has_state());
+  EXPECT_GE(this->timeout_count_.state, 1.0f);
+}
+
+TEST_F(CommandTest, NakIsCounted) {
+  this->ups_->config().nak_percent = 100;
+  this->unit_.switch_command("Q");
+  this->run_until_instrumentation();
+
+  ASSERT_TRUE(this->nak_count_.has_state());
+  EXPECT_FLOAT_EQ(this->nak_count_.state, 1.0f);
+}
+
+// Orden en que los comandos encolados llegan al SAI
+class CommandQueueTest : public CommandTest {
+ protected:
+  void SetUp() override {
+    this->unit_.set_command_queue_dropped(&this->dropped_);
+    CommandTest::SetUp();
+    this->ups_->on_request = [this](const std::string &command) {
+      if (command != "Q1")
+        this->sent_.push_back(command);
+    };
+  }
+
+  sensor::Sensor dropped_;
+  std::vector<std::string> sent_;
+};
+
+TEST_F(CommandQueueTest, DuplicatesAreCoalesced) {
+  this->unit_.switch_command("T");
+  this->unit_.switch_command("T");
+  // Un segundo toggle del zumbador anula el pendiente
+  this->unit_.switch_command("Q");
+  this->unit_.switch_command("Q");
+  // Un apagado sustituye al apagado pendiente
+  this->unit_.switch_command("S.5");
+  this->unit_.switch_command("S01");
+  this->run_for(10000);
+
+  EXPECT_EQ(this->sent_, (std::vector<std::string>{"S01", "T"}));
+}
+
+TEST_F(CommandQueueTest, HigherPriorityIsSentFirst) {
+  this->unit_.switch_command("PW");
+  this->unit_.switch_command("Q");
+  this->unit_.switch_command("T");
+  this->unit_.switch_command("S.5");
+  this->unit_.switch_command("PX");
+  this->run_for(10000);
+
+  // Misma prioridad: por orden de llegada
+  EXPECT_EQ(this->sent_, (std::vector<std::string>{"S.5", "T", "PW", "Q", "PX"}));
+}
+
+TEST_F(CommandQueueTest, FullQueueEvictsNewestLowerPriority) {
+  std::vector<std::string> expected{"T"};
+  for (char c = '0'; c <= '9'; c++) {
+    std::string command = std::string("P") + c;
+    this->unit_.switch_command(command.c_str());
+    if (c != '9')
+      expected.push_back(command);
+  }
+  // Cola llena: un comando de la misma prioridad se descarta; uno de mayor prioridad
+  // sustituye al más reciente de la menor
+  this->unit_.switch_command("PA");
+  this->unit_.switch_command("T");
+  this->run_for(20000);
+
+  EXPECT_EQ(this->sent_, expected);
+  ASSERT_TRUE(this->dropped_.has_state());
+  EXPECT_FLOAT_EQ(this->dropped_.state, 2.0f);
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,136 @@
+// Perfil del equipo: exploración en frío, arranque en caliente desde la caché, verificación
+// con un solo poll de I y polls periódicos de F e I según su planificación
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fake_ups.h"
+#include "host_runtime.h"
+#include "powermust/powermust.h"
+
+namespace esphome {
+namespace powermust {
+
+static const char *const OTHER_UPS = "#MUSTEK           PowerMust 1000  V2.0      ";
+
+class DeviceProfileTest : public ::testing::Test {
+ protected:
+  void SetUp() override { host::reset(); }
+
+  // Un arranque del nodo: unidad nueva, mismo flash y mismo SAI
+  void boot() {
+    host::reboot();
+    PowermustBus::reset();
+    this->ups_.reset();
+    this->unit_ = std::make_unique<Powermust>();
+    this->ups_ = std::make_unique<host::FakeUps>(this->unit_->host_uart(), host::FakeUpsConfig{});
+    this->ups_->set_identity(this->identity_);
+    this->ups_->on_request = [this](const std::string &command) { this->requests_.push_back(command); };
+    this->requests_.clear();
+    this->ups_info_ = text_sensor::TextSensor();
+    this->rating_voltage_ = sensor::Sensor();
+    this->grid_voltage_ = sensor::Sensor();
+    this->unit_->set_update_interval(1000);
+    this->unit_->set_ups_info(&this->ups_info_);
+    this->unit_->set_ac_output_rating_voltage(&this->rating_voltage_);
+    this->unit_->set_grid_voltage(&this->grid_voltage_);
+    if (this->static_interval_ > 0) {
+      this->unit_->set_polling_schedule(POLLING_F, this->static_interval_, 5, POLLING_POLICY_INTERVAL);
+      this->unit_->set_polling_schedule(POLLING_I, this->static_interval_, 1, POLLING_POLICY_INTERVAL);
+    }
+    this->unit_->setup();
+  }
+
+  void run_for(uint32_t ms) { host::run_for(this->unit_.get(), *this->ups_, ms); }
+  long requests(const char *command) const { return std::count(this->requests_.begin(), this->requests_.end(), command); }
+
+  std::string identity_{"#MUSTEK           PowerMust 800   V1.0      "};
+  uint32_t static_interval_{0};
+  std::unique_ptr<Powermust> unit_;
+  std::unique_ptr<host::FakeUps> ups_;
+  std::vector<std::string> requests_;
+  text_sensor::TextSensor ups_info_;
+  sensor::Sensor rating_voltage_;
+  sensor::Sensor grid_voltage_;
+};
+
+TEST_F(DeviceProfileTest, ColdBootProbesFAndI) {
+  this->boot();
+  EXPECT_FALSE(this->ups_info_.has_state());
+  this->run_for(10000);
+
+  EXPECT_EQ(this->requests("F"), 1);
+  EXPECT_EQ(this->requests("I"), 1);
+  EXPECT_EQ(this->ups_info_.state, this->identity_);
+  EXPECT_FLOAT_EQ(this->rating_voltage_.state, 220.0f);
+}
+
+TEST_F(DeviceProfileTest, WarmBootVerifiesWithOneIPoll) {
+  this->boot();
+  this->run_for(10000);
+  this->boot();
+
+  // Publicado desde la caché antes de preguntar nada
+  EXPECT_EQ(this->ups_info_.state, this->identity_);
+  EXPECT_FLOAT_EQ(this->rating_voltage_.state, 220.0f);
+  this->run_for(10000);
+  EXPECT_EQ(this->requests("I"), 1);
+  EXPECT_EQ(this->requests("F"), 0);
+  EXPECT_GE(this->requests("Q1"), 8);
+}
+
+TEST_F(DeviceProfileTest, WarmBootWithAnotherUpsProbesAgain) {
+  this->boot();
+  this->run_for(10000);
+  this->identity_ = OTHER_UPS;
+  this->boot();
+  this->run_for(10000);
+
+  EXPECT_EQ(this->requests("I"), 1);
+  EXPECT_EQ(this->requests("F"), 1);
+  EXPECT_EQ(this->ups_info_.state, OTHER_UPS);
+
+  // El perfil nuevo ha quedado guardado: el siguiente arranque vuelve a ser en caliente
+  this->boot();
+  EXPECT_EQ(this->ups_info_.state, OTHER_UPS);
+  this->run_for(10000);
+  EXPECT_EQ(this->requests("I"), 1);
+  EXPECT_EQ(this->requests("F"), 0);
+}
+
+TEST_F(DeviceProfileTest, WarmBootKeepsConfiguredIntervals) {
+  this->static_interval_ = 60000;
+  this->boot();
+  this->run_for(10000);
+  this->boot();
+  this->run_for(300500);
+
+  EXPECT_EQ(this->requests("F"), 5);
+  EXPECT_EQ(this->requests("I"), 1 + 5);  // Verificación y un poll por minuto
+
+  // Los polls sueltos de I no quitan F del perfil guardado
+  this->boot();
+  EXPECT_FLOAT_EQ(this->rating_voltage_.state, 220.0f);
+}
+
+TEST_F(DeviceProfileTest, UnansweredVerificationKeepsProfile) {
+  this->boot();
+  this->run_for(10000);
+  this->boot();
+  this->ups_->on_request = [this](const std::string &command) {
+    this->requests_.push_back(command);
+    this->ups_->config().drop_percent = command == "I" ? 100 : 0;
+  };
+  this->run_for(10000);
+  EXPECT_GE(this->requests("I"), 2);
+  EXPECT_EQ(this->requests("F"), 0);
+
+  this->boot();
+  EXPECT_EQ(this->ups_info_.state, this->identity_);
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,91 @@
+// event_driven por unidad: con el soporte compilado, solo las unidades que lo piden detienen
+// su loop() entre polls
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "fake_ups.h"
+#include "host_runtime.h"
+#include "powermust/powermust.h"
+
+namespace esphome {
+namespace powermust {
+
+struct Unit {
+  explicit Unit(bool event_driven) : ups(unit.host_uart(), host::FakeUpsConfig{}) {
+    unit.set_update_interval(1000);
+    unit.set_grid_voltage(&grid_voltage);
+    unit.set_event_driven(event_driven);
+    ups.on_request = [this](const std::string &command) {
+      if (command == "Q1")
+        q1_requests++;
+      else
+        last_command = command;
+    };
+  }
+
+  Powermust unit;
+  host::FakeUps ups;
+  sensor::Sensor grid_voltage;
+  uint32_t loop_passes{0};
+  uint32_t q1_requests{0};
+  std::string last_command;
+};
+
+class EventDrivenTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    host::reset();
+    PowermustBus::reset();
+    this->sleeper_ = std::make_unique<Unit>(true);
+    this->poller_ = std::make_unique<Unit>(false);
+    this->sleeper_->unit.setup();
+    this->poller_->unit.setup();
+  }
+
+  // Un paso de 1 ms del bucle principal con las dos unidades
+  void run_for(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      host::advance_ms(1);
+      host::run_scheduler();
+      for (Unit *unit : {this->sleeper_.get(), this->poller_.get()}) {
+        unit->ups.poll(host::now_us());
+        if (unit->unit.is_loop_enabled()) {
+          unit->unit.loop();
+          unit->loop_passes++;
+        }
+      }
+    }
+  }
+
+  std::unique_ptr<Unit> sleeper_;
+  std::unique_ptr<Unit> poller_;
+};
+
+TEST_F(EventDrivenTest, OnlyTheEventDrivenUnitSleeps) {
+  this->run_for(5000);
+  this->sleeper_->loop_passes = 0;
+  this->poller_->loop_passes = 0;
+  uint32_t sleeper_polls = this->sleeper_->q1_requests;
+  uint32_t poller_polls = this->poller_->q1_requests;
+  this->run_for(30000);
+
+  EXPECT_EQ(this->poller_->loop_passes, 30000u);
+  // Solo mientras espera la respuesta: ~230 ms por Q1 a 2400 baudios
+  EXPECT_LT(this->sleeper_->loop_passes, 30000u / 3);
+  EXPECT_NEAR(this->sleeper_->q1_requests - sleeper_polls, 30, 1);
+  EXPECT_NEAR(this->poller_->q1_requests - poller_polls, 30, 1);
+}
+
+TEST_F(EventDrivenTest, CommandWakesTheSleepingUnit) {
+  this->run_for(5000);
+  ASSERT_FALSE(this->sleeper_->unit.is_loop_enabled());
+  this->sleeper_->unit.switch_command("Q");
+  EXPECT_TRUE(this->sleeper_->unit.is_loop_enabled());
+  this->run_for(100);
+  EXPECT_EQ(this->sleeper_->last_command, "Q");
+}
+
+}  // namespace powermust
+}  // namespace esphome
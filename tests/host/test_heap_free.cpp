@@ -0,0 +1,93 @@
+// heap_free: en régimen permanente las pasadas del componente no reservan memoria. Se
+// cuentan las llamadas a operator new solo durante Powermust::loop() y el planificador; el
+// SAI simulado y el reloj quedan fuera.
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "powermust_test.h"
+
+static std::atomic<bool> counting{false};
+static std::atomic<uint32_t> allocations{0};
+
+void *operator new(size_t size) {
+  if (counting.load(std::memory_order_relaxed))
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace esphome {
+namespace powermust {
+
+class HeapFreeTest : public PowermustTest {
+ protected:
+  // Las entidades que heap_free permite: sensores, binarios y ups_info
+  void SetUp() override {
+    PowermustTest::SetUp();
+    this->unit_.set_grid_voltage(&this->grid_voltage_);
+    this->unit_.set_battery_voltage(&this->battery_voltage_);
+    this->unit_.set_ac_output_load_percent(&this->load_);
+    this->unit_.set_utility_fail(&this->utility_fail_);
+    this->unit_.set_ups_info(&this->ups_info_);
+  }
+
+  // Allocations del componente durante ms milisegundos simulados
+  uint32_t count_allocations(uint32_t ms) {
+    allocations = 0;
+    uint64_t end = host::now_us() + (uint64_t) ms * 1000;
+    while (host::now_us() < end) {
+      host::advance_us(1000);
+      this->ups_->poll(host::now_us());
+      counting = true;
+      host::run_once(&this->unit_);
+      counting = false;
+    }
+    return allocations;
+  }
+
+  sensor::Sensor grid_voltage_;
+  sensor::Sensor battery_voltage_;
+  sensor::Sensor load_;
+  binary_sensor::BinarySensor utility_fail_;
+  text_sensor::TextSensor ups_info_;
+};
+
+TEST_F(HeapFreeTest, SteadyStatePollingDoesNotAllocate) {
+  this->unit_.setup();
+  this->run_for(10000);  // F, I y perfil del equipo
+  ASSERT_TRUE(this->grid_voltage_.has_state());
+
+  uint32_t published = this->grid_voltage_.publish_count();
+  EXPECT_EQ(this->count_allocations(60000), 0u);
+  EXPECT_GE(this->grid_voltage_.publish_count() - published, 50u);
+}
+
+TEST_F(HeapFreeTest, PowerEventsDoNotAllocate) {
+  this->unit_.setup();
+  this->run_for(10000);
+
+  this->ups_->set_utility_fail(true);
+  this->ups_->set_battery_voltage(10.5f);
+  EXPECT_EQ(this->count_allocations(20000), 0u);
+  EXPECT_TRUE(this->utility_fail_.state);
+  this->ups_->set_utility_fail(false);
+  this->ups_->set_battery_voltage(13.4f);
+  EXPECT_EQ(this->count_allocations(20000), 0u);
+  EXPECT_FALSE(this->utility_fail_.state);
+}
+
+TEST_F(HeapFreeTest, DroppedRepliesDoNotAllocate) {
+  this->unit_.setup();
+  this->run_for(10000);
+
+  this->ups_->config().drop_percent = 30;
+  this->ups_->config().garbage_percent = 30;
+  EXPECT_EQ(this->count_allocations(60000), 0u);
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,49 @@
+// Historial (USE_POWERMUST_HISTORY): el define compila el historial para todas las unidades,
+// pero solo lo llenan y exportan las configuradas con history.
+#include "powermust_test.h"
+
+namespace esphome {
+namespace powermust {
+
+class HistoryTest : public PowermustTest {
+ protected:
+  void SetUp() override {
+    PowermustTest::SetUp();
+    this->unit_.set_history(&this->history_);
+    this->plain_unit_.set_update_interval(1000);
+    this->plain_unit_.set_history(&this->plain_history_);
+  }
+
+  void run_both_for(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      host::advance_us(1000);
+      this->ups_->poll(host::now_us());
+      this->plain_ups_.poll(host::now_us());
+      host::run_once(&this->unit_);
+      host::run_once(&this->plain_unit_);
+    }
+  }
+
+  text_sensor::TextSensor history_;
+  Powermust plain_unit_;
+  text_sensor::TextSensor plain_history_;
+  host::FakeUps plain_ups_{this->plain_unit_.host_uart(), host::FakeUpsConfig{}};
+};
+
+TEST_F(HistoryTest, OnlyConfiguredUnitsRecord) {
+  this->unit_.set_history_downsampling(true);
+  this->unit_.setup();
+  this->plain_unit_.setup();
+  this->run_both_for(10000);
+
+  this->unit_.export_history();
+  this->plain_unit_.export_history();
+  this->run_both_for(1000);
+
+  ASSERT_TRUE(this->history_.has_state());
+  EXPECT_EQ(this->history_.state[0], 'r');
+  EXPECT_FALSE(this->plain_history_.has_state());
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,61 @@
+// Compilación con solo battery_voltage y utility_fail configurados (POWERMUST_HAS_*), como la
+// genera el código de ESPHome: el Q1 solo convierte la batería, no se guardan los valores de
+// las demás entidades y la unidad publica igual que con todas.
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "powermust_test.h"
+
+namespace esphome {
+namespace powermust {
+
+static_assert(Q1_DECODED_FIELDS == Q1_FIELD_BATTERY_VOLTAGE, "only the configured Q1 fields are converted");
+
+class MinimalEntitiesTest : public PowermustTest {
+ protected:
+  void SetUp() override {
+    PowermustTest::SetUp();
+    this->unit_.set_battery_voltage(&this->battery_voltage_);
+    this->unit_.set_utility_fail(&this->utility_fail_);
+  }
+
+  sensor::Sensor battery_voltage_;
+  binary_sensor::BinarySensor utility_fail_;
+};
+
+TEST_F(MinimalEntitiesTest, PublishesTheConfiguredEntities) {
+  this->unit_.setup();
+  this->run_for(5000);
+  EXPECT_FLOAT_EQ(this->battery_voltage_.state, 13.4f);
+  EXPECT_FALSE(this->utility_fail_.state);
+
+  this->ups_->set_utility_fail(true);
+  this->ups_->set_battery_voltage(12.1f);
+  this->run_for(3000);
+  EXPECT_TRUE(this->utility_fail_.state);
+  EXPECT_FLOAT_EQ(this->battery_voltage_.state, 12.1f);
+
+  this->ups_->set_utility_fail(false);
+  this->run_for(3000);
+  EXPECT_FALSE(this->utility_fail_.state);
+  EXPECT_EQ(this->utility_fail_.publish_count(), 3u);
+}
+
+// Los campos que no se convierten se siguen validando: la batería de una trama con la red
+// corrupta no llega a publicarse
+TEST_F(MinimalEntitiesTest, UnconvertedFieldsAreValidated) {
+  std::vector<float> published;
+  this->battery_voltage_.add_on_state_callback([&published](float state) { published.push_back(state); });
+  this->unit_.setup();
+  this->run_for(5000);
+  this->ups_->set_grid_voltage(NAN);  // "(  nan ...": no es un número ni un marcador
+  this->ups_->set_battery_voltage(12.5f);
+  this->run_for(5000);
+  ASSERT_FALSE(published.empty());
+  EXPECT_FLOAT_EQ(published.front(), 13.4f);
+  EXPECT_EQ(std::count(published.begin(), published.end(), 12.5f), 0);
+}
+
+}  // namespace powermust
+}  // namespace esphome
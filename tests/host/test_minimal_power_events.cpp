@@ -0,0 +1,52 @@
+// Solo battery_voltage y utility_fail configurados, pero con un on_utility_fail
+// (USE_POWERMUST_POWER_EVENTS): el disparador recibe la muestra Q1 entera como x.
+#include <cmath>
+
+#include "powermust_test.h"
+
+namespace esphome {
+namespace powermust {
+
+static_assert(Q1_DECODED_FIELDS == Q1_ALL_FIELDS, "power event triggers get every Q1 field");
+
+class MinimalPowerEventsTest : public PowermustTest {
+ protected:
+  void SetUp() override {
+    PowermustTest::SetUp();
+    this->unit_.set_battery_voltage(&this->battery_voltage_);
+    this->unit_.set_utility_fail(&this->utility_fail_);
+    this->unit_.add_on_power_event_callback([this](PowerEvent event, const Q1Sample &sample) {
+      if (event == POWER_EVENT_UTILITY_FAIL) {
+        this->fired_++;
+        this->sample_ = sample;
+      }
+    });
+  }
+
+  sensor::Sensor battery_voltage_;
+  binary_sensor::BinarySensor utility_fail_;
+  uint32_t fired_{0};
+  Q1Sample sample_{};
+};
+
+TEST_F(MinimalPowerEventsTest, TriggerSeesEveryField) {
+  this->unit_.setup();
+  this->run_for(5000);
+  this->ups_->set_load(27);
+  this->ups_->set_utility_fail(true);
+  this->run_for(3000);
+
+  ASSERT_EQ(this->fired_, 1u);
+  EXPECT_FLOAT_EQ(this->sample_.grid_voltage, 5.2f);
+  EXPECT_FLOAT_EQ(this->sample_.grid_fault_voltage, 232.4f);
+  EXPECT_FLOAT_EQ(this->sample_.ac_output_voltage, 232.4f);
+  EXPECT_EQ(this->sample_.ac_output_load_percent, 27);
+  EXPECT_FLOAT_EQ(this->sample_.grid_frequency, 49.9f);
+  EXPECT_FLOAT_EQ(this->sample_.battery_voltage, 13.4f);
+  EXPECT_FLOAT_EQ(this->sample_.temperature, 25.0f);
+  EXPECT_TRUE(this->sample_.status & Q1_STATUS_UTILITY_FAIL);
+  EXPECT_TRUE(this->utility_fail_.state);
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,51 @@
+// Calidad de red (USE_POWERMUST_POWER_QUALITY): el define compila el monitor para todas las
+// unidades, pero solo lo usan las configuradas con power_quality.
+#include "powermust_test.h"
+
+namespace esphome {
+namespace powermust {
+
+class PowerQualityTest : public PowermustTest {
+ protected:
+  void SetUp() override {
+    PowermustTest::SetUp();
+    this->unit_.set_power_quality_event(&this->event_);
+    this->plain_unit_.set_update_interval(1000);
+    this->plain_unit_.set_power_quality_event(&this->plain_event_);
+  }
+
+  void run_both_for(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      host::advance_us(1000);
+      this->ups_->poll(host::now_us());
+      this->plain_ups_.poll(host::now_us());
+      host::run_once(&this->unit_);
+      host::run_once(&this->plain_unit_);
+    }
+  }
+
+  text_sensor::TextSensor event_;
+  Powermust plain_unit_;
+  text_sensor::TextSensor plain_event_;
+  host::FakeUps plain_ups_{this->plain_unit_.host_uart(), host::FakeUpsConfig{}};
+};
+
+TEST_F(PowerQualityTest, OnlyConfiguredUnitsAnalyse) {
+  this->unit_.set_power_quality_window(5000);
+  this->unit_.setup();
+  this->plain_unit_.setup();
+  this->run_both_for(5000);
+  // Un corte hunde la tensión de red muy por debajo del umbral de hueco en ambos SAI
+  this->ups_->set_utility_fail(true);
+  this->plain_ups_.set_utility_fail(true);
+  this->run_both_for(5000);
+  this->ups_->set_utility_fail(false);
+  this->plain_ups_.set_utility_fail(false);
+  this->run_both_for(10000);
+
+  EXPECT_TRUE(this->event_.has_state());
+  EXPECT_FALSE(this->plain_event_.has_state());
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,128 @@
+// Preferencias de cada unidad (modelo de autonomía, perfil del equipo): la clave sale del id
+// de la unidad, así que sobreviven a un cambio del orden de registro de las unidades
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "fake_ups.h"
+#include "host_runtime.h"
+#include "powermust/powermust.h"
+
+namespace esphome {
+namespace powermust {
+
+static const char *const UPS = "#MUSTEK           PowerMust 800   V1.0      ";
+static const char *const OTHER_UPS = "#MUSTEK           PowerMust 1000  V2.0      ";
+
+static std::string preference_keys_log;  // NOLINT
+
+static void preference_keys_log_sink(int level, const char *tag, const char *message) {
+  preference_keys_log += message;
+  preference_keys_log += '\n';
+}
+
+// Una unidad con su SAI, como la crea el código generado a partir de su id
+struct Unit {
+  explicit Unit(const char *id) {
+    this->powermust.set_preference_key(fnv1_hash(id));
+    this->powermust.set_update_interval(1000);
+    this->powermust.set_estimated_runtime(&this->estimated_runtime);
+    this->powermust.set_ups_info(&this->ups_info);
+  }
+
+  std::string dump_config() {
+    host_log_set_sink(preference_keys_log_sink);
+    preference_keys_log.clear();
+    this->powermust.dump_config();
+    host_log_set_sink(nullptr);
+    return preference_keys_log;
+  }
+
+  Powermust powermust;
+  sensor::Sensor estimated_runtime;
+  text_sensor::TextSensor ups_info;
+  host::FakeUps ups{this->powermust.host_uart(), host::FakeUpsConfig{}};
+};
+
+class PreferenceKeysTest : public ::testing::Test {
+ protected:
+  void SetUp() override { host::reset(); }
+
+  // Un arranque del nodo con las unidades registradas en el orden indicado
+  void boot(bool reversed) {
+    host::reboot();
+    PowermustBus::reset();
+    this->a_ = std::make_unique<Unit>("ups_a");
+    this->b_ = std::make_unique<Unit>("ups_b");
+    this->b_->ups.set_identity(OTHER_UPS);
+    if (reversed) {
+      this->b_->powermust.setup();
+      this->a_->powermust.setup();
+    } else {
+      this->a_->powermust.setup();
+      this->b_->powermust.setup();
+    }
+  }
+
+  void run_for(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      host::advance_us(1000);
+      this->a_->ups.poll(host::now_us());
+      this->b_->ups.poll(host::now_us());
+      host::run_once(&this->a_->powermust);
+      host::run_once(&this->b_->powermust);
+    }
+  }
+
+  std::unique_ptr<Unit> a_;
+  std::unique_ptr<Unit> b_;
+};
+
+TEST_F(PreferenceKeysTest, RuntimeModelFollowsTheUnit) {
+  this->boot(false);
+  this->run_for(10000);
+  // Solo la unidad A ve una descarga completa y aprende su modelo
+  this->a_->ups.set_load(50);
+  this->a_->ups.set_utility_fail(true);
+  for (float voltage = 12.8f; voltage >= 11.6f; voltage -= 0.1f) {
+    this->a_->ups.set_battery_voltage(voltage);
+    this->run_for(10000);
+  }
+  this->a_->ups.set_utility_fail(false);
+  this->run_for(10000);
+  ASSERT_NE(this->a_->dump_config().find("learned from 1 discharges"), std::string::npos);
+
+  this->boot(true);
+  EXPECT_NE(this->a_->dump_config().find("learned from 1 discharges"), std::string::npos);
+  EXPECT_NE(this->b_->dump_config().find("learned from 0 discharges"), std::string::npos);
+}
+
+TEST_F(PreferenceKeysTest, DeviceProfileFollowsTheUnit) {
+  this->boot(false);
+  this->run_for(10000);
+  ASSERT_EQ(this->a_->ups_info.state, UPS);
+  ASSERT_EQ(this->b_->ups_info.state, OTHER_UPS);
+
+  // Arranque en caliente: cada unidad publica su propio perfil y solo lo verifica con I
+  this->boot(true);
+  EXPECT_EQ(this->a_->ups_info.state, UPS);
+  EXPECT_EQ(this->b_->ups_info.state, OTHER_UPS);
+  std::string a_commands, b_commands;
+  this->a_->ups.on_request = [&a_commands](const std::string &command) {
+    if (command != "Q1")
+      a_commands += command;
+  };
+  this->b_->ups.on_request = [&b_commands](const std::string &command) {
+    if (command != "Q1")
+      b_commands += command;
+  };
+  this->run_for(10000);
+  EXPECT_EQ(a_commands, "I");
+  EXPECT_EQ(b_commands, "I");
+}
+
+}  // namespace powermust
+}  // namespace esphome
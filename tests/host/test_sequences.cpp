@@ -0,0 +1,109 @@
+// Secuencias de comandos (USE_POWERMUST_SEQUENCES): verificación con Q1, vuelta atrás y
+// una sola secuencia en curso por unidad
+#include "powermust_test.h"
+
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace powermust {
+
+class SequenceTest : public PowermustTest {
+ protected:
+  void SetUp() override {
+    PowermustTest::SetUp();
+    this->ups_->on_request = [this](const std::string &command) {
+      if (command != "Q1")
+        this->commands_.push_back(command);
+      this->ups_->config().nak_percent = command == this->rejected_ ? 100 : 0;
+    };
+    this->unit_.add_on_sequence_finished_callback([this](const SequenceResult &result) {
+      this->results_.push_back(result);
+    });
+    this->unit_.setup();
+    this->run_for(5000);
+    this->commands_.clear();
+  }
+
+  std::vector<std::string> commands_;  // Peticiones recibidas tras el arranque, sin los Q1
+  std::string rejected_;               // Comando al que el SAI responde NAK
+  std::vector<SequenceResult> results_;
+};
+
+TEST_F(SequenceTest, StepsAreConfirmedByQ1) {
+  CommandSequence sequence("battery test");
+  sequence.add_step("T", Q1_STATUS_TEST_IN_PROGRESS, Q1_STATUS_TEST_IN_PROGRESS, 5000);
+  sequence.add_step("CT", Q1_STATUS_TEST_IN_PROGRESS, 0, 5000);
+
+  // Cada paso se confirma con un Q1 inmediato: los dos pasos caben en un intervalo de poll
+  ASSERT_TRUE(this->unit_.run_sequence(&sequence));
+  this->run_for(1000);
+
+  ASSERT_EQ(this->results_.size(), 1u);
+  EXPECT_TRUE(this->results_[0].success);
+  EXPECT_EQ(this->results_[0].failed_step, 0);
+  EXPECT_EQ(this->results_[0].reason, nullptr);
+  EXPECT_EQ(this->commands_, (std::vector<std::string>{"T", "CT"}));
+}
+
+TEST_F(SequenceTest, RejectedStepRollsBack) {
+  CommandSequence sequence("shutdown with test");
+  sequence.add_step("S.5", Q1_STATUS_SHUTDOWN_ACTIVE, Q1_STATUS_SHUTDOWN_ACTIVE, 5000);
+  sequence.add_step("T", Q1_STATUS_TEST_IN_PROGRESS, Q1_STATUS_TEST_IN_PROGRESS, 5000);
+  sequence.add_rollback("C");
+  sequence.add_rollback("CT");
+  this->rejected_ = "T";
+
+  ASSERT_TRUE(this->unit_.run_sequence(&sequence));
+  this->run_for(10000);
+
+  ASSERT_EQ(this->results_.size(), 1u);
+  EXPECT_FALSE(this->results_[0].success);
+  EXPECT_EQ(this->results_[0].failed_step, 2);
+  EXPECT_STREQ(this->results_[0].reason, "rejected");
+  EXPECT_EQ(this->commands_, (std::vector<std::string>{"S.5", "T", "C", "CT"}));
+}
+
+TEST_F(SequenceTest, UnconfirmedStatusTimesOut) {
+  // El SAI simulado acepta Q pero nunca enciende el bit del zumbador
+  CommandSequence sequence("beeper");
+  sequence.add_step("Q", Q1_STATUS_BEEPER_ON, Q1_STATUS_BEEPER_ON, 3000);
+  sequence.add_rollback("Q");
+
+  ASSERT_TRUE(this->unit_.run_sequence(&sequence));
+  this->run_for(2000);
+  EXPECT_TRUE(this->results_.empty());
+  this->run_for(3000);
+
+  ASSERT_EQ(this->results_.size(), 1u);
+  EXPECT_FALSE(this->results_[0].success);
+  EXPECT_EQ(this->results_[0].failed_step, 1);
+  EXPECT_STREQ(this->results_[0].reason, "status not confirmed");
+  EXPECT_EQ(this->commands_, (std::vector<std::string>{"Q", "Q"}));
+}
+
+TEST_F(SequenceTest, SecondSequenceIsRejectedWhileRunning) {
+  CommandSequence first("first");
+  first.add_step("T", Q1_STATUS_TEST_IN_PROGRESS, Q1_STATUS_TEST_IN_PROGRESS, 5000);
+  CommandSequence second("second");
+  second.add_step("S.5", 0, 0, 5000);
+
+  ASSERT_TRUE(this->unit_.run_sequence(&first));
+  EXPECT_FALSE(this->unit_.run_sequence(&second));
+  this->run_for(5000);
+
+  ASSERT_EQ(this->results_.size(), 1u);
+  EXPECT_EQ(this->results_[0].sequence, &first);
+  EXPECT_TRUE(this->results_[0].success);
+  EXPECT_EQ(this->commands_, (std::vector<std::string>{"T"}));
+
+  // Una vez terminada, la unidad acepta la siguiente
+  EXPECT_TRUE(this->unit_.run_sequence(&second));
+  this->run_for(5000);
+  ASSERT_EQ(this->results_.size(), 2u);
+  EXPECT_EQ(this->results_[1].sequence, &second);
+  EXPECT_TRUE(this->results_[1].success);
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,89 @@
+// Extremo a extremo contra el SAI simulado: polling, decodificación y publicación
+#include "powermust_test.h"
+
+namespace esphome {
+namespace powermust {
+
+class SimulatorTest : public PowermustTest {
+ protected:
+  void SetUp() override {
+    PowermustTest::SetUp();
+    this->unit_.set_grid_voltage(&this->grid_voltage_);
+    this->unit_.set_battery_voltage(&this->battery_voltage_);
+    this->unit_.set_utility_fail(&this->utility_fail_);
+    this->unit_.set_test_in_progress(&this->test_in_progress_);
+    this->unit_.set_ups_info(&this->ups_info_);
+  }
+
+  sensor::Sensor grid_voltage_;
+  sensor::Sensor battery_voltage_;
+  binary_sensor::BinarySensor utility_fail_;
+  binary_sensor::BinarySensor test_in_progress_;
+  text_sensor::TextSensor ups_info_;
+};
+
+TEST_F(SimulatorTest, PublishesDecodedValues) {
+  this->unit_.setup();
+  this->run_for(3000);
+
+  ASSERT_TRUE(this->grid_voltage_.has_state());
+  EXPECT_FLOAT_EQ(this->grid_voltage_.state, 232.4f);
+  EXPECT_FLOAT_EQ(this->battery_voltage_.state, 13.4f);
+  EXPECT_FALSE(this->utility_fail_.state);
+  EXPECT_EQ(this->ups_info_.state, "#MUSTEK           PowerMust 800   V1.0      ");
+}
+
+TEST_F(SimulatorTest, PollsQ1AtTheUpdateInterval) {
+  this->unit_.setup();
+  this->run_for(1000);
+  uint32_t published = this->grid_voltage_.publish_count();
+  this->run_for(10000);
+  EXPECT_NEAR(this->grid_voltage_.publish_count() - published, 10, 1);
+}
+
+TEST_F(SimulatorTest, FollowsUtilityFail) {
+  this->unit_.setup();
+  this->run_for(2000);
+  this->ups_->set_utility_fail(true);
+  this->run_for(2000);
+  EXPECT_TRUE(this->utility_fail_.state);
+  EXPECT_FLOAT_EQ(this->grid_voltage_.state, 5.2f);
+  this->ups_->set_utility_fail(false);
+  this->run_for(2000);
+  EXPECT_FALSE(this->utility_fail_.state);
+}
+
+TEST_F(SimulatorTest, ToleratesGarbageAndJitter) {
+  this->ups_->config().garbage_percent = 50;
+  this->ups_->config().jitter_ms = 200;
+  this->unit_.setup();
+  this->run_for(60000);
+
+  EXPECT_GE(this->grid_voltage_.publish_count(), 40u);
+  EXPECT_FLOAT_EQ(this->grid_voltage_.state, 232.4f);
+}
+
+TEST_F(SimulatorTest, RecoversFromDroppedReplies) {
+  this->ups_->config().drop_percent = 30;
+  this->unit_.setup();
+  this->run_for(60000);
+
+  EXPECT_GE(this->grid_voltage_.publish_count(), 20u);
+  this->ups_->config().drop_percent = 0;
+  uint32_t published = this->grid_voltage_.publish_count();
+  this->run_for(20000);
+  EXPECT_GE(this->grid_voltage_.publish_count() - published, 15u);
+}
+
+TEST_F(SimulatorTest, SendsSwitchCommands) {
+  this->unit_.setup();
+  this->run_for(3000);
+  this->unit_.switch_command("T");
+  this->run_for(3000);
+
+  EXPECT_EQ(this->ups_->last_command(), "Q1");
+  EXPECT_TRUE(this->test_in_progress_.state);
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,160 @@
+// Timeouts de respuesta (RttEstimator) y espera entre polls con el enlace caído
+#include "powermust_test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "esphome/core/log.h"
+#include "powermust/rtt_estimator.h"
+
+namespace esphome {
+namespace powermust {
+
+TEST(RttEstimatorTest, StartsWithInitialTimeout) {
+  RttEstimator rtt(1000);
+  EXPECT_EQ(rtt.samples(), 0u);
+  EXPECT_EQ(rtt.timeout(), 1000u);
+}
+
+TEST(RttEstimatorTest, FirstSampleSetsSmoothedAndVariation) {
+  // RFC 6298: SRTT = R, RTTVAR = R/2, RTO = SRTT + 4·RTTVAR
+  RttEstimator rtt(1000);
+  rtt.add(200);
+  EXPECT_EQ(rtt.samples(), 1u);
+  EXPECT_EQ(rtt.smoothed(), 200u);
+  EXPECT_EQ(rtt.variation(), 100u);
+  EXPECT_EQ(rtt.timeout(), 600u);
+}
+
+TEST(RttEstimatorTest, ConvergesToSteadyRtt) {
+  RttEstimator rtt(1000);
+  rtt.add(800);
+  for (int i = 0; i < 100; i++)
+    rtt.add(400);
+  EXPECT_EQ(rtt.smoothed(), 400u);
+  EXPECT_EQ(rtt.variation(), 0u);
+  // La variación no baja de la granularidad del reloj
+  EXPECT_EQ(rtt.timeout(), 400u + RttEstimator::GRANULARITY);
+}
+
+TEST(RttEstimatorTest, TimeoutIsClamped) {
+  RttEstimator fast(1000);
+  for (int i = 0; i < 100; i++)
+    fast.add(10);
+  EXPECT_EQ(fast.timeout(), (uint32_t) RttEstimator::MIN_TIMEOUT);
+
+  RttEstimator slow(1000);
+  slow.add(10000);
+  EXPECT_EQ(slow.timeout(), (uint32_t) RttEstimator::MAX_TIMEOUT);
+}
+
+TEST(RttEstimatorTest, BackoffDoublesUntilNextSample) {
+  RttEstimator rtt(1000);
+  rtt.add(200);
+  rtt.backoff();
+  EXPECT_EQ(rtt.timeout(), 1200u);
+  rtt.backoff();
+  rtt.backoff();
+  EXPECT_EQ(rtt.timeout(), (uint32_t) RttEstimator::MAX_TIMEOUT);
+  rtt.add(200);
+  EXPECT_LT(rtt.timeout(), 1200u);
+}
+
+static std::string timeouts_log;  // NOLINT
+
+static void timeouts_log_sink(int level, const char *tag, const char *message) {
+  timeouts_log += message;
+  timeouts_log += '\n';
+}
+
+class LinkTest : public PowermustTest {
+ protected:
+  void SetUp() override {
+    // Respuesta entera de golpe: el RTT medido es la latencia del SAI
+    this->ups_config_.baud_rate = 0;
+    PowermustTest::SetUp();
+    this->unit_.set_link(&this->link_);
+    this->unit_.set_grid_voltage(&this->grid_voltage_);  // Sin entidades del Q1 no hay poll Q1
+    this->ups_->on_request = [this](const std::string &command) {
+      if (command == "Q1")
+        this->q1_requests_ms_.push_back(host::now_us() / 1000);
+      if (this->on_request)
+        this->on_request(command);
+    };
+    this->unit_.setup();
+    this->run_for(10000);
+  }
+
+  // RTT suavizado del Q1 según dump_config
+  unsigned q1_smoothed_rtt() {
+    host_log_set_sink(timeouts_log_sink);
+    timeouts_log.clear();
+    this->unit_.dump_config();
+    host_log_set_sink(nullptr);
+    unsigned timeout = 0, smoothed = 0;
+    const char *line = strstr(timeouts_log.c_str(), "Q1: every");
+    if (line != nullptr)
+      line = strstr(line, "Timeout");
+    if (line == nullptr || sscanf(line, "Timeout %u ms (RTT %u ms", &timeout, &smoothed) != 2)
+      ADD_FAILURE() << "No Q1 timeout in dump_config";
+    return smoothed;
+  }
+
+  sensor::Sensor grid_voltage_;
+  binary_sensor::BinarySensor link_;
+  std::vector<uint64_t> q1_requests_ms_;
+  std::function<void(const std::string &)> on_request;
+};
+
+TEST_F(LinkTest, ResentPollsAreNotMeasured) {
+  unsigned smoothed = this->q1_smoothed_rtt();
+  EXPECT_NEAR(smoothed, this->ups_config_.latency_ms, 5);
+
+  // Se pierde cada primer envío del Q1 y el reenvío responde más despacio: con el
+  // algoritmo de Karn esas respuestas no cambian el RTT medido
+  bool drop = true;
+  this->on_request = [this, &drop](const std::string &command) {
+    if (command != "Q1")
+      return;
+    this->ups_->config().drop_percent = drop ? 100 : 0;
+    this->ups_->config().latency_ms = 150;
+    drop = !drop;
+  };
+  uint32_t replies = this->ups_->replies();
+  this->run_for(20000);
+
+  EXPECT_GT(this->ups_->replies() - replies, 10u);
+  EXPECT_TRUE(this->link_.state);
+  EXPECT_EQ(this->q1_smoothed_rtt(), smoothed);
+}
+
+TEST_F(LinkTest, SilentUpsBacksOffUntilItAnswers) {
+  ASSERT_TRUE(this->link_.state);
+  this->ups_->config().drop_percent = 100;
+  this->q1_requests_ms_.clear();
+  this->run_for(70000);
+
+  EXPECT_FALSE(this->link_.state);
+  // Con el enlace caído no hay reenvíos y la espera se duplica en cada poll
+  ASSERT_GE(this->q1_requests_ms_.size(), 5u);
+  size_t n = this->q1_requests_ms_.size();
+  uint64_t gap = this->q1_requests_ms_[n - 1] - this->q1_requests_ms_[n - 2];
+  uint64_t previous_gap = this->q1_requests_ms_[n - 2] - this->q1_requests_ms_[n - 3];
+  EXPECT_GE(gap, 8000u);
+  EXPECT_NEAR((double) gap / previous_gap, 2.0, 0.2);
+
+  // La siguiente respuesta vuelve al intervalo normal
+  this->ups_->config().drop_percent = 0;
+  this->run_for(60000);  // La espera máxima con el enlace caído
+  EXPECT_TRUE(this->link_.state);
+  this->q1_requests_ms_.clear();
+  this->run_for(10000);
+  ASSERT_GE(this->q1_requests_ms_.size(), 9u);
+  for (size_t i = 1; i < this->q1_requests_ms_.size(); i++)
+    EXPECT_LE(this->q1_requests_ms_[i] - this->q1_requests_ms_[i - 1], 1100u);
+}
+
+}  // namespace powermust
+}  // namespace esphome
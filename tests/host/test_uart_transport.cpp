@@ -0,0 +1,147 @@
+// Tarea de transporte (USE_POWERMUST_TRANSPORT_TASK) con el std::thread del host y el reloj
+// real: la tarea es dueña de la UART y el hilo de la prueba hace de loop principal y de SAI.
+// Pensada también para ThreadSanitizer:
+//
+//   cmake -S tests/host -B build-tsan -DPOWERMUST_SANITIZE=thread
+//   cmake --build build-tsan --target test_uart_transport && build-tsan/test_uart_transport
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "esphome/core/log.h"
+#include "powermust_test.h"
+
+namespace esphome {
+namespace powermust {
+
+static std::string transport_log;
+
+static void transport_log_sink(int level, const char *tag, const char *message) {
+  transport_log += message;
+  transport_log += '\n';
+}
+
+// La UART del host vista desde la tarea
+class HostTransportStream : public TransportStream {
+ public:
+  explicit HostTransportStream(uart::HostUart &uart) : uart_(uart) {}
+  size_t available() override { return this->uart_.available(); }
+  bool read(uint8_t *data, size_t length) override { return this->uart_.read_array(data, length); }
+  void write(const uint8_t *data, size_t length) override { this->uart_.write_array(data, length); }
+
+ protected:
+  uart::HostUart &uart_;
+};
+
+class UartTransportTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    host::reset();
+    PowermustBus::reset();
+    host::use_real_clock(true);
+  }
+  void TearDown() override { host::use_real_clock(false); }
+
+  // Espera una respuesta de la tarea atendiendo al SAI cada milisegundo
+  bool receive(UartTransport &transport, host::FakeUps &ups, TransportReply &reply, uint32_t max_ms) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_ms);
+    while (std::chrono::steady_clock::now() < end) {
+      ups.poll(host::now_us());
+      if (transport.receive(reply))
+        return true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+  }
+
+  uart::HostUart uart_;
+  HostTransportStream stream_{this->uart_};
+};
+
+TEST_F(UartTransportTest, RepliesTimeoutsAndLateFrames) {
+  host::FakeUpsConfig config;
+  config.latency_ms = 20;
+  host::FakeUps ups(this->uart_, config);
+  UartTransport transport;
+  ASSERT_TRUE(transport.start(&this->stream_));
+
+  // Respuesta dentro del timeout, medida por la tarea
+  TransportReply reply;
+  ASSERT_TRUE(transport.send("Q1", 2, '(', 500));
+  ASSERT_TRUE(this->receive(transport, ups, reply, 2000));
+  EXPECT_EQ(reply.type, TRANSPORT_REPLY_FRAME);
+  EXPECT_EQ(reply.frame[0], '(');
+  EXPECT_EQ(reply.frame[reply.length - 1], '\r');
+  EXPECT_GE(reply.elapsed, 20u);
+  EXPECT_EQ(ups.last_command(), "Q1");
+
+  // Sin respuesta: timeout de la tarea
+  ups.config().drop_percent = 100;
+  ASSERT_TRUE(transport.send("F", 1, '#', 100));
+  ASSERT_TRUE(this->receive(transport, ups, reply, 2000));
+  EXPECT_EQ(reply.type, TRANSPORT_REPLY_TIMEOUT);
+  EXPECT_GT(reply.elapsed, 100u);
+
+  // Trama sin petición en curso
+  this->uart_.inject("(232.4 232.4 232.4 003 49.9 13.4 25.0 00001000\r");
+  ASSERT_TRUE(this->receive(transport, ups, reply, 2000));
+  EXPECT_EQ(reply.type, TRANSPORT_REPLY_UNSOLICITED);
+
+  transport.stop();
+  EXPECT_EQ(transport.requests(), 2u);
+  EXPECT_EQ(transport.timeouts(), 1u);
+  EXPECT_EQ(transport.discarded_frames(), 0u);
+}
+
+// Dos unidades en el mismo nodo: solo la que lo configura usa la tarea, la otra lee su UART
+// desde loop()
+TEST_F(UartTransportTest, TransportIsPerUnit) {
+  Powermust task_unit, loop_unit;
+  sensor::Sensor task_grid_voltage, loop_grid_voltage;
+  host::FakeUps task_ups(task_unit.host_uart(), host::FakeUpsConfig{});
+  host::FakeUps loop_ups(loop_unit.host_uart(), host::FakeUpsConfig{});
+  task_unit.set_update_interval(200);
+  loop_unit.set_update_interval(200);
+  task_unit.set_grid_voltage(&task_grid_voltage);
+  loop_unit.set_grid_voltage(&loop_grid_voltage);
+  task_unit.set_transport_task(true);
+  task_unit.setup();
+  loop_unit.setup();
+
+  auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(1500);
+  while (std::chrono::steady_clock::now() < end) {
+    task_ups.poll(host::now_us());
+    loop_ups.poll(host::now_us());
+    host::run_once(&task_unit);
+    host::run_once(&loop_unit);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  EXPECT_GE(task_grid_voltage.publish_count(), 1u);
+  EXPECT_GE(loop_grid_voltage.publish_count(), 1u);
+  EXPECT_FLOAT_EQ(task_grid_voltage.state, 232.4f);
+  EXPECT_FLOAT_EQ(loop_grid_voltage.state, 232.4f);
+  EXPECT_GT(task_ups.requests(), 0u);
+  EXPECT_GT(loop_ups.requests(), 0u);
+
+  // dump_config solo muestra la tarea de la unidad que la usa, con sus peticiones
+  host_log_set_sink(transport_log_sink);
+  transport_log.clear();
+  task_unit.dump_config();
+  unsigned requests = 0;
+  const char *line = strstr(transport_log.c_str(), "Transport: UART task");
+  ASSERT_NE(line, nullptr);
+  ASSERT_EQ(sscanf(line, "Transport: UART task on core %*d, %u requests", &requests), 1);
+  // La tarea puede haber enviado una petición que el SAI aún no ha leído
+  EXPECT_GE(requests, task_ups.requests());
+  EXPECT_LE(requests, task_ups.requests() + 1);
+  transport_log.clear();
+  loop_unit.dump_config();
+  host_log_set_sink(nullptr);
+  EXPECT_EQ(transport_log.find("Transport:"), std::string::npos);
+}
+
+}  // namespace powermust
+}  // namespace esphome
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Decode and replay UART captures of the powermust component.
+
+Dump the capture with the `powermust.dump_capture` action and save the log:
+
+    esphome logs config.yaml | tee capture.log
+
+Print the traffic and save it as a binary capture:
+
+    tools/powermust_capture.py decode capture.log -o capture.bin
+
+Replay it against a node: the tool plays the UPS on a USB serial adapter wired to the
+UART of the node. Every captured TX is awaited from the node and every captured RX is
+sent back, at the original timing or as fast as possible with `--fast`:
+
+    tools/powermust_capture.py replay capture.bin --port /dev/ttyUSB0
+"""
+
+import argparse
+import base64
+import re
+import struct
+import sys
+import time
+
+CHUNK = re.compile(r"Capture (\d+)/(\d+): ([A-Za-z0-9+/=]+)")
+# timestamp (micros) y flags: bit 7 TX, bits 0-6 longitud (capture_buffer.h)
+HEADER = struct.Struct("<IB")
+FLAG_TX = 0x80
+LENGTH_MASK = 0x7F
+
+
+def parse_log(text):
+    """Return the bytes of the last complete dump in an ESPHome log."""
+    chunks = {}
+    complete = None
+    for line in text.splitlines():
+        if "Capture start" in line:
+            chunks = {}
+        elif (match := CHUNK.search(line)) is not None:
+            chunks[int(match[1])] = (int(match[2]), base64.b64decode(match[3]))
+        elif "Capture end" in line and chunks:
+            total = next(iter(chunks.values()))[0]
+            missing = [n for n in range(1, total + 1) if n not in chunks]
+            if missing:
+                sys.exit(f"Capture dump is missing lines {missing}")
+            complete = b"".join(chunks[n][1] for n in range(1, total + 1))
+    if complete is None:
+        sys.exit("No complete capture dump found")
+    return complete
+
+
+def parse_records(data):
+    records = []
+    offset = 0
+    while offset + HEADER.size <= len(data):
+        timestamp, flags = HEADER.unpack_from(data, offset)
+        offset += HEADER.size
+        payload = data[offset : offset + (flags & LENGTH_MASK)]
+        offset += len(payload)
+        records.append((timestamp, bool(flags & FLAG_TX), payload))
+    return records
+
+
+def load(path):
+    with open(path, "rb") as file:
+        data = file.read()
+    if b"Capture " in data:
+        data = parse_log(data.decode(errors="replace"))
+    return data
+
+
+def elapsed(start, timestamp):
+    # micros() da la vuelta cada 71 minutos
+    return ((timestamp - start) & 0xFFFFFFFF) / 1e6
+
+
+def decode(args):
+    data = load(args.capture)
+    if args.output:
+        with open(args.output, "wb") as file:
+            file.write(data)
+    records = parse_records(data)
+    if not records:
+        return
+    first = previous = records[0][0]
+    for timestamp, tx, payload in records:
+        print(
+            f"{elapsed(first, timestamp):12.6f} s  +{elapsed(previous, timestamp) * 1000:9.3f} ms  "
+            f"{'TX' if tx else 'RX'}  {payload!r}"
+        )
+        previous = timestamp
+
+
+def read_frame(uart, timeout):
+    frame = b""
+    deadline = time.monotonic() + timeout
+    while not frame.endswith(b"\r") and time.monotonic() < deadline:
+        frame += uart.read(1)
+    return frame
+
+
+def replay(args):
+    import serial  # pyserial, instalado con ESPHome
+
+    records = parse_records(load(args.capture))
+    mismatches = 0
+    with serial.Serial(args.port, args.baud_rate, timeout=0.1) as uart:
+        uart.reset_input_buffer()
+        previous = None
+        previous_time = time.monotonic()
+        for timestamp, tx, payload in records:
+            if tx:
+                frame = read_frame(uart, args.timeout)
+                if frame != payload:
+                    mismatches += 1
+                    print(f"Expected TX {payload!r}, received {frame!r}")
+            else:
+                if not args.fast and previous is not None:
+                    delay = previous_time + elapsed(previous, timestamp) - time.monotonic()
+                    if delay > 0:
+                        time.sleep(delay)
+                uart.write(payload)
+            previous = timestamp
+            previous_time = time.monotonic()
+    print(f"Replayed {len(records)} records, {mismatches} TX mismatches")
+    return 1 if mismatches else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    decode_parser = commands.add_parser("decode", help="print a capture from a log or binary file")
+    decode_parser.add_argument("capture")
+    decode_parser.add_argument("-o", "--output", help="save the capture as binary file")
+
+    replay_parser = commands.add_parser("replay", help="play the UPS side of a capture on a serial port")
+    replay_parser.add_argument("capture")
+    replay_parser.add_argument("--port", required=True)
+    replay_parser.add_argument("--baud-rate", type=int, default=2400)
+    replay_parser.add_argument("--fast", action="store_true", help="answer immediately instead of at original timing")
+    replay_parser.add_argument("--timeout", type=float, default=60.0, help="seconds to wait for each TX of the node")
+
+    args = parser.parse_args()
+    if args.command == "decode":
+        decode(args)
+        return 0
+    return replay(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())